@@ -0,0 +1,90 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <memory>
+#include <vector>
+#include <leaf3d/L3DGeometry.h>
+#include <leaf3d/L3DMesh.h>
+#include "microbench.h"
+
+using namespace l3d;
+
+struct GridState
+{
+    std::vector<float>          vertices;
+    std::vector<unsigned int>   indices;
+    unsigned int                n;
+};
+
+static std::shared_ptr<GridState> _grid(unsigned int n)
+{
+    std::shared_ptr<GridState> state(new GridState());
+    state->vertices.resize(L3DGeometry::gridVertexCount(n) * L3D_VERTEX_POS3_NOR3_TAN3_UV2);
+    state->indices.resize(L3DGeometry::gridIndexCount(n));
+    state->n = n;
+
+    L3DGeometry::grid(n, L3DVec2(1, 1), &state->vertices[0], &state->indices[0]);
+
+    return state;
+}
+
+// Vertices and indices of l3dLoadGrid(), size is quads per side.
+static MicroBenchBody _gridGeometry(unsigned int size)
+{
+    std::shared_ptr<GridState> state = _grid(size);
+
+    return [state]() {
+        L3DGeometry::grid(state->n, L3DVec2(2, 2), &state->vertices[0], &state->indices[0]);
+
+        microBenchKeep(state->vertices[0]);
+    };
+}
+
+struct TangentsState
+{
+    L3DMesh* mesh;
+
+    ~TangentsState() { delete mesh; }
+};
+
+// Tangents of a grid mesh, size is quads per side.
+static MicroBenchBody _meshTangents(unsigned int size)
+{
+    std::shared_ptr<GridState> grid = _grid(size);
+    std::shared_ptr<TangentsState> state(new TangentsState());
+
+    state->mesh = new L3DMesh(
+        0,
+        &grid->vertices[0], L3DGeometry::gridVertexCount(size),
+        &grid->indices[0], L3DGeometry::gridIndexCount(size),
+        0,
+        L3D_VERTEX_POS3_NOR3_TAN3_UV2
+    );
+
+    return [state]() {
+        state->mesh->recalculateTangents();
+
+        microBenchKeep(*state->mesh);
+    };
+}
+
+L3D_MICROBENCH("geometry/grid", _gridGeometry, 128);
+L3D_MICROBENCH("mesh/tangents", _meshTangents, 64);
@@ -0,0 +1,319 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "microbench.h"
+
+typedef std::chrono::steady_clock MicroBenchClock;
+
+// Parameters of run.
+struct MicroBenchConfig
+{
+    const char*                 filter;
+    std::vector<unsigned int>   sizes;
+    unsigned int                samples;
+    unsigned int                warmupSamples;
+    double                      minSampleMs;
+    const char*                 output;
+
+    MicroBenchConfig()
+      : filter(0), samples(30), warmupSamples(3), minSampleMs(10), output(0) {}
+};
+
+// Time of a single call, in nanoseconds, over all samples.
+struct MicroBenchResult
+{
+    const char*     name;
+    unsigned int    size;
+    unsigned int    iterations;
+    unsigned int    samples;
+    double          min;
+    double          median;
+    double          mean;
+    double          stddev;
+    double          mad;
+    double          ci95;
+};
+
+std::vector<MicroBench>& microBenches()
+{
+    static std::vector<MicroBench> benches;
+    return benches;
+}
+
+MicroBenchRegistrar::MicroBenchRegistrar(const char* name, MicroBenchSetup setup, unsigned int defaultSize)
+{
+    MicroBench bench;
+    bench.name = name;
+    bench.setup = setup;
+    bench.defaultSize = defaultSize;
+    microBenches().push_back(bench);
+}
+
+static void _printUsage()
+{
+    fprintf(stderr,
+        "Usage: leaf3dMicroBench [options]\n"
+        "  --list            print benchmark names and exit\n"
+        "  --filter STR      run benchmarks whose name contains STR (all)\n"
+        "  --sizes A,B,...   problem sizes, instead of default of each benchmark\n"
+        "  --samples N       measured samples (30)\n"
+        "  --warmup W        samples run before measuring (3)\n"
+        "  --min-time MS     minimum duration of a sample (10)\n"
+        "  --output FILE     write JSON results to file\n"
+    );
+}
+
+static bool _parseSizes(const char* value, std::vector<unsigned int>& sizes)
+{
+    sizes.clear();
+
+    while (*value)
+    {
+        char* end = 0;
+        unsigned long size = strtoul(value, &end, 10);
+        if (end == value || size == 0)
+            return false;
+
+        sizes.push_back((unsigned int)size);
+
+        value = *end == ',' ? end + 1 : end;
+    }
+
+    return !sizes.empty();
+}
+
+static bool _parseArgs(int argc, char** argv, MicroBenchConfig& config, bool& list)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+
+        if (!strcmp(arg, "--list"))
+        {
+            list = true;
+            continue;
+        }
+
+        const char* value = i + 1 < argc ? argv[i + 1] : 0;
+
+        if (!strcmp(arg, "--help") || !value)
+            return false;
+
+        if (!strcmp(arg, "--filter"))
+            config.filter = value;
+        else if (!strcmp(arg, "--sizes"))
+        {
+            if (!_parseSizes(value, config.sizes))
+                return false;
+        }
+        else if (!strcmp(arg, "--samples"))
+            config.samples = std::max(atoi(value), 2);
+        else if (!strcmp(arg, "--warmup"))
+            config.warmupSamples = std::max(atoi(value), 0);
+        else if (!strcmp(arg, "--min-time"))
+            config.minSampleMs = std::max(atof(value), 0.001);
+        else if (!strcmp(arg, "--output"))
+            config.output = value;
+        else
+            return false;
+
+        ++i;
+    }
+
+    return true;
+}
+
+// Duration of given number of calls, in nanoseconds.
+static double _time(const MicroBenchBody& body, unsigned int iterations)
+{
+    MicroBenchClock::time_point start = MicroBenchClock::now();
+
+    for (unsigned int i = 0; i < iterations; ++i)
+        body();
+
+    return std::chrono::duration<double, std::nano>(MicroBenchClock::now() - start).count();
+}
+
+static double _median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+
+    unsigned int half = values.size() / 2;
+    if (values.size() % 2)
+        return values[half];
+
+    return (values[half - 1] + values[half]) * 0.5;
+}
+
+static MicroBenchResult _run(const MicroBench& bench, unsigned int size, const MicroBenchConfig& config)
+{
+    MicroBenchBody body = bench.setup(size);
+
+    // Double iterations until a sample lasts long enough for clock
+    // resolution not to matter.
+    double minSampleNs = config.minSampleMs * 1e6;
+    unsigned int iterations = 1;
+    while (_time(body, iterations) < minSampleNs && iterations < (1u << 30))
+        iterations *= 2;
+
+    for (unsigned int i = 0; i < config.warmupSamples; ++i)
+        _time(body, iterations);
+
+    std::vector<double> times(config.samples);
+    for (unsigned int i = 0; i < config.samples; ++i)
+        times[i] = _time(body, iterations) / iterations;
+
+    MicroBenchResult result;
+    result.name = bench.name;
+    result.size = size;
+    result.iterations = iterations;
+    result.samples = config.samples;
+    result.min = *std::min_element(times.begin(), times.end());
+    result.median = _median(times);
+
+    double sum = 0;
+    for (unsigned int i = 0; i < times.size(); ++i)
+        sum += times[i];
+    result.mean = sum / times.size();
+
+    double squares = 0;
+    std::vector<double> deviations(times.size());
+    for (unsigned int i = 0; i < times.size(); ++i)
+    {
+        squares += (times[i] - result.mean) * (times[i] - result.mean);
+        deviations[i] = fabs(times[i] - result.median);
+    }
+
+    // Sample standard deviation, and half width of 95% confidence
+    // interval of mean (normal approximation).
+    result.stddev = sqrt(squares / (times.size() - 1));
+    result.mad = _median(deviations);
+    result.ci95 = 1.96 * result.stddev / sqrt((double)times.size());
+
+    return result;
+}
+
+static void _printResult(const MicroBenchResult& result)
+{
+    printf("%-28s %9u %12.1f %12.1f %12.1f %7.2f%% %10.1f %10.3f\n",
+        result.name,
+        result.size,
+        result.median,
+        result.min,
+        result.mean,
+        result.mean > 0 ? 100.0 * result.ci95 / result.mean : 0.0,
+        result.mad,
+        result.median / result.size
+    );
+    fflush(stdout);
+}
+
+static void _writeResults(FILE* out, const MicroBenchConfig& config, const std::vector<MicroBenchResult>& results)
+{
+    fprintf(out, "{\n");
+    fprintf(out, "  \"samples\": %u,\n", config.samples);
+    fprintf(out, "  \"warmupSamples\": %u,\n", config.warmupSamples);
+    fprintf(out, "  \"minSampleMs\": %.3f,\n", config.minSampleMs);
+    fprintf(out, "  \"benchmarks\": [\n");
+
+    for (unsigned int i = 0; i < results.size(); ++i)
+    {
+        const MicroBenchResult& result = results[i];
+
+        fprintf(out, "    { \"name\": \"%s\",", result.name);
+        fprintf(out, " \"size\": %u,", result.size);
+        fprintf(out, " \"iterations\": %u,", result.iterations);
+        fprintf(out, " \"medianNs\": %.3f,", result.median);
+        fprintf(out, " \"minNs\": %.3f,", result.min);
+        fprintf(out, " \"meanNs\": %.3f,", result.mean);
+        fprintf(out, " \"stddevNs\": %.3f,", result.stddev);
+        fprintf(out, " \"madNs\": %.3f,", result.mad);
+        fprintf(out, " \"ci95Ns\": %.3f,", result.ci95);
+        fprintf(out, " \"nsPerElement\": %.4f }%s\n", result.median / result.size, i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+    MicroBenchConfig config;
+    bool list = false;
+
+    if (!_parseArgs(argc, argv, config, list)) {
+        _printUsage();
+        return -1;
+    }
+
+    std::vector<MicroBench> benches;
+    for (unsigned int i = 0; i < microBenches().size(); ++i)
+    {
+        const MicroBench& bench = microBenches()[i];
+        if (!config.filter || strstr(bench.name, config.filter))
+            benches.push_back(bench);
+    }
+
+    if (list) {
+        for (unsigned int i = 0; i < benches.size(); ++i)
+            printf("%s (size %u)\n", benches[i].name, benches[i].defaultSize);
+        return 0;
+    }
+
+    printf("%-28s %9s %12s %12s %12s %8s %10s %10s\n",
+        "benchmark", "size", "median ns", "min ns", "mean ns", "ci95", "mad ns", "ns/elem");
+
+    std::vector<MicroBenchResult> results;
+    for (unsigned int i = 0; i < benches.size(); ++i)
+    {
+        std::vector<unsigned int> sizes = config.sizes;
+        if (sizes.empty())
+            sizes.push_back(benches[i].defaultSize);
+
+        for (unsigned int s = 0; s < sizes.size(); ++s)
+        {
+            results.push_back(_run(benches[i], sizes[s], config));
+            _printResult(results.back());
+        }
+    }
+
+    if (config.output)
+    {
+        FILE* out = fopen(config.output, "w");
+
+        if (!out) {
+            fprintf(stderr, "Failed to open %s\n", config.output);
+            return -2;
+        }
+
+        _writeResults(out, config, results);
+        fclose(out);
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <memory>
+#include <vector>
+#include <leaf3d/L3DMatrixBatch.h>
+#include "microbench.h"
+
+using namespace l3d;
+
+struct NormalMatricesState
+{
+    std::vector<L3DMat4>    matrices;
+    std::vector<L3DMat3>    normalMatrices;
+    std::vector<L3DMat4*>   matrixPtrs;
+    std::vector<L3DMat3*>   normalMatrixPtrs;
+};
+
+static std::shared_ptr<NormalMatricesState> _normalMatrices(unsigned int count)
+{
+    std::shared_ptr<NormalMatricesState> state(new NormalMatricesState());
+    state->matrices.resize(count);
+    state->normalMatrices.resize(count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float k = (float)i / count;
+        state->matrices[i] = glm::translate(L3DMat4(), L3DVec3(k, 1.0f - k, 2.0f * k));
+        state->matrices[i] = glm::rotate(state->matrices[i], k * 6.28f, L3DVec3(0, 1, 0));
+        state->matrices[i] = glm::scale(state->matrices[i], L3DVec3(1.0f + k, 1.0f, 2.0f - k));
+
+        state->matrixPtrs.push_back(&state->matrices[i]);
+        state->normalMatrixPtrs.push_back(&state->normalMatrices[i]);
+    }
+
+    return state;
+}
+
+// One matrix at a time, as meshes without a renderer do.
+static MicroBenchBody _normalMatrix(unsigned int size)
+{
+    std::shared_ptr<NormalMatricesState> state = _normalMatrices(size);
+
+    return [state]() {
+        for (unsigned int i = 0; i < state->matrices.size(); ++i)
+            state->normalMatrices[i] = L3DMatrixBatch::normalMatrix(state->matrices[i]);
+
+        microBenchKeep(state->normalMatrices[0]);
+    };
+}
+
+// Batches, as the renderer updates meshes moved in a frame.
+static MicroBenchBody _normalMatrixBatch(unsigned int size)
+{
+    std::shared_ptr<NormalMatricesState> state = _normalMatrices(size);
+
+    return [state]() {
+        L3DMatrixBatch::normalMatrices(&state->matrixPtrs[0], &state->normalMatrixPtrs[0], state->matrixPtrs.size());
+
+        microBenchKeep(state->normalMatrices[0]);
+    };
+}
+
+L3D_MICROBENCH("matrices/normal", _normalMatrix, 10000);
+L3D_MICROBENCH("matrices/normalbatch", _normalMatrixBatch, 10000);
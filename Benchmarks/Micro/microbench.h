@@ -0,0 +1,69 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_MICROBENCH_H
+#define L3D_MICROBENCH_H
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// Work timed by a micro benchmark, called many times per sample.
+typedef std::function<void()> MicroBenchBody;
+
+// Build input data of a given problem size and return the work on it.
+// Setup is not timed.
+typedef MicroBenchBody (*MicroBenchSetup)(unsigned int size);
+
+struct MicroBench
+{
+    const char*     name;
+    MicroBenchSetup setup;
+    unsigned int    defaultSize;
+};
+
+std::vector<MicroBench>& microBenches();
+
+struct MicroBenchRegistrar
+{
+    MicroBenchRegistrar(const char* name, MicroBenchSetup setup, unsigned int defaultSize);
+};
+
+#define L3D_MICROBENCH_CONCAT2(a, b) a##b
+#define L3D_MICROBENCH_CONCAT(a, b) L3D_MICROBENCH_CONCAT2(a, b)
+
+// Register a benchmark, e.g. L3D_MICROBENCH("mesh/tangents", _tangents, 64).
+#define L3D_MICROBENCH(name, setup, defaultSize) \
+    static MicroBenchRegistrar L3D_MICROBENCH_CONCAT(_microBench, __LINE__)(name, setup, defaultSize)
+
+// Keep compiler from optimizing away results which are never read.
+template <typename T>
+inline void microBenchKeep(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static const volatile void* sink;
+    sink = &value;
+#endif
+}
+
+#endif // L3D_MICROBENCH_H
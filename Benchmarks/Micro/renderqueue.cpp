@@ -0,0 +1,152 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <stdlib.h>
+#include <memory>
+#include <vector>
+#include <leaf3d/L3DCommandBucket.h>
+#include <leaf3d/L3DMesh.h>
+#include "microbench.h"
+
+using namespace l3d;
+
+#define L3D_BENCH_BUCKETS 4
+
+static unsigned int _random(unsigned int& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// Keys laid out like the ones of renderer: sort key in upper 32 bits,
+// buffer id below.
+static unsigned long long _packetKey(unsigned int sortKey, unsigned int index)
+{
+    return ((unsigned long long)sortKey << 32)
+        | (index / 8 & 0xFFFFFF);
+}
+
+static std::vector<unsigned long long> _randomKeys(unsigned int count)
+{
+    std::vector<unsigned long long> keys(count);
+    unsigned int state = count;
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned int layer = _random(state) % 4 ? L3D_OPAQUE_MESH_RENDERLAYER : L3D_ALPHA_BLEND_MESH_RENDERLAYER;
+        unsigned int material = _random(state) % 64;
+        keys[i] = _packetKey((layer << 24) | material, _random(state));
+    }
+
+    return keys;
+}
+
+struct SortKeysState
+{
+    std::vector<L3DMesh*>   meshes;
+    float                   vertices[9];
+    unsigned char           renderLayer;
+
+    ~SortKeysState()
+    {
+        for (unsigned int i = 0; i < meshes.size(); ++i)
+            delete meshes[i];
+    }
+};
+
+// Moves all meshes to another render layer, which updates their sort keys,
+// and builds their draw packet keys.
+static MicroBenchBody _sortKeys(unsigned int size)
+{
+    std::shared_ptr<SortKeysState> state(new SortKeysState());
+
+    for (unsigned int i = 0; i < 9; ++i)
+        state->vertices[i] = (float)i;
+
+    state->renderLayer = L3D_OPAQUE_MESH_RENDERLAYER;
+    for (unsigned int i = 0; i < size; ++i)
+        state->meshes.push_back(new L3DMesh(0, state->vertices, 3, 0, 0, 0, L3D_VERTEX_POS3));
+
+    return [state]() {
+        state->renderLayer = state->renderLayer == L3D_OPAQUE_MESH_RENDERLAYER
+            ? L3D_ALPHA_BLEND_MESH_RENDERLAYER
+            : L3D_OPAQUE_MESH_RENDERLAYER;
+
+        unsigned long long keys = 0;
+        for (unsigned int i = 0; i < state->meshes.size(); ++i)
+        {
+            L3DMesh* mesh = state->meshes[i];
+            mesh->setRenderLayer(state->renderLayer);
+            keys ^= _packetKey(mesh->sortKey(), i);
+        }
+
+        microBenchKeep(keys);
+    };
+}
+
+struct BucketSortState
+{
+    std::vector<unsigned long long> keys;
+    L3DCommandBucket                buckets[L3D_BENCH_BUCKETS];
+    L3DDrawPacketList               packets;
+    L3DDrawPacketList               scratch;
+};
+
+// Fills buckets as recording threads do, then merges them in key order.
+static MicroBenchBody _bucketMerge(unsigned int size)
+{
+    std::shared_ptr<BucketSortState> state(new BucketSortState());
+    state->keys = _randomKeys(size);
+
+    return [state]() {
+        for (unsigned int b = 0; b < L3D_BENCH_BUCKETS; ++b)
+            state->buckets[b].clear();
+
+        for (unsigned int i = 0; i < state->keys.size(); ++i)
+            state->buckets[i % L3D_BENCH_BUCKETS].addPacket(state->keys[i], 0);
+
+        L3DCommandBucket::merge(state->buckets, L3D_BENCH_BUCKETS, state->packets, state->scratch);
+
+        microBenchKeep(state->packets[0]);
+    };
+}
+
+// Radix sort alone, on a fresh copy of unsorted packets.
+static MicroBenchBody _bucketSort(unsigned int size)
+{
+    std::shared_ptr<BucketSortState> state(new BucketSortState());
+    state->keys = _randomKeys(size);
+
+    for (unsigned int i = 0; i < size; ++i)
+        state->buckets[0].addPacket(state->keys[i], 0);
+
+    return [state]() {
+        state->packets = state->buckets[0].packets();
+
+        L3DCommandBucket::sort(state->packets, state->scratch);
+
+        microBenchKeep(state->packets[0]);
+    };
+}
+
+L3D_MICROBENCH("renderqueue/sortkeys", _sortKeys, 10000);
+L3D_MICROBENCH("renderqueue/bucketmerge", _bucketMerge, 10000);
+L3D_MICROBENCH("renderqueue/bucketsort", _bucketSort, 10000);
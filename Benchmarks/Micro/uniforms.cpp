@@ -0,0 +1,64 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <stdlib.h>
+#include <leaf3d/L3DShaderProgram.h>
+#include "microbench.h"
+
+using namespace l3d;
+
+// Uniforms don't free their values, release them here.
+static void _release(L3DUniform& uniform)
+{
+    if (uniform.type >= L3D_UNIFORM_VEC2)
+        free(uniform.value.valueVec2);
+}
+
+// Uniforms of all types, as set by materials. Size is uniforms of each
+// type.
+static MicroBenchBody _uniforms(unsigned int size)
+{
+    return [size]() {
+        for (unsigned int i = 0; i < size; ++i)
+        {
+            float k = (float)i;
+
+            L3DUniform uniforms[] = {
+                L3DUniform(k),
+                L3DUniform((int)i),
+                L3DUniform(i),
+                L3DUniform(i % 2 == 0),
+                L3DUniform(L3DVec2(k, 1)),
+                L3DUniform(L3DVec3(k, 1, 2)),
+                L3DUniform(L3DVec4(k, 1, 2, 3)),
+                L3DUniform(L3DMat3(k)),
+                L3DUniform(L3DMat4(k))
+            };
+
+            microBenchKeep(uniforms);
+
+            for (unsigned int u = 0; u < sizeof(uniforms) / sizeof(L3DUniform); ++u)
+                _release(uniforms[u]);
+        }
+    };
+}
+
+L3D_MICROBENCH("uniforms/construct", _uniforms, 1000);
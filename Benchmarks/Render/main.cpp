@@ -0,0 +1,644 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <leaf3d/leaf3d.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// Shader storage blocks and explicit locations need GLSL 4.30.
+#define GLSL_430(src) "#version 430 core\n" #src
+
+using namespace l3d;
+
+// Parameters of synthetic scene and run.
+struct BenchConfig
+{
+    unsigned int    meshes;
+    unsigned int    materials;
+    unsigned int    lights;
+    bool            instancing;
+    bool            indirect;
+    float           alphaShare;
+    unsigned int    frames;
+    unsigned int    warmupFrames;
+    unsigned int    width;
+    unsigned int    height;
+    unsigned int    seed;
+    L3DBackend      backend;
+    const char*     output;
+
+    BenchConfig()
+      : meshes(1000), materials(8), lights(4), instancing(false), indirect(false), alphaShare(0.1f),
+        frames(300), warmupFrames(30), width(640), height(480), seed(1),
+        backend(L3D_BACKEND_OPENGL), output(L3D_NULLPTR) {}
+};
+
+struct BenchResults
+{
+    std::vector<double>     cpuTimes;
+    std::vector<double>     gpuTimes;
+    L3DFrameStats           stats;
+    L3DFrameStats           opaqueStats;
+    L3DFrameStats           alphaStats;
+};
+
+static const char* _vertexShader = GLSL(
+    in vec3 i_position;
+    in vec3 i_normal;
+    in vec2 i_texcoord0;
+
+    layout(std140) uniform L3DFrame {
+        mat4 u_viewMat;
+        mat4 u_projMat;
+        mat4 u_vpMat;
+        vec3 u_cameraPos;
+    };
+
+    uniform mat4 u_modelMat;
+    uniform mat3 u_normalMat;
+
+    out vec3 o_position;
+    out vec3 o_normal;
+    out vec2 o_texcoord0;
+
+    void main()
+    {
+        vec4 position = u_modelMat * vec4(i_position, 1);
+        o_position = position.xyz;
+        o_normal = normalize(u_normalMat * i_normal);
+        o_texcoord0 = i_texcoord0;
+        gl_Position = u_vpMat * position;
+    }
+);
+
+static const char* _instancingVertexShader = GLSL(
+    in vec3 i_position;
+    in vec3 i_normal;
+    in vec2 i_texcoord0;
+    in mat4 i_instanceMat;
+
+    layout(std140) uniform L3DFrame {
+        mat4 u_viewMat;
+        mat4 u_projMat;
+        mat4 u_vpMat;
+        vec3 u_cameraPos;
+    };
+
+    uniform mat4 u_modelMat;
+    uniform mat3 u_normalMat;
+
+    out vec3 o_position;
+    out vec3 o_normal;
+    out vec2 o_texcoord0;
+
+    void main()
+    {
+        vec4 position = i_instanceMat * u_modelMat * vec4(i_position, 1);
+        o_position = position.xyz;
+        o_normal = normalize(mat3(i_instanceMat) * u_normalMat * i_normal);
+        o_texcoord0 = i_texcoord0;
+        gl_Position = u_vpMat * position;
+    }
+);
+
+// Matrices are read from "L3DDraws" block by draw id, so that meshes are
+// drawn by multi-draw indirect calls. Locations are those of arena VAOs.
+static const char* _indirectVertexShader = GLSL_430(
+    layout(location = 0) in vec3 i_position;
+    layout(location = 1) in vec3 i_normal;
+    layout(location = 3) in vec2 i_texcoord0;
+    layout(location = 10) in uint i_drawId;
+
+    layout(std140) uniform L3DFrame {
+        mat4 u_viewMat;
+        mat4 u_projMat;
+        mat4 u_vpMat;
+        vec3 u_cameraPos;
+    };
+
+    struct L3DDrawData {
+        mat4 modelMat;
+        mat4 normalMat;
+    };
+
+    layout(std430) readonly buffer L3DDraws {
+        L3DDrawData u_draws[];
+    };
+
+    out vec3 o_position;
+    out vec3 o_normal;
+    out vec2 o_texcoord0;
+
+    void main()
+    {
+        vec4 position = u_draws[i_drawId].modelMat * vec4(i_position, 1);
+        o_position = position.xyz;
+        o_normal = normalize(mat3(u_draws[i_drawId].normalMat) * i_normal);
+        o_texcoord0 = i_texcoord0;
+        gl_Position = u_vpMat * position;
+    }
+);
+
+static const char* _fragmentShader = GLSL(
+    struct Material {
+        vec3    ambient;
+        vec3    diffuse;
+        vec3    specular;
+        float   shininess;
+    };
+
+    struct Light {
+        int     type;
+        vec3    position;
+        vec3    direction;
+        vec4    color;
+        float   kc;
+        float   kl;
+        float   kq;
+    };
+
+    in vec3 o_position;
+    in vec3 o_normal;
+    in vec2 o_texcoord0;
+
+    out vec4 fragColor;
+
+    layout(std140) uniform L3DFrame {
+        mat4 u_viewMat;
+        mat4 u_projMat;
+        mat4 u_vpMat;
+        vec3 u_cameraPos;
+    };
+
+    uniform sampler2D   u_diffuseMap;
+    uniform Material    u_material;
+    uniform int         u_lightNr;
+    uniform Light       u_light[16];
+
+    void main()
+    {
+        vec3 normal = normalize(o_normal);
+        vec3 eye = normalize(u_cameraPos - o_position);
+        vec3 diffuse = u_material.diffuse * texture(u_diffuseMap, o_texcoord0).rgb;
+        vec3 color = u_material.ambient * 0.1;
+
+        for (int i = 0; i < min(u_lightNr, 16); ++i)
+        {
+            vec3 toLight = -u_light[i].direction;
+            float attenuation = 1.0;
+
+            if (u_light[i].type != 0)
+            {
+                float lightDistance = length(u_light[i].position - o_position);
+                toLight = (u_light[i].position - o_position) / lightDistance;
+                attenuation = 1.0 / (u_light[i].kc + u_light[i].kl * lightDistance + u_light[i].kq * lightDistance * lightDistance);
+            }
+
+            vec3 halfway = normalize(normalize(toLight) + eye);
+            float diffuseTerm = max(dot(normal, normalize(toLight)), 0.0);
+            float specularTerm = pow(max(dot(normal, halfway), 0.0), u_material.shininess);
+            vec3 light = u_light[i].color.rgb * u_light[i].color.a * attenuation;
+
+            color += (diffuse * diffuseTerm + u_material.specular * specularTerm) * light;
+        }
+
+        fragColor = vec4(color, 0.5);
+    }
+);
+
+static void _printUsage()
+{
+    fprintf(stderr,
+        "Usage: leaf3dBench [options]\n"
+        "  --meshes N        meshes in scene (1000)\n"
+        "  --materials M     materials shared by meshes (8)\n"
+        "  --lights K        point lights (4)\n"
+        "  --instancing 0|1  draw meshes of a material as instances (0)\n"
+        "  --indirect 0|1    draw meshes by multi-draw indirect calls, needs GL 4.3 (0)\n"
+        "  --alpha S         share of alpha blended meshes, 0 to 1 (0.1)\n"
+        "  --frames F        measured frames (300)\n"
+        "  --warmup W        frames rendered before measuring (30)\n"
+        "  --size WxH        size of render target (640x480)\n"
+        "  --seed S          seed of scene generator (1)\n"
+        "  --backend gl|null OpenGL calls are made or skipped, to time engine alone (gl)\n"
+        "  --output FILE     write JSON to file instead of stdout\n"
+    );
+}
+
+static bool _parseArgs(int argc, char** argv, BenchConfig& config)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : L3D_NULLPTR;
+
+        if (!strcmp(arg, "--help") || !value)
+            return false;
+
+        if (!strcmp(arg, "--meshes"))
+            config.meshes = atoi(value);
+        else if (!strcmp(arg, "--materials"))
+            config.materials = std::max(atoi(value), 1);
+        else if (!strcmp(arg, "--lights"))
+            config.lights = atoi(value);
+        else if (!strcmp(arg, "--instancing"))
+            config.instancing = atoi(value) != 0;
+        else if (!strcmp(arg, "--indirect"))
+            config.indirect = atoi(value) != 0;
+        else if (!strcmp(arg, "--alpha"))
+            config.alphaShare = std::min(std::max((float)atof(value), 0.0f), 1.0f);
+        else if (!strcmp(arg, "--frames"))
+            config.frames = std::max(atoi(value), 1);
+        else if (!strcmp(arg, "--warmup"))
+            config.warmupFrames = atoi(value);
+        else if (!strcmp(arg, "--size"))
+        {
+            if (sscanf(value, "%ux%u", &config.width, &config.height) != 2)
+                return false;
+        }
+        else if (!strcmp(arg, "--seed"))
+            config.seed = atoi(value);
+        else if (!strcmp(arg, "--backend"))
+        {
+            if (!strcmp(value, "gl"))
+                config.backend = L3D_BACKEND_OPENGL;
+            else if (!strcmp(value, "null"))
+                config.backend = L3D_BACKEND_NULL;
+            else
+                return false;
+        }
+        else if (!strcmp(arg, "--output"))
+            config.output = value;
+        else
+            return false;
+
+        ++i;
+    }
+
+    return true;
+}
+
+// Surfaceless EGL context, so that no window or GPU is needed.
+static bool _createContext(BenchConfig& config)
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, L3D_NULLPTR);
+
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        return false;
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_STENCIL_SIZE, 8,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig eglConfig;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &eglConfig, 1, &configCount) || configCount == 0)
+        return false;
+
+    const EGLint surfaceAttribs[] = {
+        EGL_WIDTH, (EGLint)config.width,
+        EGL_HEIGHT, (EGLint)config.height,
+        EGL_NONE
+    };
+
+    EGLSurface surface = eglCreatePbufferSurface(display, eglConfig, surfaceAttribs);
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        return false;
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    EGLContext context = eglCreateContext(display, eglConfig, EGL_NO_CONTEXT, contextAttribs);
+
+    // Falls back to any core profile the driver offers.
+    if (context == EGL_NO_CONTEXT)
+    {
+        const EGLint fallbackAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+
+        context = eglCreateContext(display, eglConfig, EGL_NO_CONTEXT, fallbackAttribs);
+
+        if (config.indirect)
+        {
+            fprintf(stderr, "OpenGL 4.3 is not available, drawing without indirect calls\n");
+            config.indirect = false;
+        }
+    }
+
+    return context != EGL_NO_CONTEXT && eglMakeCurrent(display, surface, surface, context);
+}
+
+// Small deterministic generator, so that scenes are the same everywhere.
+static float _random(unsigned int& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) / 16777216.0f;
+}
+
+static L3DHandle _loadCheckerTexture(unsigned int& state)
+{
+    unsigned char data[8 * 8 * 3];
+    unsigned char dark = (unsigned char)(64 + _random(state) * 64);
+
+    for (unsigned int i = 0; i < 8 * 8; ++i)
+    {
+        unsigned char value = ((i / 8 + i % 8) % 2) ? 255 : dark;
+        data[i * 3] = data[i * 3 + 1] = data[i * 3 + 2] = value;
+    }
+
+    return l3dLoadTexture(L3D_TEXTURE_2D, L3D_RGB, data, 8, 8, 0);
+}
+
+// Meshes are cubes spread in a box in front of camera, each material
+// shared by a run of them. Alpha blended meshes are picked at random.
+static void _loadScene(const BenchConfig& config)
+{
+    unsigned int state = config.seed;
+
+    const char* vertexShaderCode = config.instancing ? _instancingVertexShader : _vertexShader;
+    if (config.indirect)
+        vertexShaderCode = _indirectVertexShader;
+
+    L3DHandle vertexShader = l3dLoadShader(L3D_SHADER_VERTEX, vertexShaderCode);
+    L3DHandle fragmentShader = l3dLoadShader(L3D_SHADER_FRAGMENT, _fragmentShader);
+    L3DHandle shaderProgram = l3dLoadShaderProgram(vertexShader, fragmentShader);
+
+    std::vector<L3DHandle> materials;
+    std::vector<L3DHandle> firstMeshes[2];
+
+    for (unsigned int m = 0; m < config.materials; ++m)
+    {
+        L3DVec3 diffuse(0.2f + _random(state) * 0.8f, 0.2f + _random(state) * 0.8f, 0.2f + _random(state) * 0.8f);
+        L3DHandle material = l3dLoadMaterial("benchMaterial", shaderProgram, diffuse, L3DVec3(1, 1, 1), L3DVec3(1, 1, 1), 16.0f);
+        l3dAddTextureToMaterial(material, "diffuseMap", _loadCheckerTexture(state));
+        materials.push_back(material);
+    }
+
+    firstMeshes[0].resize(config.materials, L3D_INVALID_HANDLE);
+    firstMeshes[1].resize(config.materials, L3D_INVALID_HANDLE);
+
+    unsigned int side = 1;
+    while (side * side * side < config.meshes)
+        ++side;
+
+    for (unsigned int i = 0; i < config.meshes; ++i)
+    {
+        unsigned int m = i * config.materials / std::max(config.meshes, 1u);
+        bool alpha = _random(state) < config.alphaShare;
+        unsigned int renderLayer = alpha ? L3D_ALPHA_BLEND_MESH_RENDERLAYER : L3D_OPAQUE_MESH_RENDERLAYER;
+
+        L3DVec3 position(
+            (float)(i % side) - side * 0.5f,
+            (float)(i / side % side) - side * 0.5f,
+            -(float)(i / (side * side)) * 1.5f
+        );
+
+        L3DMat4 trans = glm::translate(L3DMat4(), position * 1.5f);
+        trans = glm::rotate(trans, _random(state) * 6.28f, L3DVec3(0, 1, 0));
+        trans = glm::scale(trans, L3DVec3(0.5f));
+
+        // Clones share geometry, so that meshes of a material are instanced.
+        L3DHandle& first = firstMeshes[alpha ? 1 : 0][m];
+
+        if (config.instancing && first.repr)
+        {
+            l3dCloneMesh(first, trans);
+        }
+        else
+        {
+            L3DHandle mesh = l3dLoadCube(materials[m], L3DVec2(1, 1), renderLayer);
+            l3dSetMeshTrans(mesh, trans);
+            if (!first.repr) first = mesh;
+        }
+    }
+
+    for (unsigned int l = 0; l < config.lights; ++l)
+    {
+        L3DVec3 position((_random(state) - 0.5f) * side * 1.5f, (_random(state) - 0.5f) * side * 1.5f, 2.0f);
+        L3DVec4 color(_random(state), _random(state), _random(state), 1.0f);
+        l3dLoadPointLight(position, color);
+    }
+}
+
+static double _percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+
+    std::sort(values.begin(), values.end());
+    unsigned int index = (unsigned int)(p * (values.size() - 1) + 0.5);
+
+    return values[index];
+}
+
+static void _writeTimes(FILE* out, const char* name, const std::vector<double>& times)
+{
+    double sum = 0;
+    for (std::vector<double>::const_iterator it = times.begin(); it != times.end(); ++it)
+        sum += *it;
+
+    fprintf(out, "  \"%s\": {\n", name);
+    fprintf(out, "    \"samples\": %u,\n", (unsigned int)times.size());
+    fprintf(out, "    \"mean\": %.4f,\n", times.empty() ? 0.0 : sum / times.size());
+    fprintf(out, "    \"min\": %.4f,\n", _percentile(times, 0));
+    fprintf(out, "    \"p50\": %.4f,\n", _percentile(times, 0.5));
+    fprintf(out, "    \"p90\": %.4f,\n", _percentile(times, 0.9));
+    fprintf(out, "    \"p99\": %.4f,\n", _percentile(times, 0.99));
+    fprintf(out, "    \"max\": %.4f\n", _percentile(times, 1));
+    fprintf(out, "  },\n");
+}
+
+static void _writeStats(FILE* out, const char* name, const L3DFrameStats& stats, bool last)
+{
+    fprintf(out, "    \"%s\": {", name);
+    fprintf(out, " \"drawCalls\": %u,", stats.drawCalls);
+    fprintf(out, " \"instancedDrawCalls\": %u,", stats.instancedDrawCalls);
+    fprintf(out, " \"triangles\": %u,", stats.triangles);
+    fprintf(out, " \"vertices\": %u,", stats.vertices);
+    fprintf(out, " \"shaderProgramBinds\": %u,", stats.shaderProgramBinds);
+    fprintf(out, " \"vertexArrayBinds\": %u,", stats.vertexArrayBinds);
+    fprintf(out, " \"textureBinds\": %u,", stats.textureBinds);
+    fprintf(out, " \"uniformUploads\": %u,", stats.uniformUploads);
+    fprintf(out, " \"frameBufferSwitches\": %u,", stats.frameBufferSwitches);
+    fprintf(out, " \"mipmapRegenerations\": %u,", stats.mipmapRegenerations);
+    fprintf(out, " \"culledMeshes\": %u,", stats.culledMeshes);
+    fprintf(out, " \"uploadedBytes\": %u }%s\n", stats.uploadedBytes, last ? "" : ",");
+}
+
+static void _writeResults(FILE* out, const BenchConfig& config, const BenchResults& results)
+{
+    fprintf(out, "{\n");
+    fprintf(out, "  \"renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+    fprintf(out, "  \"scene\": {\n");
+    fprintf(out, "    \"meshes\": %u,\n", config.meshes);
+    fprintf(out, "    \"materials\": %u,\n", config.materials);
+    fprintf(out, "    \"lights\": %u,\n", config.lights);
+    fprintf(out, "    \"instancing\": %s,\n", config.instancing ? "true" : "false");
+    fprintf(out, "    \"indirect\": %s,\n", config.indirect ? "true" : "false");
+    fprintf(out, "    \"alphaShare\": %.3f,\n", config.alphaShare);
+    fprintf(out, "    \"width\": %u,\n", config.width);
+    fprintf(out, "    \"height\": %u,\n", config.height);
+    fprintf(out, "    \"seed\": %u\n", config.seed);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"frames\": %u,\n", config.frames);
+    _writeTimes(out, "cpuFrameMs", results.cpuTimes);
+    _writeTimes(out, "gpuFrameMs", results.gpuTimes);
+    // Last frames are never read back, others when GPU was too far behind.
+    fprintf(out, "  \"framesWithoutGpuTime\": %u,\n", config.frames - (unsigned int)results.gpuTimes.size());
+    fprintf(out, "  \"lastFrame\": {\n");
+    _writeStats(out, "total", results.stats, false);
+    _writeStats(out, "opaque", results.opaqueStats, false);
+    _writeStats(out, "alphaBlend", results.alphaStats, true);
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+
+    if (!_parseArgs(argc, argv, config)) {
+        _printUsage();
+        return -1;
+    }
+
+    // Null backend needs no context at all, and reports OpenGL 3.3.
+    if (config.backend != L3D_BACKEND_OPENGL && config.indirect)
+    {
+        fprintf(stderr, "Null backend has no indirect calls, drawing without them\n");
+        config.indirect = false;
+    }
+
+    if (config.backend == L3D_BACKEND_OPENGL && !_createContext(config)) {
+        fprintf(stderr, "Failed to create headless OpenGL context\n");
+        return -2;
+    }
+
+    if (l3dInit(config.backend) != L3D_TRUE) {
+        fprintf(stderr, "Failed to initialize leaf3d\n");
+        return -3;
+    }
+
+    _loadScene(config);
+
+    L3DHandle camera = l3dLoadCamera(
+        "Default",
+        glm::lookAt(glm::vec3(0, 0, 20), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)),
+        glm::perspective(45.0f, (float)config.width / config.height, 1.0f, 500.0f)
+    );
+
+    L3DHandle renderQueue = l3dLoadForwardRenderQueue(config.width, config.height, L3DVec4(0.1f, 0.1f, 0.1f, 1));
+
+    l3dSetGpuTiming(config.backend == L3D_BACKEND_OPENGL);
+
+    BenchResults results;
+    unsigned int lastGpuFrame = 0;
+    L3DGpuTiming timings[L3D_MAX_GPU_TIMINGS];
+
+    for (unsigned int f = 0; f < config.warmupFrames + config.frames; ++f)
+    {
+        // Camera turns a little, so that culling and sorting have work.
+        l3dRotateCamera(camera, 0.002f);
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        l3dRenderFrame(camera, renderQueue);
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+        if (f < config.warmupFrames)
+            continue;
+
+        results.cpuTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+        // GPU results arrive some frames later, each frame is taken once.
+        // First ones read after warmup still belong to warmup frames. First
+        // frame is never taken, its first query reads garbage on llvmpipe.
+        unsigned int count = std::min(l3dGetGpuTimings(timings, L3D_MAX_GPU_TIMINGS), (unsigned int)L3D_MAX_GPU_TIMINGS);
+
+        if (count > 0 && timings[0].frameIndex != lastGpuFrame && timings[0].frameIndex > std::max(config.warmupFrames, 1u))
+        {
+            double gpuTime = 0;
+            for (unsigned int i = 0; i < count; ++i)
+                gpuTime += timings[i].milliseconds;
+
+            results.gpuTimes.push_back(gpuTime);
+            lastGpuFrame = timings[0].frameIndex;
+        }
+    }
+
+    glFinish();
+
+    results.stats = l3dGetFrameStats();
+    results.opaqueStats = l3dGetRenderLayerStats(L3D_OPAQUE_MESH_RENDERLAYER);
+    results.alphaStats = l3dGetRenderLayerStats(L3D_ALPHA_BLEND_MESH_RENDERLAYER);
+
+    FILE* out = config.output ? fopen(config.output, "w") : stdout;
+
+    if (!out) {
+        fprintf(stderr, "Failed to open %s\n", config.output);
+        l3dTerminate();
+        return -4;
+    }
+
+    _writeResults(out, config, results);
+
+    if (out != stdout)
+        fclose(out);
+
+    l3dTerminate();
+
+    return 0;
+}
@@ -0,0 +1,525 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <algorithm>
+#include <leaf3d/L3DFrustum.h>
+#include <leaf3d/L3DBVH.h>
+
+using namespace l3d;
+
+L3DBVH::L3DBVH() :
+    m_root(L3D_BVH_NULL_NODE),
+    m_freeList(L3D_BVH_NULL_NODE),
+    m_leafCount(0)
+{
+}
+
+int L3DBVH::insert(const L3DAABB& aabb, void* userData)
+{
+    int proxy = this->allocateNode();
+    L3DVec3 margin(L3D_BVH_AABB_MARGIN, L3D_BVH_AABB_MARGIN, L3D_BVH_AABB_MARGIN);
+
+    m_nodes[proxy].aabb = L3DAABB(aabb.min - margin, aabb.max + margin);
+    m_nodes[proxy].userData = userData;
+    m_nodes[proxy].height = 0;
+
+    this->insertLeaf(proxy);
+    ++m_leafCount;
+
+    return proxy;
+}
+
+void L3DBVH::remove(int proxy)
+{
+    if (proxy < 0 || proxy >= (int)m_nodes.size() || !m_nodes[proxy].isLeaf())
+        return;
+
+    this->removeLeaf(proxy);
+    this->freeNode(proxy);
+    --m_leafCount;
+}
+
+bool L3DBVH::move(int proxy, const L3DAABB& aabb)
+{
+    // Still inside enlarged bounds, nothing to do.
+    if (m_nodes[proxy].aabb.contains(aabb))
+        return false;
+
+    this->removeLeaf(proxy);
+
+    L3DVec3 margin(L3D_BVH_AABB_MARGIN, L3D_BVH_AABB_MARGIN, L3D_BVH_AABB_MARGIN);
+    m_nodes[proxy].aabb = L3DAABB(aabb.min - margin, aabb.max + margin);
+
+    this->insertLeaf(proxy);
+
+    return true;
+}
+
+void L3DBVH::clear()
+{
+    m_nodes.clear();
+    m_root = L3D_BVH_NULL_NODE;
+    m_freeList = L3D_BVH_NULL_NODE;
+    m_leafCount = 0;
+}
+
+void L3DBVH::query(const L3DAABB& aabb, std::vector<int>& proxies) const
+{
+    if (m_root == L3D_BVH_NULL_NODE)
+        return;
+
+    std::vector<int> stack;
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        int nodeId = stack.back();
+        stack.pop_back();
+
+        const L3DBVHNode& node = m_nodes[nodeId];
+
+        if (!node.aabb.overlaps(aabb))
+            continue;
+
+        if (node.isLeaf())
+        {
+            proxies.push_back(nodeId);
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+void L3DBVH::query(const L3DBoundingSphere& sphere, std::vector<int>& proxies) const
+{
+    if (m_root == L3D_BVH_NULL_NODE)
+        return;
+
+    std::vector<int> stack;
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        int nodeId = stack.back();
+        stack.pop_back();
+
+        const L3DBVHNode& node = m_nodes[nodeId];
+
+        if (!node.aabb.overlaps(sphere))
+            continue;
+
+        if (node.isLeaf())
+        {
+            proxies.push_back(nodeId);
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+void L3DBVH::query(
+    const L3DVec3& origin,
+    const L3DVec3& direction,
+    float maxDistance,
+    std::vector<int>& proxies
+) const
+{
+    if (m_root == L3D_BVH_NULL_NODE)
+        return;
+
+    L3DVec3 invDirection = 1.0f / direction;
+
+    std::vector<int> stack;
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        int nodeId = stack.back();
+        stack.pop_back();
+
+        const L3DBVHNode& node = m_nodes[nodeId];
+
+        if (!node.aabb.intersects(origin, invDirection, maxDistance))
+            continue;
+
+        if (node.isLeaf())
+        {
+            proxies.push_back(nodeId);
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+void L3DBVH::query(
+    const L3DFrustum& frustum,
+    std::vector<int>& inside,
+    std::vector<int>& intersecting
+) const
+{
+    if (m_root == L3D_BVH_NULL_NODE)
+        return;
+
+    std::vector<int> stack;
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        int nodeId = stack.back();
+        stack.pop_back();
+
+        const L3DBVHNode& node = m_nodes[nodeId];
+        L3DFrustum::L3DFrustumTest test = frustum.classify(node.aabb);
+
+        if (test == L3DFrustum::L3D_FRUSTUM_OUTSIDE)
+            continue;
+
+        // Whole subtree is visible, no need to test it any further.
+        if (test == L3DFrustum::L3D_FRUSTUM_INSIDE)
+        {
+            this->collectLeaves(nodeId, inside);
+        }
+        else if (node.isLeaf())
+        {
+            intersecting.push_back(nodeId);
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+int L3DBVH::allocateNode()
+{
+    int nodeId = m_freeList;
+
+    if (nodeId == L3D_BVH_NULL_NODE)
+    {
+        nodeId = m_nodes.size();
+        m_nodes.push_back(L3DBVHNode());
+    }
+    else
+    {
+        m_freeList = m_nodes[nodeId].parent;
+    }
+
+    L3DBVHNode& node = m_nodes[nodeId];
+    node.userData = L3D_NULLPTR;
+    node.parent = L3D_BVH_NULL_NODE;
+    node.child1 = L3D_BVH_NULL_NODE;
+    node.child2 = L3D_BVH_NULL_NODE;
+    node.height = 0;
+
+    return nodeId;
+}
+
+void L3DBVH::freeNode(int node)
+{
+    // Free nodes are chained through their parent index.
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+void L3DBVH::insertLeaf(int leaf)
+{
+    if (m_root == L3D_BVH_NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[m_root].parent = L3D_BVH_NULL_NODE;
+        return;
+    }
+
+    // Finds best sibling, by surface area heuristic.
+    L3DAABB leafAABB = m_nodes[leaf].aabb;
+    int index = m_root;
+
+    while (!m_nodes[index].isLeaf())
+    {
+        int child1 = m_nodes[index].child1;
+        int child2 = m_nodes[index].child2;
+
+        float area = m_nodes[index].aabb.area();
+        float combinedArea = L3DAABB::merge(m_nodes[index].aabb, leafAABB).area();
+
+        // Cost of creating a new parent for this node and the new leaf.
+        float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree.
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float cost1 = L3DAABB::merge(leafAABB, m_nodes[child1].aabb).area() + inheritanceCost;
+        if (!m_nodes[child1].isLeaf())
+            cost1 -= m_nodes[child1].aabb.area();
+
+        float cost2 = L3DAABB::merge(leafAABB, m_nodes[child2].aabb).area() + inheritanceCost;
+        if (!m_nodes[child2].isLeaf())
+            cost2 -= m_nodes[child2].aabb.area();
+
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = (cost1 < cost2) ? child1 : child2;
+    }
+
+    int sibling = index;
+
+    // Creates a new parent.
+    int oldParent = m_nodes[sibling].parent;
+    int newParent = this->allocateNode();
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].aabb = L3DAABB::merge(leafAABB, m_nodes[sibling].aabb);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent != L3D_BVH_NULL_NODE)
+    {
+        if (m_nodes[oldParent].child1 == sibling)
+            m_nodes[oldParent].child1 = newParent;
+        else
+            m_nodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    // Walks back up, fixing heights and bounds.
+    index = m_nodes[leaf].parent;
+    while (index != L3D_BVH_NULL_NODE)
+    {
+        index = this->balance(index);
+
+        int child1 = m_nodes[index].child1;
+        int child2 = m_nodes[index].child2;
+
+        m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+        m_nodes[index].aabb = L3DAABB::merge(m_nodes[child1].aabb, m_nodes[child2].aabb);
+
+        index = m_nodes[index].parent;
+    }
+}
+
+void L3DBVH::removeLeaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = L3D_BVH_NULL_NODE;
+        return;
+    }
+
+    int parent = m_nodes[leaf].parent;
+    int grandParent = m_nodes[parent].parent;
+    int sibling = (m_nodes[parent].child1 == leaf) ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent != L3D_BVH_NULL_NODE)
+    {
+        // Replaces parent with sibling.
+        if (m_nodes[grandParent].child1 == parent)
+            m_nodes[grandParent].child1 = sibling;
+        else
+            m_nodes[grandParent].child2 = sibling;
+
+        m_nodes[sibling].parent = grandParent;
+        this->freeNode(parent);
+
+        // Adjusts ancestor bounds.
+        int index = grandParent;
+        while (index != L3D_BVH_NULL_NODE)
+        {
+            index = this->balance(index);
+
+            int child1 = m_nodes[index].child1;
+            int child2 = m_nodes[index].child2;
+
+            m_nodes[index].aabb = L3DAABB::merge(m_nodes[child1].aabb, m_nodes[child2].aabb);
+            m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+
+            index = m_nodes[index].parent;
+        }
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = L3D_BVH_NULL_NODE;
+        this->freeNode(parent);
+    }
+}
+
+int L3DBVH::balance(int iA)
+{
+    // Performs a left or right rotation if node A is imbalanced.
+    // Return the new root index.
+    L3DBVHNode* A = &m_nodes[iA];
+    if (A->isLeaf() || A->height < 2)
+        return iA;
+
+    int iB = A->child1;
+    int iC = A->child2;
+    L3DBVHNode* B = &m_nodes[iB];
+    L3DBVHNode* C = &m_nodes[iC];
+
+    int balance = C->height - B->height;
+
+    // Rotates C up.
+    if (balance > 1)
+    {
+        int iF = C->child1;
+        int iG = C->child2;
+        L3DBVHNode* F = &m_nodes[iF];
+        L3DBVHNode* G = &m_nodes[iG];
+
+        // Swaps A and C.
+        C->child1 = iA;
+        C->parent = A->parent;
+        A->parent = iC;
+
+        // A's old parent should point to C.
+        if (C->parent != L3D_BVH_NULL_NODE)
+        {
+            if (m_nodes[C->parent].child1 == iA)
+                m_nodes[C->parent].child1 = iC;
+            else
+                m_nodes[C->parent].child2 = iC;
+        }
+        else
+        {
+            m_root = iC;
+        }
+
+        // Rotates.
+        if (F->height > G->height)
+        {
+            C->child2 = iF;
+            A->child2 = iG;
+            G->parent = iA;
+            A->aabb = L3DAABB::merge(B->aabb, G->aabb);
+            C->aabb = L3DAABB::merge(A->aabb, F->aabb);
+
+            A->height = 1 + std::max(B->height, G->height);
+            C->height = 1 + std::max(A->height, F->height);
+        }
+        else
+        {
+            C->child2 = iG;
+            A->child2 = iF;
+            F->parent = iA;
+            A->aabb = L3DAABB::merge(B->aabb, F->aabb);
+            C->aabb = L3DAABB::merge(A->aabb, G->aabb);
+
+            A->height = 1 + std::max(B->height, F->height);
+            C->height = 1 + std::max(A->height, G->height);
+        }
+
+        return iC;
+    }
+
+    // Rotates B up.
+    if (balance < -1)
+    {
+        int iD = B->child1;
+        int iE = B->child2;
+        L3DBVHNode* D = &m_nodes[iD];
+        L3DBVHNode* E = &m_nodes[iE];
+
+        // Swaps A and B.
+        B->child1 = iA;
+        B->parent = A->parent;
+        A->parent = iB;
+
+        // A's old parent should point to B.
+        if (B->parent != L3D_BVH_NULL_NODE)
+        {
+            if (m_nodes[B->parent].child1 == iA)
+                m_nodes[B->parent].child1 = iB;
+            else
+                m_nodes[B->parent].child2 = iB;
+        }
+        else
+        {
+            m_root = iB;
+        }
+
+        // Rotates.
+        if (D->height > E->height)
+        {
+            B->child2 = iD;
+            A->child1 = iE;
+            E->parent = iA;
+            A->aabb = L3DAABB::merge(C->aabb, E->aabb);
+            B->aabb = L3DAABB::merge(A->aabb, D->aabb);
+
+            A->height = 1 + std::max(C->height, E->height);
+            B->height = 1 + std::max(A->height, D->height);
+        }
+        else
+        {
+            B->child2 = iE;
+            A->child1 = iD;
+            D->parent = iA;
+            A->aabb = L3DAABB::merge(C->aabb, D->aabb);
+            B->aabb = L3DAABB::merge(A->aabb, E->aabb);
+
+            A->height = 1 + std::max(C->height, D->height);
+            B->height = 1 + std::max(A->height, E->height);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
+
+void L3DBVH::collectLeaves(int node, std::vector<int>& proxies) const
+{
+    std::vector<int> stack;
+    stack.push_back(node);
+
+    while (!stack.empty())
+    {
+        int nodeId = stack.back();
+        stack.pop_back();
+
+        if (m_nodes[nodeId].isLeaf())
+        {
+            proxies.push_back(nodeId);
+        }
+        else
+        {
+            stack.push_back(m_nodes[nodeId].child1);
+            stack.push_back(m_nodes[nodeId].child2);
+        }
+    }
+}
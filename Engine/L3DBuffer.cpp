@@ -36,10 +36,17 @@ L3DBuffer::L3DBuffer(
     m_data(0),
     m_size(size),
     m_stride(stride),
-    m_drawType(drawType)
+    m_drawType(drawType),
+    m_arena(L3D_NULLPTR),
+    m_block(L3D_INVALID_BLOCK),
+    m_dirtyBegin(0),
+    m_dirtyEnd(0),
+    m_dirtyFrames(0)
 {
     if (data)
         m_data = memcpy(malloc(size), data, size);
+    else if (size)
+        m_data = calloc(1, size);
 
     if (renderer) renderer->addBuffer(this);
 }
@@ -48,3 +55,39 @@ L3DBuffer::~L3DBuffer()
 {
     free(m_data);
 }
+
+unsigned int L3DBuffer::offset() const
+{
+    if (!m_arena)
+        return 0;
+
+    // Ring arenas are read from region of current frame.
+    return m_arena->allocator.offset(m_block) + m_arena->region * m_arena->allocator.capacity();
+}
+
+void L3DBuffer::update(
+    const void* data,
+    unsigned int offset,
+    unsigned int size
+)
+{
+    if (!data || offset >= m_size)
+        return;
+
+    if (size > m_size - offset)
+        size = m_size - offset;
+
+    memcpy(static_cast<char*>(m_data) + offset, data, size);
+
+    this->invalidate(offset, size);
+}
+
+void L3DBuffer::invalidate(
+    unsigned int offset,
+    unsigned int size
+)
+{
+    L3DRenderer* renderer = this->renderer();
+    if (renderer && this->id())
+        renderer->invalidateBuffer(this, offset, size);
+}
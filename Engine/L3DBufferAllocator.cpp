@@ -0,0 +1,410 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DBufferAllocator.h>
+
+using namespace l3d;
+
+static unsigned int _mostSignificantBit(unsigned int value)
+{
+    unsigned int bit = 0;
+    while (value >>= 1)
+        ++bit;
+    return bit;
+}
+
+static unsigned int _leastSignificantBit(unsigned int value)
+{
+    unsigned int bit = 0;
+    while (!(value & 1))
+    {
+        value >>= 1;
+        ++bit;
+    }
+    return bit;
+}
+
+static void _mapping(unsigned int size, unsigned int* fl, unsigned int* sl)
+{
+    // Small sizes share first class, split linearly.
+    if (size < L3D_TLSF_SL_COUNT)
+    {
+        *fl = 0;
+        *sl = size;
+    }
+    else
+    {
+        unsigned int msb = _mostSignificantBit(size);
+        *fl = msb - L3D_TLSF_SL_BITS + 1;
+        *sl = (size >> (msb - L3D_TLSF_SL_BITS)) ^ L3D_TLSF_SL_COUNT;
+    }
+}
+
+L3DBufferAllocator::L3DBufferAllocator(unsigned int capacity)
+{
+    this->clear();
+    this->grow(capacity);
+}
+
+void L3DBufferAllocator::clear()
+{
+    m_blocks.clear();
+    m_unusedBlocks.clear();
+
+    for (unsigned int fl = 0; fl < L3D_TLSF_FL_COUNT; ++fl)
+    {
+        for (unsigned int sl = 0; sl < L3D_TLSF_SL_COUNT; ++sl)
+            m_freeLists[fl][sl] = L3D_INVALID_BLOCK;
+        m_slBitmaps[fl] = 0;
+    }
+
+    m_flBitmap = 0;
+    m_firstBlock = L3D_INVALID_BLOCK;
+    m_lastBlock = L3D_INVALID_BLOCK;
+    m_capacity = 0;
+    m_usedSize = 0;
+    m_allocationCount = 0;
+    m_freeBlockCount = 0;
+}
+
+int L3DBufferAllocator::allocate(unsigned int size)
+{
+    if (size == 0)
+        return L3D_INVALID_BLOCK;
+
+    int block = this->findFreeBlock(size);
+
+    if (block == L3D_INVALID_BLOCK)
+        return L3D_INVALID_BLOCK;
+
+    this->removeFreeBlock(block);
+
+    // Splits remaining space in a new free block.
+    if (m_blocks[block].size > size)
+    {
+        int remainder = this->createBlock(m_blocks[block].offset + size, m_blocks[block].size - size);
+        int next = m_blocks[block].nextPhysical;
+
+        m_blocks[remainder].prevPhysical = block;
+        m_blocks[remainder].nextPhysical = next;
+        if (next != L3D_INVALID_BLOCK)
+            m_blocks[next].prevPhysical = remainder;
+        else
+            m_lastBlock = remainder;
+
+        m_blocks[block].nextPhysical = remainder;
+        m_blocks[block].size = size;
+
+        this->insertFreeBlock(remainder);
+    }
+
+    m_usedSize += size;
+    ++m_allocationCount;
+
+    return block;
+}
+
+void L3DBufferAllocator::release(int block)
+{
+    if (block < 0 || block >= (int)m_blocks.size() || !m_blocks[block].isUsed || m_blocks[block].isFree)
+        return;
+
+    m_usedSize -= m_blocks[block].size;
+    --m_allocationCount;
+
+    // Merges with free neighbours.
+    int prev = m_blocks[block].prevPhysical;
+    if (prev != L3D_INVALID_BLOCK && m_blocks[prev].isFree)
+    {
+        this->removeFreeBlock(prev);
+
+        m_blocks[prev].size += m_blocks[block].size;
+        m_blocks[prev].nextPhysical = m_blocks[block].nextPhysical;
+        if (m_blocks[block].nextPhysical != L3D_INVALID_BLOCK)
+            m_blocks[m_blocks[block].nextPhysical].prevPhysical = prev;
+        else
+            m_lastBlock = prev;
+
+        this->destroyBlock(block);
+        block = prev;
+    }
+
+    int next = m_blocks[block].nextPhysical;
+    if (next != L3D_INVALID_BLOCK && m_blocks[next].isFree)
+    {
+        this->removeFreeBlock(next);
+
+        m_blocks[block].size += m_blocks[next].size;
+        m_blocks[block].nextPhysical = m_blocks[next].nextPhysical;
+        if (m_blocks[next].nextPhysical != L3D_INVALID_BLOCK)
+            m_blocks[m_blocks[next].nextPhysical].prevPhysical = block;
+        else
+            m_lastBlock = block;
+
+        this->destroyBlock(next);
+    }
+
+    this->insertFreeBlock(block);
+}
+
+void L3DBufferAllocator::grow(unsigned int capacity)
+{
+    if (capacity <= m_capacity)
+        return;
+
+    unsigned int extra = capacity - m_capacity;
+
+    // Extends last block if free, appends a new one otherwise.
+    if (m_lastBlock != L3D_INVALID_BLOCK && m_blocks[m_lastBlock].isFree)
+    {
+        this->removeFreeBlock(m_lastBlock);
+        m_blocks[m_lastBlock].size += extra;
+        this->insertFreeBlock(m_lastBlock);
+    }
+    else
+    {
+        int block = this->createBlock(m_capacity, extra);
+
+        m_blocks[block].prevPhysical = m_lastBlock;
+        if (m_lastBlock != L3D_INVALID_BLOCK)
+            m_blocks[m_lastBlock].nextPhysical = block;
+        else
+            m_firstBlock = block;
+        m_lastBlock = block;
+
+        this->insertFreeBlock(block);
+    }
+
+    m_capacity = capacity;
+}
+
+void L3DBufferAllocator::defragment(std::vector<L3DBufferMove>& moves)
+{
+    unsigned int cursor = 0;
+    int prev = L3D_INVALID_BLOCK;
+    int block = m_firstBlock;
+
+    m_firstBlock = L3D_INVALID_BLOCK;
+
+    // Relinks used blocks in order, dropping free ones.
+    while (block != L3D_INVALID_BLOCK)
+    {
+        int next = m_blocks[block].nextPhysical;
+
+        if (m_blocks[block].isFree)
+        {
+            this->removeFreeBlock(block);
+            this->destroyBlock(block);
+        }
+        else
+        {
+            if (m_blocks[block].offset != cursor)
+            {
+                L3DBufferMove move;
+                move.block = block;
+                move.srcOffset = m_blocks[block].offset;
+                move.dstOffset = cursor;
+                move.size = m_blocks[block].size;
+                moves.push_back(move);
+
+                m_blocks[block].offset = cursor;
+            }
+
+            m_blocks[block].prevPhysical = prev;
+            if (prev != L3D_INVALID_BLOCK)
+                m_blocks[prev].nextPhysical = block;
+            else
+                m_firstBlock = block;
+
+            cursor += m_blocks[block].size;
+            prev = block;
+        }
+
+        block = next;
+    }
+
+    if (prev != L3D_INVALID_BLOCK)
+        m_blocks[prev].nextPhysical = L3D_INVALID_BLOCK;
+    m_lastBlock = prev;
+
+    // Free space is left in a single block at the end.
+    unsigned int capacity = m_capacity;
+    m_capacity = cursor;
+    this->grow(capacity);
+}
+
+unsigned int L3DBufferAllocator::largestFreeBlock() const
+{
+    if (!m_flBitmap)
+        return 0;
+
+    // Only blocks of highest non empty class can be the largest ones.
+    unsigned int fl = _mostSignificantBit(m_flBitmap);
+    unsigned int sl = _mostSignificantBit(m_slBitmaps[fl]);
+    unsigned int largest = 0;
+
+    for (int block = m_freeLists[fl][sl]; block != L3D_INVALID_BLOCK; block = m_blocks[block].nextFree)
+    {
+        if (m_blocks[block].size > largest)
+            largest = m_blocks[block].size;
+    }
+
+    return largest;
+}
+
+float L3DBufferAllocator::fragmentation() const
+{
+    unsigned int freeSize = this->freeSize();
+
+    if (freeSize == 0)
+        return 0.0f;
+
+    return 1.0f - (float)this->largestFreeBlock() / (float)freeSize;
+}
+
+int L3DBufferAllocator::createBlock(unsigned int offset, unsigned int size)
+{
+    int block;
+
+    if (!m_unusedBlocks.empty())
+    {
+        block = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+    }
+    else
+    {
+        block = m_blocks.size();
+        m_blocks.push_back(Block());
+    }
+
+    Block& b = m_blocks[block];
+    b.offset = offset;
+    b.size = size;
+    b.prevPhysical = L3D_INVALID_BLOCK;
+    b.nextPhysical = L3D_INVALID_BLOCK;
+    b.prevFree = L3D_INVALID_BLOCK;
+    b.nextFree = L3D_INVALID_BLOCK;
+    b.isFree = false;
+    b.isUsed = true;
+
+    return block;
+}
+
+void L3DBufferAllocator::destroyBlock(int block)
+{
+    m_blocks[block].isUsed = false;
+    m_blocks[block].isFree = false;
+    m_unusedBlocks.push_back(block);
+}
+
+void L3DBufferAllocator::insertFreeBlock(int block)
+{
+    unsigned int fl, sl;
+    _mapping(m_blocks[block].size, &fl, &sl);
+
+    int head = m_freeLists[fl][sl];
+
+    m_blocks[block].isFree = true;
+    m_blocks[block].prevFree = L3D_INVALID_BLOCK;
+    m_blocks[block].nextFree = head;
+    if (head != L3D_INVALID_BLOCK)
+        m_blocks[head].prevFree = block;
+
+    m_freeLists[fl][sl] = block;
+    m_flBitmap |= (1u << fl);
+    m_slBitmaps[fl] |= (1u << sl);
+
+    ++m_freeBlockCount;
+}
+
+void L3DBufferAllocator::removeFreeBlock(int block)
+{
+    unsigned int fl, sl;
+    _mapping(m_blocks[block].size, &fl, &sl);
+
+    int prev = m_blocks[block].prevFree;
+    int next = m_blocks[block].nextFree;
+
+    if (prev != L3D_INVALID_BLOCK)
+        m_blocks[prev].nextFree = next;
+    if (next != L3D_INVALID_BLOCK)
+        m_blocks[next].prevFree = prev;
+
+    if (m_freeLists[fl][sl] == block)
+    {
+        m_freeLists[fl][sl] = next;
+
+        if (next == L3D_INVALID_BLOCK)
+        {
+            m_slBitmaps[fl] &= ~(1u << sl);
+            if (!m_slBitmaps[fl])
+                m_flBitmap &= ~(1u << fl);
+        }
+    }
+
+    m_blocks[block].isFree = false;
+    m_blocks[block].prevFree = L3D_INVALID_BLOCK;
+    m_blocks[block].nextFree = L3D_INVALID_BLOCK;
+
+    --m_freeBlockCount;
+}
+
+int L3DBufferAllocator::findFreeBlock(unsigned int size) const
+{
+    unsigned int fl, sl;
+    unsigned int roundedSize = size;
+
+    // Rounds size up to next class, so that any block found fits.
+    if (size >= L3D_TLSF_SL_COUNT)
+    {
+        unsigned int round = (1u << (_mostSignificantBit(size) - L3D_TLSF_SL_BITS)) - 1;
+        if (size + round > size)
+            roundedSize += round;
+    }
+
+    _mapping(roundedSize, &fl, &sl);
+
+    unsigned int slMap = m_slBitmaps[fl] & (~0u << sl);
+
+    if (!slMap)
+    {
+        unsigned int flMap = (fl + 1 < L3D_TLSF_FL_COUNT) ? (m_flBitmap & (~0u << (fl + 1))) : 0;
+        if (flMap)
+        {
+            fl = _leastSignificantBit(flMap);
+            slMap = m_slBitmaps[fl];
+        }
+    }
+
+    if (slMap)
+        return m_freeLists[fl][_leastSignificantBit(slMap)];
+
+    // Falls back to blocks of same class, which may still be large enough.
+    _mapping(size, &fl, &sl);
+
+    for (int block = m_freeLists[fl][sl]; block != L3D_INVALID_BLOCK; block = m_blocks[block].nextFree)
+    {
+        if (m_blocks[block].size >= size)
+            return block;
+    }
+
+    return L3D_INVALID_BLOCK;
+}
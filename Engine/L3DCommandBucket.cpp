@@ -0,0 +1,101 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <string.h>
+#include <leaf3d/L3DCommandBucket.h>
+
+using namespace l3d;
+
+void L3DCommandBucket::merge(
+    const L3DCommandBucket* buckets,
+    unsigned int bucketCount,
+    L3DDrawPacketList& packets,
+    L3DDrawPacketList& scratch
+)
+{
+    unsigned int count = 0;
+    for (unsigned int b = 0; b < bucketCount; ++b)
+        count += buckets[b].packetCount();
+
+    packets.clear();
+    packets.reserve(count);
+
+    for (unsigned int b = 0; b < bucketCount; ++b)
+        packets.insert(packets.end(), buckets[b].m_packets.begin(), buckets[b].m_packets.end());
+
+    L3DCommandBucket::sort(packets, scratch);
+}
+
+void L3DCommandBucket::sort(
+    L3DDrawPacketList& packets,
+    L3DDrawPacketList& scratch
+)
+{
+    unsigned int count = packets.size();
+
+    if (count < 2)
+        return;
+
+    // Counts all bytes in a single pass.
+    unsigned int histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned long long key = packets[i].key;
+        for (unsigned int b = 0; b < 8; ++b)
+            ++histograms[b][(key >> (b * 8)) & 0xFF];
+    }
+
+    scratch.resize(count);
+
+    L3DDrawPacket* src = &packets[0];
+    L3DDrawPacket* dst = &scratch[0];
+
+    // Scatters by each byte, from the least significant one.
+    for (unsigned int b = 0; b < 8; ++b)
+    {
+        unsigned int* histogram = histograms[b];
+        unsigned int shift = b * 8;
+
+        if (histogram[(src[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        unsigned int offset = 0;
+        for (unsigned int d = 0; d < 256; ++d)
+        {
+            unsigned int n = histogram[d];
+            histogram[d] = offset;
+            offset += n;
+        }
+
+        for (unsigned int i = 0; i < count; ++i)
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+        L3DDrawPacket* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    // Result is in scratch after an odd number of passes.
+    if (src != &packets[0])
+        packets.swap(scratch);
+}
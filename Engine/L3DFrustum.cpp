@@ -0,0 +1,263 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <float.h>
+#include <leaf3d/L3DFrustum.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define L3D_FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace l3d;
+
+void L3DBoundsArray::clear()
+{
+    this->centerX.clear();
+    this->centerY.clear();
+    this->centerZ.clear();
+    this->extentX.clear();
+    this->extentY.clear();
+    this->extentZ.clear();
+    this->radius.clear();
+}
+
+void L3DBoundsArray::reserve(unsigned int count)
+{
+    this->centerX.reserve(count);
+    this->centerY.reserve(count);
+    this->centerZ.reserve(count);
+    this->extentX.reserve(count);
+    this->extentY.reserve(count);
+    this->extentZ.reserve(count);
+    this->radius.reserve(count);
+}
+
+void L3DBoundsArray::add(
+    const L3DVec3& center,
+    const L3DVec3& extents,
+    float radius
+)
+{
+    this->centerX.push_back(center.x);
+    this->centerY.push_back(center.y);
+    this->centerZ.push_back(center.z);
+    this->extentX.push_back(extents.x);
+    this->extentY.push_back(extents.y);
+    this->extentZ.push_back(extents.z);
+    this->radius.push_back(radius);
+}
+
+void L3DBoundsArray::addInfinite()
+{
+    this->add(L3DVec3(0, 0, 0), L3DVec3(FLT_MAX, FLT_MAX, FLT_MAX), FLT_MAX);
+}
+
+L3DFrustum::L3DFrustum()
+{
+    for (unsigned int i = 0; i < L3D_MAX_FRUSTUM_PLANES; ++i)
+        m_planes[i] = L3DVec4(0, 0, 0, FLT_MAX);
+}
+
+L3DFrustum::L3DFrustum(const L3DMat4& vpMat)
+{
+    this->update(vpMat);
+}
+
+void L3DFrustum::update(const L3DMat4& vpMat)
+{
+    // Gribb-Hartmann: planes are sums of the last row with the other ones.
+    L3DMat4 m = glm::transpose(vpMat);
+
+    m_planes[L3D_FRUSTUM_LEFT] = m[3] + m[0];
+    m_planes[L3D_FRUSTUM_RIGHT] = m[3] - m[0];
+    m_planes[L3D_FRUSTUM_BOTTOM] = m[3] + m[1];
+    m_planes[L3D_FRUSTUM_TOP] = m[3] - m[1];
+    m_planes[L3D_FRUSTUM_NEAR] = m[3] + m[2];
+    m_planes[L3D_FRUSTUM_FAR] = m[3] - m[2];
+
+    for (unsigned int i = 0; i < L3D_MAX_FRUSTUM_PLANES; ++i)
+    {
+        float length = glm::length(L3DVec3(m_planes[i]));
+        if (length > 0.0f)
+            m_planes[i] /= length;
+    }
+}
+
+bool L3DFrustum::intersects(const L3DAABB& aabb) const
+{
+    L3DVec3 center = aabb.center();
+    L3DVec3 extents = aabb.extents();
+
+    for (unsigned int i = 0; i < L3D_MAX_FRUSTUM_PLANES; ++i)
+    {
+        const L3DVec4& p = m_planes[i];
+        float d = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        float r = glm::abs(p.x) * extents.x + glm::abs(p.y) * extents.y + glm::abs(p.z) * extents.z;
+
+        if (d + r < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+bool L3DFrustum::intersects(const L3DBoundingSphere& sphere) const
+{
+    for (unsigned int i = 0; i < L3D_MAX_FRUSTUM_PLANES; ++i)
+    {
+        const L3DVec4& p = m_planes[i];
+        float d = p.x * sphere.center.x + p.y * sphere.center.y + p.z * sphere.center.z + p.w;
+
+        if (d + sphere.radius < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+L3DFrustum::L3DFrustumTest L3DFrustum::classify(const L3DAABB& aabb) const
+{
+    L3DVec3 center = aabb.center();
+    L3DVec3 extents = aabb.extents();
+    L3DFrustumTest result = L3D_FRUSTUM_INSIDE;
+
+    for (unsigned int i = 0; i < L3D_MAX_FRUSTUM_PLANES; ++i)
+    {
+        const L3DVec4& p = m_planes[i];
+        float d = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        float r = glm::abs(p.x) * extents.x + glm::abs(p.y) * extents.y + glm::abs(p.z) * extents.z;
+
+        if (d + r < 0.0f)
+            return L3D_FRUSTUM_OUTSIDE;
+
+        if (d - r < 0.0f)
+            result = L3D_FRUSTUM_INTERSECTING;
+    }
+
+    return result;
+}
+
+unsigned int L3DFrustum::cull(
+    const L3DBoundsArray& bounds,
+    unsigned char* visibility
+) const
+{
+    return this->cull(bounds, 0, bounds.size(), visibility);
+}
+
+unsigned int L3DFrustum::cull(
+    const L3DBoundsArray& bounds,
+    unsigned int first,
+    unsigned int count,
+    unsigned char* visibility
+) const
+{
+    unsigned int visibleCount = 0;
+    unsigned int i = 0;
+
+    if (count == 0 || first + count > bounds.size())
+        return 0;
+
+    const float* cx = &bounds.centerX[first];
+    const float* cy = &bounds.centerY[first];
+    const float* cz = &bounds.centerZ[first];
+    const float* ex = &bounds.extentX[first];
+    const float* ey = &bounds.extentY[first];
+    const float* ez = &bounds.extentZ[first];
+    const float* rs = &bounds.radius[first];
+
+    visibility += first;
+
+#ifdef L3D_FRUSTUM_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    // Tests four entries against each plane at once.
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 centerX = _mm_loadu_ps(cx + i);
+        __m128 centerY = _mm_loadu_ps(cy + i);
+        __m128 centerZ = _mm_loadu_ps(cz + i);
+        __m128 extentX = _mm_loadu_ps(ex + i);
+        __m128 extentY = _mm_loadu_ps(ey + i);
+        __m128 extentZ = _mm_loadu_ps(ez + i);
+        __m128 radius = _mm_loadu_ps(rs + i);
+        __m128 outside = zero;
+
+        for (unsigned int p = 0; p < L3D_MAX_FRUSTUM_PLANES; ++p)
+        {
+            __m128 nx = _mm_set1_ps(m_planes[p].x);
+            __m128 ny = _mm_set1_ps(m_planes[p].y);
+            __m128 nz = _mm_set1_ps(m_planes[p].z);
+            __m128 nw = _mm_set1_ps(m_planes[p].w);
+
+            // Signed distance of centers.
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nx, centerX), _mm_mul_ps(ny, centerY)),
+                _mm_add_ps(_mm_mul_ps(nz, centerZ), nw)
+            );
+
+            // Projected AABB radius, bounded by sphere radius.
+            __m128 r = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_andnot_ps(signMask, nx), extentX),
+                    _mm_mul_ps(_mm_andnot_ps(signMask, ny), extentY)
+                ),
+                _mm_mul_ps(_mm_andnot_ps(signMask, nz), extentZ)
+            );
+            r = _mm_min_ps(r, radius);
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+
+        for (unsigned int k = 0; k < 4; ++k)
+        {
+            visibility[i + k] = (mask & (1 << k)) ? 0 : 1;
+            visibleCount += visibility[i + k];
+        }
+    }
+#endif
+
+    // Tests remaining entries one by one.
+    for (; i < count; ++i)
+    {
+        bool outside = false;
+
+        for (unsigned int p = 0; p < L3D_MAX_FRUSTUM_PLANES && !outside; ++p)
+        {
+            const L3DVec4& n = m_planes[p];
+            float d = n.x * cx[i] + n.y * cy[i] + n.z * cz[i] + n.w;
+            float r = glm::abs(n.x) * ex[i] + glm::abs(n.y) * ey[i] + glm::abs(n.z) * ez[i];
+
+            if (rs[i] < r) r = rs[i];
+
+            outside = (d + r < 0.0f);
+        }
+
+        visibility[i] = outside ? 0 : 1;
+        visibleCount += visibility[i];
+    }
+
+    return visibleCount;
+}
@@ -0,0 +1,820 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <leaf3d/L3DGLBackend.h>
+
+using namespace l3d;
+
+// Entry points used by the engine, replaced by fake backends. Others are
+// left as they are.
+#define L3D_GL_FUNCTIONS(X) \
+    X(glActiveTexture) \
+    X(glAttachShader) \
+    X(glBeginQuery) \
+    X(glBindBuffer) \
+    X(glBindBufferBase) \
+    X(glBindFramebuffer) \
+    X(glBindTexture) \
+    X(glBindVertexArray) \
+    X(glBlendFunc) \
+    X(glBufferData) \
+    X(glBufferStorage) \
+    X(glBufferSubData) \
+    X(glCheckFramebufferStatus) \
+    X(glClear) \
+    X(glClearColor) \
+    X(glClientWaitSync) \
+    X(glCompileShader) \
+    X(glCopyBufferSubData) \
+    X(glCreateProgram) \
+    X(glCreateShader) \
+    X(glCullFace) \
+    X(glDeleteBuffers) \
+    X(glDeleteFramebuffers) \
+    X(glDeleteProgram) \
+    X(glDeleteQueries) \
+    X(glDeleteShader) \
+    X(glDeleteSync) \
+    X(glDeleteTextures) \
+    X(glDeleteVertexArrays) \
+    X(glDepthFunc) \
+    X(glDepthMask) \
+    X(glDisable) \
+    X(glDisableVertexAttribArray) \
+    X(glDrawArrays) \
+    X(glDrawArraysInstanced) \
+    X(glDrawArraysInstancedBaseInstance) \
+    X(glDrawElementsBaseVertex) \
+    X(glDrawElementsInstancedBaseVertex) \
+    X(glDrawElementsInstancedBaseVertexBaseInstance) \
+    X(glEnable) \
+    X(glEnableVertexAttribArray) \
+    X(glEndQuery) \
+    X(glFenceSync) \
+    X(glFinish) \
+    X(glFlush) \
+    X(glFramebufferTexture1D) \
+    X(glFramebufferTexture2D) \
+    X(glFramebufferTexture3D) \
+    X(glGenBuffers) \
+    X(glGenFramebuffers) \
+    X(glGenQueries) \
+    X(glGenTextures) \
+    X(glGenVertexArrays) \
+    X(glGenerateMipmap) \
+    X(glGetActiveUniform) \
+    X(glGetAttribLocation) \
+    X(glGetError) \
+    X(glGetIntegerv) \
+    X(glGetProgramInfoLog) \
+    X(glGetProgramResourceIndex) \
+    X(glGetProgramiv) \
+    X(glGetQueryObjectiv) \
+    X(glGetQueryObjectui64v) \
+    X(glGetShaderInfoLog) \
+    X(glGetShaderiv) \
+    X(glGetString) \
+    X(glGetUniformBlockIndex) \
+    X(glGetUniformLocation) \
+    X(glLinkProgram) \
+    X(glMapBufferRange) \
+    X(glMultiDrawElementsIndirect) \
+    X(glPopDebugGroup) \
+    X(glPushDebugGroup) \
+    X(glShaderSource) \
+    X(glShaderStorageBlockBinding) \
+    X(glTexImage1D) \
+    X(glTexImage2D) \
+    X(glTexImage3D) \
+    X(glTexParameteri) \
+    X(glUniform1f) \
+    X(glUniform1i) \
+    X(glUniform1ui) \
+    X(glUniform2fv) \
+    X(glUniform3fv) \
+    X(glUniform4fv) \
+    X(glUniformBlockBinding) \
+    X(glUniformMatrix3fv) \
+    X(glUniformMatrix4fv) \
+    X(glUseProgram) \
+    X(glVertexAttribDivisor) \
+    X(glVertexAttribIPointer) \
+    X(glVertexAttribPointer) \
+    X(glViewport)
+
+#define L3D_GL_ENUM(f) L3D_GL_CALL_##f,
+#define L3D_GL_NAME(f) #f,
+#define L3D_GL_ENTRY_POINT(f) decltype(glad_##f) f##Proc;
+#define L3D_GL_SAVE(f) state.saved.f##Proc = glad_##f;
+#define L3D_GL_RESTORE(f) glad_##f = state.saved.f##Proc;
+#define L3D_GL_HOOK(f) glad_##f = &L3DGLHook<L3D_GL_CALL_##f, decltype(glad_##f)>::call;
+
+enum L3DGLFunction
+{
+    L3D_GL_FUNCTIONS(L3D_GL_ENUM)
+    L3D_MAX_GL_FUNCTION
+};
+
+static const char* _functionNames[L3D_MAX_GL_FUNCTION] = {
+    L3D_GL_FUNCTIONS(L3D_GL_NAME)
+};
+
+struct L3DGLEntryPoints
+{
+    L3D_GL_FUNCTIONS(L3D_GL_ENTRY_POINT)
+};
+
+// Version and extension flags set by fake backends.
+static int* _versionFlags[] = {
+    &GLAD_GL_VERSION_1_0, &GLAD_GL_VERSION_1_1, &GLAD_GL_VERSION_1_2, &GLAD_GL_VERSION_1_3,
+    &GLAD_GL_VERSION_1_4, &GLAD_GL_VERSION_1_5, &GLAD_GL_VERSION_2_0, &GLAD_GL_VERSION_2_1,
+    &GLAD_GL_VERSION_3_0, &GLAD_GL_VERSION_3_1, &GLAD_GL_VERSION_3_2, &GLAD_GL_VERSION_3_3,
+    &GLAD_GL_VERSION_4_0, &GLAD_GL_VERSION_4_1, &GLAD_GL_VERSION_4_2, &GLAD_GL_VERSION_4_3,
+    &GLAD_GL_VERSION_4_4, &GLAD_GL_VERSION_4_5, &GLAD_GL_KHR_debug
+};
+
+static const unsigned int _versionFlagCount = sizeof(_versionFlags) / sizeof(int*);
+static const unsigned int _supportedVersionFlagCount = 12;
+
+struct L3DGLShaderInfo
+{
+    GLenum      type;
+    std::string source;
+};
+
+struct L3DGLActiveUniform
+{
+    std::string name;
+    GLint       size;
+    GLenum      type;
+};
+
+struct L3DGLProgramInfo
+{
+    L3DGLProgramInfo() : nextUniformLocation(0), nextAttributeLocation(0) {}
+
+    std::vector<GLuint>                 shaders;
+    std::vector<L3DGLActiveUniform>     uniforms;
+    std::map<std::string, GLint>        uniformLocations;
+    std::map<std::string, GLint>        attributeLocations;
+    std::vector<std::string>            uniformBlocks;
+    std::vector<std::string>            storageBlocks;
+    GLint                               nextUniformLocation;
+    GLint                               nextAttributeLocation;
+};
+
+// Fields of a GLSL struct, or a declared variable.
+struct L3DGLVariable
+{
+    std::string     type;
+    std::string     name;
+    GLint           size;
+    bool            isArray;
+};
+
+typedef std::vector<L3DGLVariable> L3DGLVariableList;
+typedef std::map<std::string, L3DGLVariableList> L3DGLStructMap;
+
+struct L3DGLBackendState
+{
+    L3DGLBackendState() : backend(L3D_BACKEND_OPENGL), nextName(0) {}
+
+    L3DBackend                              backend;
+    std::vector<L3DGLCall>                  calls;
+    GLuint                                  nextName;
+    std::map<GLuint, L3DGLShaderInfo>       shaders;
+    std::map<GLuint, L3DGLProgramInfo>      programs;
+    std::list<std::vector<unsigned char> >  mappings;
+    L3DGLEntryPoints                        saved;
+    int                                     savedVersionFlags[sizeof(_versionFlags) / sizeof(int*)];
+};
+
+static L3DGLBackendState& _state()
+{
+    static L3DGLBackendState state;
+    return state;
+}
+
+/* Recording ******************************************************************/
+
+template <typename T>
+static typename std::enable_if<std::is_integral<T>::value, unsigned long long>::type _argValue(T value)
+{
+    return (unsigned long long)(long long)value;
+}
+
+template <typename T>
+static unsigned long long _argValue(T* value)
+{
+    return (unsigned long long)(uintptr_t)value;
+}
+
+static unsigned long long _argValue(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static void _storeArgs(L3DGLCall&)
+{
+}
+
+template <typename T, typename... Args>
+static void _storeArgs(L3DGLCall& call, T value, Args... args)
+{
+    if (call.argCount < L3D_MAX_GL_CALL_ARGS)
+        call.args[call.argCount++] = _argValue(value);
+
+    _storeArgs(call, args...);
+}
+
+template <typename... Args>
+static void _record(unsigned int function, Args... args)
+{
+    L3DGLBackendState& state = _state();
+
+    if (state.backend != L3D_BACKEND_RECORDING)
+        return;
+
+    L3DGLCall call;
+    call.name = _functionNames[function];
+    _storeArgs(call, args...);
+
+    state.calls.push_back(call);
+}
+
+// Entry point which is only recorded.
+template <unsigned int F, typename T>
+struct L3DGLHook;
+
+template <unsigned int F, typename R, typename... Args>
+struct L3DGLHook<F, R (APIENTRYP)(Args...)>
+{
+    static R APIENTRY call(Args... args)
+    {
+        _record(F, args...);
+        return R();
+    }
+};
+
+/* Shader reflection **********************************************************/
+
+static void _tokenize(const std::string& source, std::vector<std::string>& tokens)
+{
+    unsigned int i = 0;
+    while (i < source.size())
+    {
+        char c = source[i];
+
+        // Skips preprocessor lines and comments.
+        if (c == '#' || source.compare(i, 2, "//") == 0)
+        {
+            while (i < source.size() && source[i] != '\n')
+                ++i;
+        }
+        else if (source.compare(i, 2, "/*") == 0)
+        {
+            size_t end = source.find("*/", i + 2);
+            i = end == std::string::npos ? source.size() : end + 2;
+        }
+        else if (isalnum(c) || c == '_')
+        {
+            unsigned int start = i;
+            while (i < source.size() && (isalnum(source[i]) || source[i] == '_'))
+                ++i;
+            tokens.push_back(source.substr(start, i - start));
+        }
+        else
+        {
+            if (!isspace(c))
+                tokens.push_back(std::string(1, c));
+            ++i;
+        }
+    }
+}
+
+static bool _isQualifier(const std::string& token)
+{
+    return token == "lowp" || token == "mediump" || token == "highp"
+        || token == "flat" || token == "smooth" || token == "noperspective";
+}
+
+// Reads "type name[size], name;" from given token, up to the semicolon.
+static unsigned int _parseDeclaration(
+    const std::vector<std::string>& tokens,
+    unsigned int t,
+    L3DGLVariableList& variables
+)
+{
+    while (t < tokens.size() && _isQualifier(tokens[t]))
+        ++t;
+
+    if (t >= tokens.size())
+        return t;
+
+    std::string type = tokens[t++];
+
+    while (t < tokens.size() && tokens[t] != ";" && tokens[t] != "}")
+    {
+        L3DGLVariable variable;
+        variable.type = type;
+        variable.name = tokens[t++];
+        variable.size = 1;
+        variable.isArray = false;
+
+        if (t + 2 < tokens.size() && tokens[t] == "[")
+        {
+            variable.size = atoi(tokens[t + 1].c_str());
+            variable.isArray = true;
+            t += 3;
+        }
+
+        variables.push_back(variable);
+
+        if (t < tokens.size() && tokens[t] == ",")
+            ++t;
+        else
+            break;
+    }
+
+    return t;
+}
+
+static GLenum _uniformType(const std::string& type)
+{
+    static const char* names[] = { "float", "int", "uint", "bool", "vec2", "vec3", "vec4", "mat3", "mat4", "sampler2D", "samplerCube" };
+    static const GLenum types[] = { GL_FLOAT, GL_INT, GL_UNSIGNED_INT, GL_BOOL, GL_FLOAT_VEC2, GL_FLOAT_VEC3, GL_FLOAT_VEC4, GL_FLOAT_MAT3, GL_FLOAT_MAT4, GL_SAMPLER_2D, GL_SAMPLER_CUBE };
+
+    for (unsigned int i = 0; i < sizeof(names) / sizeof(const char*); ++i)
+        if (type == names[i])
+            return types[i];
+
+    return GL_FLOAT;
+}
+
+// Struct uniforms are made of their fields, as real drivers report them.
+static void _addUniform(
+    L3DGLProgramInfo& program,
+    const L3DGLStructMap& structs,
+    const std::string& prefix,
+    const L3DGLVariable& variable
+)
+{
+    std::string name = prefix + variable.name;
+
+    L3DGLStructMap::const_iterator it = structs.find(variable.type);
+    if (it != structs.end())
+    {
+        for (GLint k = 0; k < variable.size; ++k)
+        {
+            std::string fieldPrefix = name;
+            if (variable.isArray)
+                fieldPrefix += "[" + std::to_string(k) + "]";
+            fieldPrefix += ".";
+
+            for (unsigned int f = 0; f < it->second.size(); ++f)
+                _addUniform(program, structs, fieldPrefix, it->second[f]);
+        }
+        return;
+    }
+
+    if (program.uniformLocations.count(name))
+        return;
+
+    L3DGLActiveUniform uniform;
+    uniform.name = variable.isArray ? name + "[0]" : name;
+    uniform.size = variable.size;
+    uniform.type = _uniformType(variable.type);
+    program.uniforms.push_back(uniform);
+
+    program.uniformLocations[name] = program.nextUniformLocation;
+    for (GLint k = 0; variable.isArray && k < variable.size; ++k)
+        program.uniformLocations[name + "[" + std::to_string(k) + "]"] = program.nextUniformLocation + k;
+
+    program.nextUniformLocation += variable.size;
+}
+
+static void _reflectShader(L3DGLProgramInfo& program, const L3DGLShaderInfo& shader)
+{
+    std::vector<std::string> tokens;
+    _tokenize(shader.source, tokens);
+
+    L3DGLStructMap structs;
+    int depth = 0;
+
+    for (unsigned int t = 0; t < tokens.size(); ++t)
+    {
+        const std::string& token = tokens[t];
+
+        if (token == "{" || token == "(")
+            ++depth;
+        else if (token == "}" || token == ")")
+            --depth;
+
+        if (depth != 0 || t + 2 >= tokens.size())
+            continue;
+
+        if (token == "struct" && tokens[t + 2] == "{")
+        {
+            L3DGLVariableList& fields = structs[tokens[t + 1]];
+
+            t += 3;
+            while (t < tokens.size() && tokens[t] != "}")
+                t = _parseDeclaration(tokens, t, fields) + 1;
+        }
+        else if ((token == "uniform" || token == "buffer") && tokens[t + 2] == "{")
+        {
+            if (token == "uniform")
+                program.uniformBlocks.push_back(tokens[t + 1]);
+            else
+                program.storageBlocks.push_back(tokens[t + 1]);
+        }
+        else if (token == "uniform")
+        {
+            L3DGLVariableList variables;
+            t = _parseDeclaration(tokens, t + 1, variables);
+
+            for (unsigned int v = 0; v < variables.size(); ++v)
+                _addUniform(program, structs, "", variables[v]);
+        }
+        else if (token == "in" && shader.type == GL_VERTEX_SHADER)
+        {
+            L3DGLVariableList variables;
+            t = _parseDeclaration(tokens, t + 1, variables);
+
+            // Matrices take a location for each column.
+            for (unsigned int v = 0; v < variables.size(); ++v)
+            {
+                const L3DGLVariable& variable = variables[v];
+                GLint columns = variable.type == "mat4" ? 4 : variable.type == "mat3" ? 3 : 1;
+
+                program.attributeLocations[variable.name] = program.nextAttributeLocation;
+                program.nextAttributeLocation += columns * variable.size;
+            }
+        }
+    }
+}
+
+static GLuint _blockIndex(const std::vector<std::string>& blocks, const GLchar* name)
+{
+    for (unsigned int i = 0; i < blocks.size(); ++i)
+        if (blocks[i] == name)
+            return i;
+
+    return GL_INVALID_INDEX;
+}
+
+/* Fake entry points **********************************************************/
+
+template <unsigned int F>
+static void APIENTRY _genNames(GLsizei n, GLuint* names)
+{
+    _record(F, n, names);
+
+    for (GLsizei i = 0; i < n; ++i)
+        names[i] = ++_state().nextName;
+}
+
+static GLuint APIENTRY _createShader(GLenum type)
+{
+    _record(L3D_GL_CALL_glCreateShader, type);
+
+    L3DGLBackendState& state = _state();
+    GLuint id = ++state.nextName;
+    state.shaders[id].type = type;
+
+    return id;
+}
+
+static void APIENTRY _shaderSource(GLuint shader, GLsizei count, const GLchar** string, const GLint* length)
+{
+    _record(L3D_GL_CALL_glShaderSource, shader, count, string, length);
+
+    std::string& source = _state().shaders[shader].source;
+    source.clear();
+
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        if (length && length[i] >= 0)
+            source.append(string[i], length[i]);
+        else
+            source.append(string[i]);
+    }
+}
+
+static void APIENTRY _deleteShader(GLuint shader)
+{
+    _record(L3D_GL_CALL_glDeleteShader, shader);
+
+    _state().shaders.erase(shader);
+}
+
+static void APIENTRY _getShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+    _record(L3D_GL_CALL_glGetShaderiv, shader, pname, params);
+
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+static GLuint APIENTRY _createProgram()
+{
+    _record(L3D_GL_CALL_glCreateProgram);
+
+    L3DGLBackendState& state = _state();
+    GLuint id = ++state.nextName;
+    state.programs[id] = L3DGLProgramInfo();
+
+    return id;
+}
+
+static void APIENTRY _attachShader(GLuint program, GLuint shader)
+{
+    _record(L3D_GL_CALL_glAttachShader, program, shader);
+
+    _state().programs[program].shaders.push_back(shader);
+}
+
+static void APIENTRY _linkProgram(GLuint program)
+{
+    _record(L3D_GL_CALL_glLinkProgram, program);
+
+    L3DGLBackendState& state = _state();
+    L3DGLProgramInfo& info = state.programs[program];
+
+    for (unsigned int s = 0; s < info.shaders.size(); ++s)
+        _reflectShader(info, state.shaders[info.shaders[s]]);
+}
+
+static void APIENTRY _deleteProgram(GLuint program)
+{
+    _record(L3D_GL_CALL_glDeleteProgram, program);
+
+    _state().programs.erase(program);
+}
+
+static void APIENTRY _getProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+    _record(L3D_GL_CALL_glGetProgramiv, program, pname, params);
+
+    const L3DGLProgramInfo& info = _state().programs[program];
+
+    switch (pname)
+    {
+    case GL_LINK_STATUS:
+        *params = GL_TRUE;
+        break;
+    case GL_ACTIVE_UNIFORMS:
+        *params = info.uniforms.size();
+        break;
+    case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+        *params = 0;
+        for (unsigned int i = 0; i < info.uniforms.size(); ++i)
+            *params = std::max(*params, (GLint)info.uniforms[i].name.size() + 1);
+        break;
+    default:
+        *params = 0;
+        break;
+    }
+}
+
+static void APIENTRY _getActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+    _record(L3D_GL_CALL_glGetActiveUniform, program, index, bufSize, length, size, type, name);
+
+    const L3DGLActiveUniform& uniform = _state().programs[program].uniforms.at(index);
+    GLsizei nameLength = std::min((GLsizei)uniform.name.size(), bufSize - 1);
+
+    memcpy(name, uniform.name.c_str(), nameLength);
+    name[nameLength] = 0;
+
+    if (length)
+        *length = nameLength;
+    *size = uniform.size;
+    *type = uniform.type;
+}
+
+static GLint APIENTRY _getUniformLocation(GLuint program, const GLchar* name)
+{
+    _record(L3D_GL_CALL_glGetUniformLocation, program, name);
+
+    const std::map<std::string, GLint>& locations = _state().programs[program].uniformLocations;
+    std::map<std::string, GLint>::const_iterator it = locations.find(name);
+
+    return it != locations.end() ? it->second : -1;
+}
+
+static GLint APIENTRY _getAttribLocation(GLuint program, const GLchar* name)
+{
+    _record(L3D_GL_CALL_glGetAttribLocation, program, name);
+
+    const std::map<std::string, GLint>& locations = _state().programs[program].attributeLocations;
+    std::map<std::string, GLint>::const_iterator it = locations.find(name);
+
+    return it != locations.end() ? it->second : -1;
+}
+
+static GLuint APIENTRY _getUniformBlockIndex(GLuint program, const GLchar* uniformBlockName)
+{
+    _record(L3D_GL_CALL_glGetUniformBlockIndex, program, uniformBlockName);
+
+    return _blockIndex(_state().programs[program].uniformBlocks, uniformBlockName);
+}
+
+static GLuint APIENTRY _getProgramResourceIndex(GLuint program, GLenum programInterface, const GLchar* name)
+{
+    _record(L3D_GL_CALL_glGetProgramResourceIndex, program, programInterface, name);
+
+    if (programInterface != GL_SHADER_STORAGE_BLOCK)
+        return GL_INVALID_INDEX;
+
+    return _blockIndex(_state().programs[program].storageBlocks, name);
+}
+
+static GLenum APIENTRY _checkFramebufferStatus(GLenum target)
+{
+    _record(L3D_GL_CALL_glCheckFramebufferStatus, target);
+
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void* APIENTRY _mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    _record(L3D_GL_CALL_glMapBufferRange, target, offset, length, access);
+
+    // Mapped memory stays valid until backend is uninstalled.
+    L3DGLBackendState& state = _state();
+    state.mappings.push_back(std::vector<unsigned char>(length));
+
+    return &state.mappings.back()[0];
+}
+
+static GLsync APIENTRY _fenceSync(GLenum condition, GLbitfield flags)
+{
+    _record(L3D_GL_CALL_glFenceSync, condition, flags);
+
+    return (GLsync)(uintptr_t)++_state().nextName;
+}
+
+static GLenum APIENTRY _clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    _record(L3D_GL_CALL_glClientWaitSync, sync, flags, timeout);
+
+    return GL_ALREADY_SIGNALED;
+}
+
+static void APIENTRY _getQueryObjectiv(GLuint id, GLenum pname, GLint* params)
+{
+    _record(L3D_GL_CALL_glGetQueryObjectiv, id, pname, params);
+
+    *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY _getQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params)
+{
+    _record(L3D_GL_CALL_glGetQueryObjectui64v, id, pname, params);
+
+    *params = 0;
+}
+
+static void APIENTRY _getIntegerv(GLenum pname, GLint* data)
+{
+    _record(L3D_GL_CALL_glGetIntegerv, pname, data);
+
+    *data = 0;
+}
+
+static const GLubyte* APIENTRY _getString(GLenum name)
+{
+    _record(L3D_GL_CALL_glGetString, name);
+
+    switch (name)
+    {
+    case GL_VENDOR:
+        return (const GLubyte*)"leaf3d";
+    case GL_RENDERER:
+        return (const GLubyte*)(_state().backend == L3D_BACKEND_RECORDING ? "leaf3d recording backend" : "leaf3d null backend");
+    case GL_VERSION:
+        return (const GLubyte*)"3.3.0";
+    case GL_SHADING_LANGUAGE_VERSION:
+        return (const GLubyte*)"3.30";
+    default:
+        return (const GLubyte*)"";
+    }
+}
+
+/* Backend ********************************************************************/
+
+bool L3DGLBackend::install(const L3DBackend& backend)
+{
+    L3DGLBackendState& state = _state();
+
+    L3DGLBackend::uninstall();
+
+    if (backend == L3D_BACKEND_OPENGL)
+        return gladLoadGL() != 0;
+
+    L3D_GL_FUNCTIONS(L3D_GL_SAVE)
+
+    for (unsigned int i = 0; i < _versionFlagCount; ++i)
+    {
+        state.savedVersionFlags[i] = *_versionFlags[i];
+        *_versionFlags[i] = i < _supportedVersionFlagCount;
+    }
+
+    L3D_GL_FUNCTIONS(L3D_GL_HOOK)
+
+    glad_glGenBuffers = _genNames<L3D_GL_CALL_glGenBuffers>;
+    glad_glGenFramebuffers = _genNames<L3D_GL_CALL_glGenFramebuffers>;
+    glad_glGenQueries = _genNames<L3D_GL_CALL_glGenQueries>;
+    glad_glGenTextures = _genNames<L3D_GL_CALL_glGenTextures>;
+    glad_glGenVertexArrays = _genNames<L3D_GL_CALL_glGenVertexArrays>;
+    glad_glCreateShader = _createShader;
+    glad_glShaderSource = _shaderSource;
+    glad_glDeleteShader = _deleteShader;
+    glad_glGetShaderiv = _getShaderiv;
+    glad_glCreateProgram = _createProgram;
+    glad_glAttachShader = _attachShader;
+    glad_glLinkProgram = _linkProgram;
+    glad_glDeleteProgram = _deleteProgram;
+    glad_glGetProgramiv = _getProgramiv;
+    glad_glGetActiveUniform = _getActiveUniform;
+    glad_glGetUniformLocation = _getUniformLocation;
+    glad_glGetAttribLocation = _getAttribLocation;
+    glad_glGetUniformBlockIndex = _getUniformBlockIndex;
+    glad_glGetProgramResourceIndex = _getProgramResourceIndex;
+    glad_glCheckFramebufferStatus = _checkFramebufferStatus;
+    glad_glMapBufferRange = _mapBufferRange;
+    glad_glFenceSync = _fenceSync;
+    glad_glClientWaitSync = _clientWaitSync;
+    glad_glGetQueryObjectiv = _getQueryObjectiv;
+    glad_glGetQueryObjectui64v = _getQueryObjectui64v;
+    glad_glGetIntegerv = _getIntegerv;
+    glad_glGetString = _getString;
+
+    state.backend = backend;
+    state.calls.clear();
+    state.nextName = 0;
+
+    return true;
+}
+
+void L3DGLBackend::uninstall()
+{
+    L3DGLBackendState& state = _state();
+
+    if (state.backend == L3D_BACKEND_OPENGL)
+        return;
+
+    L3D_GL_FUNCTIONS(L3D_GL_RESTORE)
+
+    for (unsigned int i = 0; i < _versionFlagCount; ++i)
+        *_versionFlags[i] = state.savedVersionFlags[i];
+
+    state.backend = L3D_BACKEND_OPENGL;
+    state.shaders.clear();
+    state.programs.clear();
+    state.mappings.clear();
+}
+
+L3DBackend L3DGLBackend::backend()
+{
+    return _state().backend;
+}
+
+const std::vector<L3DGLCall>& L3DGLBackend::calls()
+{
+    return _state().calls;
+}
+
+void L3DGLBackend::clearCalls()
+{
+    _state().calls.clear();
+}
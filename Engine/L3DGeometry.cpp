@@ -0,0 +1,79 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DGeometry.h>
+
+using namespace l3d;
+
+void L3DGeometry::grid(
+    unsigned int n,
+    const L3DVec2& texMulFactor,
+    float* vertices,
+    unsigned int* indices
+)
+{
+    float k = 1.0f / n;
+
+    // Generate vertices.
+    unsigned int v = 0;
+    for (unsigned int y = 0; y <= n; ++y) {
+        float ky = k * y;
+
+        for (unsigned int x = 0; x <= n; ++x) {
+            float kx = k * x;
+
+            // Position.
+            vertices[v+0]  = kx - 0.5f;
+            vertices[v+1]  = ky - 0.5f;
+            vertices[v+2]  = 0.0f;
+            // Normal.
+            vertices[v+3]  = 0.0f;
+            vertices[v+4]  = 0.0f;
+            vertices[v+5]  = 1.0f;
+            // Tangent.
+            vertices[v+6]  = 1.0f;
+            vertices[v+7]  = 0.0f;
+            vertices[v+8]  = 0.0f;
+            // Texcoords.
+            vertices[v+9]  = texMulFactor.x * x;
+            vertices[v+10] = texMulFactor.y * y;
+
+            v += 11;
+        }
+    }
+
+    // Generate indices.
+    unsigned int q = 0;
+    for (unsigned int y = 0; y < n; ++y) {
+        for (unsigned int x = 0; x < n; ++x) {
+            // First triangle.
+            indices[q    ] = x + y * n + y;
+            indices[q + 1] = x + y * n + y + 1;
+            indices[q + 2] = x + (y + 1) * n + y + 1;
+            // Second triangle.
+            indices[q + 3] = x + (y + 1) * n + y + 1;
+            indices[q + 4] = x + (y + 1) * n + y + 2;
+            indices[q + 5] = x + y * n + y + 1;
+
+            q += 6;
+        }
+    }
+}
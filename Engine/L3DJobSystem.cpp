@@ -0,0 +1,257 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DJobSystem.h>
+
+using namespace l3d;
+
+// Deque owned by current thread, 0 for threads which are not workers.
+static thread_local unsigned int _workerIndex = 0;
+
+struct L3DParallelForChunk
+{
+    L3DParallelForFunction  function;
+    void*                   data;
+    unsigned int            first;
+    unsigned int            last;
+};
+
+static void _runParallelForChunk(void* data)
+{
+    L3DParallelForChunk* chunk = static_cast<L3DParallelForChunk*>(data);
+    chunk->function(chunk->data, chunk->first, chunk->last);
+}
+
+L3DJobSystem::L3DJobSystem(unsigned int workerCount) :
+    m_running(false),
+    m_pendingJobCount(0)
+{
+    this->startWorkers(workerCount);
+}
+
+L3DJobSystem::~L3DJobSystem()
+{
+    this->stopWorkers();
+}
+
+void L3DJobSystem::setWorkerCount(unsigned int count)
+{
+    if (count == m_threads.size())
+        return;
+
+    this->stopWorkers();
+    this->startWorkers(count);
+}
+
+unsigned int L3DJobSystem::defaultWorkerCount()
+{
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+void L3DJobSystem::run(
+    L3DJobFunction function,
+    void* data,
+    L3DJobCounter* counter
+)
+{
+    if (!function)
+        return;
+
+    if (counter)
+        counter->m_value.fetch_add(1, std::memory_order_relaxed);
+
+    if (m_threads.empty())
+    {
+        function(data);
+
+        if (counter)
+            counter->m_value.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    L3DJob job;
+    job.function = function;
+    job.data = data;
+    job.counter = counter;
+
+    Worker* worker = m_workers[_workerIndex < m_workers.size() ? _workerIndex : 0];
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->jobs.push_back(job);
+    }
+
+    ++m_pendingJobCount;
+
+    // Sleeping workers check pending jobs holding this mutex, so taking it
+    // here ensures they don't miss the notification.
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wakeUp.notify_one();
+}
+
+void L3DJobSystem::wait(L3DJobCounter* counter)
+{
+    if (!counter)
+        return;
+
+    unsigned int workerIndex = _workerIndex < m_workers.size() ? _workerIndex : 0;
+
+    // Runs other jobs instead of blocking, so waiting jobs can't deadlock.
+    while (!counter->isDone())
+    {
+        if (!this->runPendingJob(workerIndex))
+            std::this_thread::yield();
+    }
+}
+
+void L3DJobSystem::parallelFor(
+    unsigned int count,
+    unsigned int grainSize,
+    L3DParallelForFunction function,
+    void* data
+)
+{
+    if (!count || !function)
+        return;
+
+    if (grainSize < 1)
+        grainSize = 1;
+
+    unsigned int chunkCount = (count + grainSize - 1) / grainSize;
+
+    if (m_threads.empty() || chunkCount == 1)
+    {
+        for (unsigned int first = 0; first < count; first += grainSize)
+            function(data, first, first + grainSize < count ? first + grainSize : count);
+        return;
+    }
+
+    std::vector<L3DParallelForChunk> chunks(chunkCount);
+    L3DJobCounter counter;
+
+    for (unsigned int c = 0; c < chunkCount; ++c)
+    {
+        L3DParallelForChunk& chunk = chunks[c];
+        chunk.function = function;
+        chunk.data = data;
+        chunk.first = c * grainSize;
+        chunk.last = chunk.first + grainSize < count ? chunk.first + grainSize : count;
+
+        this->run(_runParallelForChunk, &chunk, &counter);
+    }
+
+    this->wait(&counter);
+}
+
+bool L3DJobSystem::runPendingJob(unsigned int workerIndex)
+{
+    unsigned int workerCount = m_workers.size();
+    bool found = false;
+    L3DJob job;
+
+    // Newest own job first, as its data is likely still in cache.
+    {
+        Worker* worker = m_workers[workerIndex];
+        std::lock_guard<std::mutex> lock(worker->mutex);
+
+        if (!worker->jobs.empty())
+        {
+            job = worker->jobs.back();
+            worker->jobs.pop_back();
+            found = true;
+        }
+    }
+
+    // Then oldest job of another worker.
+    for (unsigned int k = 1; !found && k < workerCount; ++k)
+    {
+        Worker* victim = m_workers[(workerIndex + k) % workerCount];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+
+        if (!victim->jobs.empty())
+        {
+            job = victim->jobs.front();
+            victim->jobs.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found)
+        return false;
+
+    --m_pendingJobCount;
+
+    job.function(job.data);
+
+    if (job.counter)
+        job.counter->m_value.fetch_sub(1, std::memory_order_release);
+
+    return true;
+}
+
+void L3DJobSystem::workerLoop(unsigned int workerIndex)
+{
+    _workerIndex = workerIndex;
+
+    while (m_running)
+    {
+        if (this->runPendingJob(workerIndex))
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        while (m_running && m_pendingJobCount == 0)
+            m_wakeUp.wait(lock);
+    }
+}
+
+void L3DJobSystem::startWorkers(unsigned int count)
+{
+    m_running = true;
+
+    // Deque 0 belongs to threads outside the system.
+    for (unsigned int i = 0; i <= count; ++i)
+        m_workers.push_back(new Worker());
+
+    for (unsigned int i = 1; i <= count; ++i)
+        m_threads.push_back(std::thread(&L3DJobSystem::workerLoop, this, i));
+}
+
+void L3DJobSystem::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_running = false;
+    }
+    m_wakeUp.notify_all();
+
+    for (std::vector<std::thread>::iterator it = m_threads.begin(); it != m_threads.end(); ++it)
+        it->join();
+    m_threads.clear();
+
+    // Leftover jobs are run by calling thread.
+    while (!m_workers.empty() && this->runPendingJob(0)) {}
+
+    for (std::vector<Worker*>::iterator it = m_workers.begin(); it != m_workers.end(); ++it)
+        delete *it;
+    m_workers.clear();
+}
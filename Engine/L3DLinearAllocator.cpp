@@ -0,0 +1,115 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <cstdlib>
+#include <leaf3d/L3DLinearAllocator.h>
+
+using namespace l3d;
+
+L3DLinearAllocator::L3DLinearAllocator(unsigned int blockSize) :
+    m_blockSize(blockSize > 0 ? blockSize : 1),
+    m_currentBlock(0),
+    m_offset(0),
+    m_usedSize(0)
+{
+}
+
+L3DLinearAllocator::~L3DLinearAllocator()
+{
+    this->clearBlocks();
+}
+
+unsigned int L3DLinearAllocator::capacity() const
+{
+    unsigned int capacity = 0;
+
+    for (std::vector<Block>::const_iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+        capacity += it->size;
+
+    return capacity;
+}
+
+void* L3DLinearAllocator::allocate(unsigned int size, unsigned int alignment)
+{
+    if (alignment == 0)
+        alignment = 1;
+
+    while (m_currentBlock < m_blocks.size())
+    {
+        Block& block = m_blocks[m_currentBlock];
+        unsigned int offset = (m_offset + alignment - 1) / alignment * alignment;
+
+        if (offset + size <= block.size)
+        {
+            m_usedSize += offset + size - m_offset;
+            m_offset = offset + size;
+            return block.data + offset;
+        }
+
+        ++m_currentBlock;
+        m_offset = 0;
+    }
+
+    // Blocks come from malloc, so their start is aligned enough.
+    Block block;
+    block.size = size > m_blockSize ? size : m_blockSize;
+    block.data = static_cast<unsigned char*>(malloc(block.size));
+
+    if (!block.data)
+        return L3D_NULLPTR;
+
+    m_blocks.push_back(block);
+    m_currentBlock = m_blocks.size() - 1;
+    m_offset = size;
+    m_usedSize += size;
+
+    return block.data;
+}
+
+void L3DLinearAllocator::reset()
+{
+    // Memory needed by last use is merged in one block for the next ones.
+    if (m_blocks.size() > 1)
+    {
+        unsigned int size = this->capacity();
+
+        this->clearBlocks();
+
+        Block block;
+        block.size = size;
+        block.data = static_cast<unsigned char*>(malloc(size));
+
+        if (block.data)
+            m_blocks.push_back(block);
+    }
+
+    m_currentBlock = 0;
+    m_offset = 0;
+    m_usedSize = 0;
+}
+
+void L3DLinearAllocator::clearBlocks()
+{
+    for (std::vector<Block>::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+        free(it->data);
+
+    m_blocks.clear();
+}
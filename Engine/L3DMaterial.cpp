@@ -35,13 +35,88 @@ L3DMaterial::L3DMaterial(
 ) : L3DResource(L3D_MATERIAL, renderer),
     m_name(name),
     m_shaderProgram(shaderProgram),
-    colors(colors),
-    params(params),
-    textures(textures)
+    m_uniformsDirty(true),
+    m_colors(colors),
+    m_params(params),
+    m_textures(textures)
 {
+    // Uniform ids are resolved here and on edits, not while drawing.
+    this->updateUniforms();
+
     if (renderer) renderer->addMaterial(this);
 }
 
+void L3DMaterial::setColor(const char* name, const L3DVec3& color)
+{
+    if (m_colors.find(name) == m_colors.end())
+        m_uniformsDirty = true;
+
+    m_colors[name] = color;
+
+    this->updateUniforms();
+}
+
+void L3DMaterial::setParam(const char* name, float param)
+{
+    if (m_params.find(name) == m_params.end())
+        m_uniformsDirty = true;
+
+    m_params[name] = param;
+
+    this->updateUniforms();
+}
+
+void L3DMaterial::setTexture(const char* name, L3DTexture* texture)
+{
+    if (m_textures.find(name) == m_textures.end())
+        m_uniformsDirty = true;
+
+    m_textures[name] = texture;
+
+    this->updateUniforms();
+}
+
+void L3DMaterial::updateUniforms()
+{
+    if (!m_uniformsDirty)
+        return;
+
+    std::string materialName = "u_material.";
+    std::string samplerName = "u_";
+
+    m_colorUniforms.clear();
+    for (L3DColorRegistry::const_iterator it = m_colors.begin(); it != m_colors.end(); ++it)
+    {
+        L3DMaterialUniform<L3DVec3> uniform;
+        uniform.id = L3DShaderProgram::uniformId(materialName + it->first);
+        uniform.flagId = 0;
+        uniform.value = &it->second;
+        m_colorUniforms.push_back(uniform);
+    }
+
+    m_paramUniforms.clear();
+    for (L3DParameterRegistry::const_iterator it = m_params.begin(); it != m_params.end(); ++it)
+    {
+        L3DMaterialUniform<float> uniform;
+        uniform.id = L3DShaderProgram::uniformId(materialName + it->first);
+        uniform.flagId = 0;
+        uniform.value = &it->second;
+        m_paramUniforms.push_back(uniform);
+    }
+
+    m_textureUniforms.clear();
+    for (L3DTextureRegistry::const_iterator it = m_textures.begin(); it != m_textures.end(); ++it)
+    {
+        L3DMaterialUniform<L3DTexture*> uniform;
+        uniform.id = L3DShaderProgram::uniformId(samplerName + it->first);
+        uniform.flagId = L3DShaderProgram::uniformId(samplerName + it->first + "Enabled");
+        uniform.value = &it->second;
+        m_textureUniforms.push_back(uniform);
+    }
+
+    m_uniformsDirty = false;
+}
+
 L3DMaterial* L3DMaterial::createBlinnPhongMaterial(
     L3DRenderer* renderer,
     const char* name,
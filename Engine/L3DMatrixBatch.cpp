@@ -0,0 +1,180 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DMatrixBatch.h>
+
+#if defined(__AVX__)
+#define L3D_MATRIX_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define L3D_MATRIX_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace l3d;
+
+// Kernels follow same steps as glm::inverse(), so that results are the
+// same as scalar path ones.
+
+#ifdef L3D_MATRIX_SSE
+static void _normalMatrices4(
+    const L3DMat4* const* matrices,
+    L3DMat3* const* normalMatrices
+)
+{
+    // Each register holds same element of all matrices.
+    __m128 m[3][3];
+
+    for (int c = 0; c < 3; ++c)
+    {
+        __m128 c0 = _mm_loadu_ps(&(*matrices[0])[c][0]);
+        __m128 c1 = _mm_loadu_ps(&(*matrices[1])[c][0]);
+        __m128 c2 = _mm_loadu_ps(&(*matrices[2])[c][0]);
+        __m128 c3 = _mm_loadu_ps(&(*matrices[3])[c][0]);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        m[c][0] = c0;
+        m[c][1] = c1;
+        m[c][2] = c2;
+    }
+
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    __m128 c00 = _mm_sub_ps(_mm_mul_ps(m[1][1], m[2][2]), _mm_mul_ps(m[2][1], m[1][2]));
+    __m128 c10 = _mm_sub_ps(_mm_mul_ps(m[0][1], m[2][2]), _mm_mul_ps(m[2][1], m[0][2]));
+    __m128 c20 = _mm_sub_ps(_mm_mul_ps(m[0][1], m[1][2]), _mm_mul_ps(m[1][1], m[0][2]));
+
+    __m128 det = _mm_add_ps(
+        _mm_sub_ps(_mm_mul_ps(m[0][0], c00), _mm_mul_ps(m[1][0], c10)),
+        _mm_mul_ps(m[2][0], c20)
+    );
+    __m128 oneOverDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    float n[3][3][4];
+    _mm_storeu_ps(n[0][0], _mm_mul_ps(c00, oneOverDet));
+    _mm_storeu_ps(n[0][1], _mm_mul_ps(_mm_xor_ps(signMask, _mm_sub_ps(_mm_mul_ps(m[1][0], m[2][2]), _mm_mul_ps(m[2][0], m[1][2]))), oneOverDet));
+    _mm_storeu_ps(n[0][2], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(m[1][0], m[2][1]), _mm_mul_ps(m[2][0], m[1][1])), oneOverDet));
+    _mm_storeu_ps(n[1][0], _mm_mul_ps(_mm_xor_ps(signMask, c10), oneOverDet));
+    _mm_storeu_ps(n[1][1], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(m[0][0], m[2][2]), _mm_mul_ps(m[2][0], m[0][2])), oneOverDet));
+    _mm_storeu_ps(n[1][2], _mm_mul_ps(_mm_xor_ps(signMask, _mm_sub_ps(_mm_mul_ps(m[0][0], m[2][1]), _mm_mul_ps(m[2][0], m[0][1]))), oneOverDet));
+    _mm_storeu_ps(n[2][0], _mm_mul_ps(c20, oneOverDet));
+    _mm_storeu_ps(n[2][1], _mm_mul_ps(_mm_xor_ps(signMask, _mm_sub_ps(_mm_mul_ps(m[0][0], m[1][2]), _mm_mul_ps(m[1][0], m[0][2]))), oneOverDet));
+    _mm_storeu_ps(n[2][2], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(m[0][0], m[1][1]), _mm_mul_ps(m[1][0], m[0][1])), oneOverDet));
+
+    for (int k = 0; k < 4; ++k)
+    {
+        L3DMat3& normalMatrix = *normalMatrices[k];
+        for (int c = 0; c < 3; ++c)
+            normalMatrix[c] = L3DVec3(n[c][0][k], n[c][1][k], n[c][2][k]);
+    }
+}
+#endif
+
+#ifdef L3D_MATRIX_AVX
+// Loads a column of eight matrices, as three rows of elements.
+static void _loadColumn8(const L3DMat4* const* matrices, int column, __m256* rows)
+{
+    __m128 lo[4];
+    __m128 hi[4];
+
+    for (int k = 0; k < 4; ++k)
+    {
+        lo[k] = _mm_loadu_ps(&(*matrices[k])[column][0]);
+        hi[k] = _mm_loadu_ps(&(*matrices[k + 4])[column][0]);
+    }
+
+    _MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+    _MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+
+    for (int r = 0; r < 3; ++r)
+        rows[r] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[r]), hi[r], 1);
+}
+
+static void _normalMatrices8(
+    const L3DMat4* const* matrices,
+    L3DMat3* const* normalMatrices
+)
+{
+    // Each register holds same element of all matrices.
+    __m256 m[3][3];
+
+    for (int c = 0; c < 3; ++c)
+        _loadColumn8(matrices, c, m[c]);
+
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    __m256 c00 = _mm256_sub_ps(_mm256_mul_ps(m[1][1], m[2][2]), _mm256_mul_ps(m[2][1], m[1][2]));
+    __m256 c10 = _mm256_sub_ps(_mm256_mul_ps(m[0][1], m[2][2]), _mm256_mul_ps(m[2][1], m[0][2]));
+    __m256 c20 = _mm256_sub_ps(_mm256_mul_ps(m[0][1], m[1][2]), _mm256_mul_ps(m[1][1], m[0][2]));
+
+    __m256 det = _mm256_add_ps(
+        _mm256_sub_ps(_mm256_mul_ps(m[0][0], c00), _mm256_mul_ps(m[1][0], c10)),
+        _mm256_mul_ps(m[2][0], c20)
+    );
+    __m256 oneOverDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+
+    float n[3][3][8];
+    _mm256_storeu_ps(n[0][0], _mm256_mul_ps(c00, oneOverDet));
+    _mm256_storeu_ps(n[0][1], _mm256_mul_ps(_mm256_xor_ps(signMask, _mm256_sub_ps(_mm256_mul_ps(m[1][0], m[2][2]), _mm256_mul_ps(m[2][0], m[1][2]))), oneOverDet));
+    _mm256_storeu_ps(n[0][2], _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(m[1][0], m[2][1]), _mm256_mul_ps(m[2][0], m[1][1])), oneOverDet));
+    _mm256_storeu_ps(n[1][0], _mm256_mul_ps(_mm256_xor_ps(signMask, c10), oneOverDet));
+    _mm256_storeu_ps(n[1][1], _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(m[0][0], m[2][2]), _mm256_mul_ps(m[2][0], m[0][2])), oneOverDet));
+    _mm256_storeu_ps(n[1][2], _mm256_mul_ps(_mm256_xor_ps(signMask, _mm256_sub_ps(_mm256_mul_ps(m[0][0], m[2][1]), _mm256_mul_ps(m[2][0], m[0][1]))), oneOverDet));
+    _mm256_storeu_ps(n[2][0], _mm256_mul_ps(c20, oneOverDet));
+    _mm256_storeu_ps(n[2][1], _mm256_mul_ps(_mm256_xor_ps(signMask, _mm256_sub_ps(_mm256_mul_ps(m[0][0], m[1][2]), _mm256_mul_ps(m[1][0], m[0][2]))), oneOverDet));
+    _mm256_storeu_ps(n[2][2], _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(m[0][0], m[1][1]), _mm256_mul_ps(m[1][0], m[0][1])), oneOverDet));
+
+    for (int k = 0; k < 8; ++k)
+    {
+        L3DMat3& normalMatrix = *normalMatrices[k];
+        for (int c = 0; c < 3; ++c)
+            normalMatrix[c] = L3DVec3(n[c][0][k], n[c][1][k], n[c][2][k]);
+    }
+}
+#endif
+
+L3DMat3 L3DMatrixBatch::normalMatrix(const L3DMat4& matrix)
+{
+    return glm::transpose(glm::inverse(L3DMat3(matrix)));
+}
+
+void L3DMatrixBatch::normalMatrices(
+    const L3DMat4* const* matrices,
+    L3DMat3* const* normalMatrices,
+    unsigned int count
+)
+{
+    unsigned int i = 0;
+
+#ifdef L3D_MATRIX_AVX
+    for (; i + 8 <= count; i += 8)
+        _normalMatrices8(matrices + i, normalMatrices + i);
+#endif
+
+#ifdef L3D_MATRIX_SSE
+    for (; i + 4 <= count; i += 4)
+        _normalMatrices4(matrices + i, normalMatrices + i);
+#endif
+
+    for (; i < count; ++i)
+        *normalMatrices[i] = L3DMatrixBatch::normalMatrix(*matrices[i]);
+}
@@ -24,6 +24,7 @@
 #include <leaf3d/L3DMaterial.h>
 #include <leaf3d/L3DShaderProgram.h>
 #include <leaf3d/L3DRenderer.h>
+#include <leaf3d/L3DMatrixBatch.h>
 #include <leaf3d/L3DMesh.h>
 
 using namespace l3d;
@@ -50,7 +51,20 @@ L3DMesh::L3DMesh(
     m_instanceFormat(L3D_INVALID_INSTANCE_FORMAT),
     m_drawPrimitive(drawPrimitive),
     m_renderLayer(renderLayer),
-    m_sortKey(0)
+    m_sortKey(0),
+    m_renderBucketLayer(renderLayer),
+    m_renderBucketIndex(-1),
+    m_boundingRadius(0),
+    m_worldRadius(0),
+    m_bvhProxy(-1),
+    m_boundsDirty(false),
+    m_visibleFrame(0),
+    m_instanceOffset(0),
+    m_instanceCount(0),
+    m_ownsInstanceBuffer(false),
+    m_indirectRejected(false),
+    m_node(0),
+    m_nodeMeshIndex(-1)
 {
     if (vertices && vertexCount)
         m_vertexBuffer = new L3DBuffer(renderer, L3D_BUFFER_VERTEX, vertices, vertexCount * vertexFormat * sizeof(float), vertexFormat * sizeof(float), drawType);
@@ -58,6 +72,11 @@ L3DMesh::L3DMesh(
     if (indices && indexCount)
         m_indexBuffer = new L3DBuffer(renderer, L3D_BUFFER_INDEX, indices, indexCount * sizeof(unsigned int), sizeof(unsigned int), drawType);
 
+    // 2D meshes are usually drawn in screen space, they are never culled.
+    if (vertexFormat != L3D_VERTEX_POS2 && vertexFormat != L3D_VERTEX_POS2_UV2)
+        this->setFlag(L3D_MESH_CULLING);
+
+    this->updateBounds();
     this->updateSortKey();
 
     if (renderer) renderer->addMesh(this);
@@ -83,7 +102,20 @@ L3DMesh::L3DMesh(
     m_instanceFormat(L3D_INVALID_INSTANCE_FORMAT),
     m_drawPrimitive(drawPrimitive),
     m_renderLayer(renderLayer),
-    m_sortKey(0)
+    m_sortKey(0),
+    m_renderBucketLayer(renderLayer),
+    m_renderBucketIndex(-1),
+    m_boundingRadius(0),
+    m_worldRadius(0),
+    m_bvhProxy(-1),
+    m_boundsDirty(false),
+    m_visibleFrame(0),
+    m_instanceOffset(0),
+    m_instanceCount(0),
+    m_ownsInstanceBuffer(false),
+    m_indirectRejected(false),
+    m_node(0),
+    m_nodeMeshIndex(-1)
 {
     if (vertexBuffer
         && vertexBuffer->stride() == vertexFormat * sizeof(float)
@@ -95,14 +127,42 @@ L3DMesh::L3DMesh(
         && indexBuffer->drawType() == drawType)
         m_indexBuffer = indexBuffer;
 
+    // 2D meshes are usually drawn in screen space, they are never culled.
+    if (vertexFormat != L3D_VERTEX_POS2 && vertexFormat != L3D_VERTEX_POS2_UV2)
+        this->setFlag(L3D_MESH_CULLING);
+
+    this->updateBounds();
     this->updateSortKey();
 
     if (renderer) renderer->addMesh(this);
 }
 
-L3DMat3 L3DMesh::normalMatrix() const
+L3DAABB L3DMesh::worldBounds() const
+{
+    L3DVec3 center = L3DVec3(this->transMatrix * L3DVec4(m_bounds.center(), 1.0f));
+    L3DVec3 extents = m_bounds.extents();
+    L3DMat3 absMatrix = L3DMat3(this->transMatrix);
+
+    for (unsigned int c = 0; c < 3; ++c)
+        absMatrix[c] = glm::abs(absMatrix[c]);
+
+    // Extents of transformed box, projected on world axes.
+    extents = absMatrix * extents;
+
+    return L3DAABB(center - extents, center + extents);
+}
+
+L3DBoundingSphere L3DMesh::worldBoundingSphere() const
 {
-    return glm::transpose(glm::inverse(L3DMat3(this->transMatrix)));
+    L3DVec3 center = L3DVec3(this->transMatrix * L3DVec4(m_bounds.center(), 1.0f));
+
+    // Radius is scaled by the largest axis scale.
+    float scale = glm::max(
+        glm::length(L3DVec3(this->transMatrix[0])),
+        glm::max(glm::length(L3DVec3(this->transMatrix[1])), glm::length(L3DVec3(this->transMatrix[2])))
+    );
+
+    return L3DBoundingSphere(center, m_boundingRadius * scale);
 }
 
 unsigned int L3DMesh::vertexCount() const
@@ -117,7 +177,7 @@ unsigned int L3DMesh::indexCount() const
 
 unsigned int L3DMesh::instanceCount() const
 {
-    return m_instanceBuffer ? m_instanceBuffer->count() : 1;
+    return m_instanceBuffer ? m_instanceCount : 1;
 }
 
 unsigned int L3DMesh::primitiveCount() const
@@ -189,11 +249,69 @@ void L3DMesh::recalculateTangents()
         vertices[vertexOffset+7] = tan.y;
         vertices[vertexOffset+8] = tan.z;
     }
+
+    m_vertexBuffer->invalidate(0, m_vertexBuffer->size());
+}
+
+void L3DMesh::updateBounds()
+{
+    unsigned int vertexCount = this->vertexCount();
+    float* vertices = m_vertexBuffer ? m_vertexBuffer->data<float>() : L3D_NULLPTR;
+
+    m_bounds = L3DAABB();
+    m_boundingRadius = 0;
+
+    if (!vertices || vertexCount == 0)
+        return;
+
+    // 2D meshes lie on z = 0.
+    bool is2D = (m_vertexFormat == L3D_VERTEX_POS2 || m_vertexFormat == L3D_VERTEX_POS2_UV2);
+
+    L3DVec3 min(vertices[0], vertices[1], is2D ? 0.0f : vertices[2]);
+    L3DVec3 max = min;
+
+    for (unsigned int v = 1; v < vertexCount; ++v)
+    {
+        unsigned int vertexOffset = v * m_vertexFormat;
+        L3DVec3 pos(vertices[vertexOffset+0], vertices[vertexOffset+1], is2D ? 0.0f : vertices[vertexOffset+2]);
+
+        min = glm::min(min, pos);
+        max = glm::max(max, pos);
+    }
+
+    m_bounds = L3DAABB(min, max);
+
+    // Sphere shares AABB center, but it's usually tighter than its diagonal.
+    L3DVec3 center = m_bounds.center();
+    float radius2 = 0;
+
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        unsigned int vertexOffset = v * m_vertexFormat;
+        L3DVec3 pos(vertices[vertexOffset+0], vertices[vertexOffset+1], is2D ? 0.0f : vertices[vertexOffset+2]);
+
+        radius2 = glm::max(radius2, glm::dot(pos - center, pos - center));
+    }
+
+    m_boundingRadius = glm::sqrt(radius2);
+
+    this->invalidateWorldBounds();
+}
+
+void L3DMesh::setTransMatrix(const L3DMat4& transMatrix)
+{
+    if (m_node)
+        m_localMatrix = transMatrix;
+    else
+        this->transMatrix = transMatrix;
+    this->updateTransMatrix();
 }
 
 void L3DMesh::translate(const L3DVec3& movement)
 {
-    transMatrix = glm::translate(this->transMatrix, movement);
+    L3DMat4& matrix = m_node ? m_localMatrix : this->transMatrix;
+    matrix = glm::translate(matrix, movement);
+    this->updateTransMatrix();
 }
 
 void L3DMesh::rotate(
@@ -201,14 +319,18 @@ void L3DMesh::rotate(
     const L3DVec3& direction
 )
 {
-    this->transMatrix = glm::rotate(this->transMatrix, radians, direction);
+    L3DMat4& matrix = m_node ? m_localMatrix : this->transMatrix;
+    matrix = glm::rotate(matrix, radians, direction);
+    this->updateTransMatrix();
 }
 
 void L3DMesh::scale(
     const L3DVec3& factor
 )
 {
-    this->transMatrix = glm::scale(this->transMatrix, factor);
+    L3DMat4& matrix = m_node ? m_localMatrix : this->transMatrix;
+    matrix = glm::scale(matrix, factor);
+    this->updateTransMatrix();
 }
 
 void L3DMesh::setMaterial(L3DMaterial* material)
@@ -229,6 +351,22 @@ void L3DMesh::setRenderLayer(unsigned char renderLayer)
     }
 }
 
+void L3DMesh::updateVertices(
+    const float* vertices,
+    unsigned int vertexCount,
+    unsigned int firstVertex
+)
+{
+    if (!m_vertexBuffer || !vertices || !vertexCount)
+        return;
+
+    unsigned int stride = m_vertexBuffer->stride();
+
+    m_vertexBuffer->update(vertices, firstVertex * stride, vertexCount * stride);
+
+    this->updateBounds();
+}
+
 void L3DMesh::setInstances(
     L3DBuffer* instanceBuffer,
     const L3DInstanceFormat& instanceFormat
@@ -236,14 +374,26 @@ void L3DMesh::setInstances(
 {
     if (instanceBuffer && instanceFormat)
     {
-        // TODO: clean previous instance buffer.
+        L3DBuffer* previousBuffer = m_instanceBuffer;
+
         m_instanceBuffer = instanceBuffer;
         m_instanceFormat = instanceFormat;
+        m_instanceCount = instanceBuffer->count();
+
+        // Instances are placed by shaders, mesh bounds don't hold anymore.
+        this->setFlag(L3D_MESH_CULLING, false);
         this->updateSortKey();
 
+        // Instance attributes are rebound in place, keeping mesh id.
         L3DRenderer* renderer = this->renderer();
-        renderer->removeMesh(this);
-        renderer->addMesh(this);
+        if (renderer)
+            renderer->updateMeshInstances(this);
+
+        // Buffers created by the mesh are not shared.
+        if (previousBuffer && previousBuffer != instanceBuffer && m_ownsInstanceBuffer)
+            delete previousBuffer;
+
+        m_ownsInstanceBuffer = false;
     }
 }
 
@@ -255,22 +405,97 @@ void L3DMesh::setInstances(
 {
     if (instances && instanceCount && instanceFormat)
     {
+        unsigned int size = instanceCount * instanceFormat * sizeof(float);
+
+        // Overwrites own buffer if it has same layout and size.
+        if (m_ownsInstanceBuffer
+            && m_instanceFormat == instanceFormat
+            && m_instanceBuffer->size() == size)
+        {
+            m_instanceBuffer->update(instances, 0, size);
+            m_instanceCount = instanceCount;
+            return;
+        }
+
         L3DBuffer* instanceBuffer = new L3DBuffer(
           this->renderer(),
           L3D_BUFFER_INSTANCE,
           instances,
-          instanceCount * instanceFormat * sizeof(float),
+          size,
           instanceFormat * sizeof(float),
           L3D_DRAW_STATIC
         );
 
         this->setInstances(instanceBuffer, instanceFormat);
+        m_ownsInstanceBuffer = true;
+    }
+}
+
+void* L3DMesh::mapInstances(
+    unsigned int maxInstanceCount,
+    const L3DInstanceFormat& instanceFormat
+)
+{
+    if (!maxInstanceCount || !instanceFormat)
+        return L3D_NULLPTR;
+
+    // Streamed instances live in dynamic buffers, which are written in
+    // turn by frames without waiting for the GPU.
+    if (!m_ownsInstanceBuffer
+        || m_instanceFormat != instanceFormat
+        || m_instanceBuffer->drawType() != L3D_DRAW_DYNAMIC
+        || m_instanceBuffer->count() < maxInstanceCount)
+    {
+        L3DBuffer* instanceBuffer = new L3DBuffer(
+          this->renderer(),
+          L3D_BUFFER_INSTANCE,
+          L3D_NULLPTR,
+          maxInstanceCount * instanceFormat * sizeof(float),
+          instanceFormat * sizeof(float),
+          L3D_DRAW_DYNAMIC
+        );
+
+        this->setInstances(instanceBuffer, instanceFormat);
+        m_ownsInstanceBuffer = true;
+        m_instanceCount = 0;
     }
+
+    return m_instanceBuffer->data();
+}
+
+void L3DMesh::commitInstances(unsigned int instanceCount)
+{
+    if (!m_instanceBuffer)
+        return;
+
+    m_instanceCount = glm::min(instanceCount, m_instanceBuffer->count());
+    m_instanceBuffer->invalidate(0, m_instanceCount * m_instanceBuffer->stride());
 }
 
 void L3DMesh::updateSortKey()
 {
-    m_sortKey = (m_renderLayer << 24) | ((m_material ? m_material->id() : 0) << 8);
+    m_sortKey = (m_renderLayer << 24) | ((m_material ? m_material->id() : 0) & 0xFFFFFF);
+
+    // Meshes not yet added to renderer are bucketed by L3DRenderer::addMesh().
+    L3DRenderer* renderer = this->renderer();
+    if (renderer && this->id())
+        renderer->updateRenderBucket(this);
+}
 
-    // TODO Update L3DRenderer's render bucket...
+void L3DMesh::invalidateWorldBounds()
+{
+    // Normal matrices of meshes added to renderer are updated in batches.
+    L3DRenderer* renderer = this->renderer();
+    if (renderer && this->id())
+        renderer->invalidateMeshBounds(this);
+    else
+        m_normalMatrix = L3DMatrixBatch::normalMatrix(this->transMatrix);
+}
+
+void L3DMesh::updateTransMatrix()
+{
+    L3DRenderer* renderer = this->renderer();
+    if (m_node && renderer)
+        this->transMatrix = renderer->transformGraph().worldMatrix(m_node) * m_localMatrix;
+    this->invalidateWorldBounds();
 }
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <cstdlib>
+#include <leaf3d/L3DObjectPool.h>
+
+using namespace l3d;
+
+// Blocks keep the alignment of malloc, enough for any engine type.
+static const unsigned int _blockAlignment = 16;
+
+L3DObjectPool::L3DObjectPool(unsigned int blockSize, unsigned int chunkBlockCount) :
+    m_blockSize(blockSize),
+    m_chunkBlockCount(chunkBlockCount > 0 ? chunkBlockCount : 1),
+    m_freeBlock(L3D_NULLPTR),
+    m_blockCount(0)
+{
+    // Released blocks hold the pointer to next free one.
+    if (m_blockSize < sizeof(void*))
+        m_blockSize = sizeof(void*);
+
+    m_blockSize = (m_blockSize + _blockAlignment - 1) & ~(_blockAlignment - 1);
+}
+
+L3DObjectPool::~L3DObjectPool()
+{
+    for (std::vector<unsigned char*>::iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+        free(*it);
+}
+
+void* L3DObjectPool::allocate()
+{
+    if (!m_freeBlock && !this->grow())
+        return L3D_NULLPTR;
+
+    void* block = m_freeBlock;
+    m_freeBlock = *static_cast<void**>(block);
+    ++m_blockCount;
+
+    return block;
+}
+
+void L3DObjectPool::release(void* block)
+{
+    if (!block)
+        return;
+
+    *static_cast<void**>(block) = m_freeBlock;
+    m_freeBlock = block;
+    --m_blockCount;
+}
+
+bool L3DObjectPool::grow()
+{
+    unsigned char* chunk = static_cast<unsigned char*>(malloc(m_blockSize * m_chunkBlockCount));
+
+    if (!chunk)
+        return false;
+
+    m_chunks.push_back(chunk);
+
+    // Links blocks in address order, so they are handed out in sequence.
+    for (unsigned int i = m_chunkBlockCount; i > 0; --i)
+    {
+        void* block = chunk + (i - 1) * m_blockSize;
+        *static_cast<void**>(block) = m_freeBlock;
+        m_freeBlock = block;
+    }
+
+    return true;
+}
@@ -0,0 +1,375 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <float.h>
+#include <algorithm>
+#include <leaf3d/L3DOcclusionBuffer.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define L3D_OCCLUSION_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace l3d;
+
+L3DOcclusionBuffer::L3DOcclusionBuffer(
+    unsigned int width,
+    unsigned int height
+) : m_width(0),
+    m_height(0),
+    m_hierarchyDirty(false),
+    m_occluderTriangleCount(0),
+    m_testedCount(0),
+    m_occludedCount(0)
+{
+    this->resize(width, height);
+}
+
+void L3DOcclusionBuffer::resize(unsigned int width, unsigned int height)
+{
+    // Rows are processed 4 pixels at a time and halved by 8 pixels blocks.
+    m_width = (glm::max(width, 1u) + 7) & ~7u;
+    m_height = glm::max(height, 1u);
+
+    m_levels.clear();
+    m_levelWidths.clear();
+    m_levelHeights.clear();
+
+    unsigned int w = m_width;
+    unsigned int h = m_height;
+
+    while (true)
+    {
+        m_levels.push_back(std::vector<float>(w * h, 1.0f));
+        m_levelWidths.push_back(w);
+        m_levelHeights.push_back(h);
+
+        if (w == 1 && h == 1)
+            break;
+
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+
+    m_hierarchyDirty = false;
+}
+
+float L3DOcclusionBuffer::depth(unsigned int x, unsigned int y, unsigned int level) const
+{
+    if (level >= m_levels.size() || x >= m_levelWidths[level] || y >= m_levelHeights[level])
+        return 1.0f;
+
+    return m_levels[level][y * m_levelWidths[level] + x];
+}
+
+void L3DOcclusionBuffer::clear(const L3DMat4& vpMat)
+{
+    m_vpMat = vpMat;
+
+    for (unsigned int l = 0; l < m_levels.size(); ++l)
+        std::fill(m_levels[l].begin(), m_levels[l].end(), 1.0f);
+
+    m_hierarchyDirty = false;
+    m_occluderTriangleCount = 0;
+    m_testedCount = 0;
+    m_occludedCount = 0;
+}
+
+void L3DOcclusionBuffer::rasterize(
+    const float* vertices,
+    unsigned int vertexCount,
+    unsigned int stride,
+    const unsigned int* indices,
+    unsigned int indexCount,
+    const L3DMat4& modelMat
+)
+{
+    if (!vertices || vertexCount == 0)
+        return;
+
+    L3DMat4 mvpMat = m_vpMat * modelMat;
+
+    // Transforms each vertex once, they are shared by triangles.
+    m_clipVertices.resize(vertexCount);
+
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        const float* pos = vertices + v * stride;
+        m_clipVertices[v] = mvpMat * L3DVec4(pos[0], pos[1], pos[2], 1.0f);
+    }
+
+    if (indices && indexCount > 0)
+    {
+        for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+        {
+            if (indices[i] >= vertexCount || indices[i+1] >= vertexCount || indices[i+2] >= vertexCount)
+                continue;
+
+            this->rasterizeTriangle(
+                m_clipVertices[indices[i]],
+                m_clipVertices[indices[i+1]],
+                m_clipVertices[indices[i+2]]
+            );
+        }
+    }
+    else
+    {
+        for (unsigned int v = 0; v + 2 < vertexCount; v += 3)
+            this->rasterizeTriangle(m_clipVertices[v], m_clipVertices[v+1], m_clipVertices[v+2]);
+    }
+
+    m_hierarchyDirty = true;
+}
+
+void L3DOcclusionBuffer::rasterizeTriangle(
+    const L3DVec4& v0,
+    const L3DVec4& v1,
+    const L3DVec4& v2
+)
+{
+    // Triangles crossing near plane are skipped: the GPU clips them, so
+    // drawing them here could hide visible meshes.
+    if (v0.z < -v0.w || v1.z < -v1.w || v2.z < -v2.w || v0.w <= 0 || v1.w <= 0 || v2.w <= 0)
+        return;
+
+    float w = (float)m_width;
+    float h = (float)m_height;
+
+    float x0 = (v0.x / v0.w * 0.5f + 0.5f) * w;
+    float y0 = (v0.y / v0.w * 0.5f + 0.5f) * h;
+    float z0 = v0.z / v0.w * 0.5f + 0.5f;
+    float x1 = (v1.x / v1.w * 0.5f + 0.5f) * w;
+    float y1 = (v1.y / v1.w * 0.5f + 0.5f) * h;
+    float z1 = v1.z / v1.w * 0.5f + 0.5f;
+    float x2 = (v2.x / v2.w * 0.5f + 0.5f) * w;
+    float y2 = (v2.y / v2.w * 0.5f + 0.5f) * h;
+    float z2 = v2.z / v2.w * 0.5f + 0.5f;
+
+    float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+
+    if (area == 0.0f)
+        return;
+
+    // Both windings are drawn, edges are flipped to keep inside positive.
+    if (area < 0.0f)
+    {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+        std::swap(z1, z2);
+        area = -area;
+    }
+
+    int minX = glm::max((int)glm::floor(glm::min(x0, glm::min(x1, x2))), 0);
+    int maxX = glm::min((int)glm::ceil(glm::max(x0, glm::max(x1, x2))), (int)m_width - 1);
+    int minY = glm::max((int)glm::floor(glm::min(y0, glm::min(y1, y2))), 0);
+    int maxY = glm::min((int)glm::ceil(glm::max(y0, glm::max(y1, y2))), (int)m_height - 1);
+
+    if (minX > maxX || minY > maxY)
+        return;
+
+    ++m_occluderTriangleCount;
+
+    // Edge functions e = a * x + b * y + c, positive inside.
+    float a01 = y0 - y1, b01 = x1 - x0, c01 = x0 * y1 - x1 * y0;
+    float a12 = y1 - y2, b12 = x2 - x1, c12 = x1 * y2 - x2 * y1;
+    float a20 = y2 - y0, b20 = x0 - x2, c20 = x2 * y0 - x0 * y2;
+
+    // Depth plane, from barycentric weights.
+    float invArea = 1.0f / area;
+    float dzdx = (a12 * z0 + a20 * z1 + a01 * z2) * invArea;
+    float dzdy = (b12 * z0 + b20 * z1 + b01 * z2) * invArea;
+    float dzc = (c12 * z0 + c20 * z1 + c01 * z2) * invArea;
+
+    float* depth = &m_levels[0][0];
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        float py = y + 0.5f;
+        float* row = depth + y * m_width;
+        int x = minX;
+
+#ifdef L3D_OCCLUSION_SSE
+        // Rows are 8 aligned, so 4 pixels blocks never cross them.
+        x = minX & ~3;
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 step = _mm_set1_ps(4.0f);
+        const __m128 ea01 = _mm_set1_ps(a01);
+        const __m128 ea12 = _mm_set1_ps(a12);
+        const __m128 ea20 = _mm_set1_ps(a20);
+        const __m128 zdx = _mm_set1_ps(dzdx);
+        const __m128 e01 = _mm_set1_ps(b01 * py + c01);
+        const __m128 e12 = _mm_set1_ps(b12 * py + c12);
+        const __m128 e20 = _mm_set1_ps(b20 * py + c20);
+        const __m128 zy = _mm_set1_ps(dzdy * py + dzc);
+
+        __m128 sx = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_set_ps(3, 2, 1, 0));
+
+        for (; x <= maxX; x += 4)
+        {
+            __m128 inside = _mm_and_ps(
+                _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ea01, sx), e01), zero),
+                _mm_and_ps(
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ea12, sx), e12), zero),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ea20, sx), e20), zero)
+                )
+            );
+
+            if (_mm_movemask_ps(inside))
+            {
+                __m128 z = _mm_add_ps(_mm_mul_ps(zdx, sx), zy);
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(old, z);
+
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+            }
+
+            sx = _mm_add_ps(sx, step);
+        }
+#endif
+
+        for (; x <= maxX; ++x)
+        {
+            float px = x + 0.5f;
+
+            if (a01 * px + b01 * py + c01 < 0.0f ||
+                a12 * px + b12 * py + c12 < 0.0f ||
+                a20 * px + b20 * py + c20 < 0.0f)
+                continue;
+
+            float z = dzdx * px + dzdy * py + dzc;
+            if (z < row[x])
+                row[x] = z;
+        }
+    }
+}
+
+void L3DOcclusionBuffer::updateHierarchy()
+{
+    for (unsigned int l = 1; l < m_levels.size(); ++l)
+    {
+        const float* src = &m_levels[l-1][0];
+        float* dst = &m_levels[l][0];
+        unsigned int srcWidth = m_levelWidths[l-1];
+        unsigned int srcHeight = m_levelHeights[l-1];
+        unsigned int width = m_levelWidths[l];
+        unsigned int height = m_levelHeights[l];
+
+        for (unsigned int y = 0; y < height; ++y)
+        {
+            const float* row0 = src + (2 * y) * srcWidth;
+            const float* row1 = src + glm::min(2 * y + 1, srcHeight - 1) * srcWidth;
+            float* out = dst + y * width;
+            unsigned int x = 0;
+
+#ifdef L3D_OCCLUSION_SSE
+            // Reduces 8 source texels of both rows to 4 at once.
+            if (srcWidth % 8 == 0)
+            {
+                for (; x + 4 <= width; x += 4)
+                {
+                    __m128 lo = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x), _mm_loadu_ps(row1 + 2 * x));
+                    __m128 hi = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x + 4), _mm_loadu_ps(row1 + 2 * x + 4));
+
+                    _mm_storeu_ps(out + x, _mm_max_ps(
+                        _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)),
+                        _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))
+                    ));
+                }
+            }
+#endif
+
+            for (; x < width; ++x)
+            {
+                unsigned int x0 = 2 * x;
+                unsigned int x1 = glm::min(2 * x + 1, srcWidth - 1);
+
+                out[x] = glm::max(glm::max(row0[x0], row0[x1]), glm::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+
+    m_hierarchyDirty = false;
+}
+
+bool L3DOcclusionBuffer::isOccluded(const L3DAABB& aabb)
+{
+    ++m_testedCount;
+
+    if (m_hierarchyDirty)
+        this->updateHierarchy();
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    // Screen rectangle and nearest depth of the box corners.
+    for (unsigned int c = 0; c < 8; ++c)
+    {
+        L3DVec4 corner(
+            (c & 1) ? aabb.max.x : aabb.min.x,
+            (c & 2) ? aabb.max.y : aabb.min.y,
+            (c & 4) ? aabb.max.z : aabb.min.z,
+            1.0f
+        );
+        L3DVec4 clip = m_vpMat * corner;
+
+        // Boxes reaching the camera plane are never occluded.
+        if (clip.w <= 0.0f)
+            return false;
+
+        float x = (clip.x / clip.w * 0.5f + 0.5f) * m_width;
+        float y = (clip.y / clip.w * 0.5f + 0.5f) * m_height;
+        float z = clip.z / clip.w * 0.5f + 0.5f;
+
+        minX = glm::min(minX, x); maxX = glm::max(maxX, x);
+        minY = glm::min(minY, y); maxY = glm::max(maxY, y);
+        minZ = glm::min(minZ, z);
+    }
+
+    int x0 = glm::max((int)glm::floor(minX), 0);
+    int x1 = glm::min((int)glm::floor(maxX), (int)m_width - 1);
+    int y0 = glm::max((int)glm::floor(minY), 0);
+    int y1 = glm::min((int)glm::floor(maxY), (int)m_height - 1);
+
+    if (x0 > x1 || y0 > y1)
+        return false;
+
+    // Picks the finest level where the rectangle spans a few texels.
+    unsigned int level = 0;
+    while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3))
+        ++level;
+
+    const std::vector<float>& depth = m_levels[level];
+    unsigned int width = m_levelWidths[level];
+
+    for (int y = (y0 >> level); y <= (y1 >> level); ++y)
+    {
+        for (int x = (x0 >> level); x <= (x1 >> level); ++x)
+        {
+            if (depth[y * width + x] >= minZ)
+                return false;
+        }
+    }
+
+    ++m_occludedCount;
+
+    return true;
+}
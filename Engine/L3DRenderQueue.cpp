@@ -19,7 +19,9 @@
  * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
  */
 
+#include <string.h>
 #include <leaf3d/L3DRenderer.h>
+#include <leaf3d/L3DFrameBuffer.h>
 #include <leaf3d/L3DRenderQueue.h>
 
 using namespace l3d;
@@ -28,29 +30,34 @@ L3DRenderQueue::L3DRenderQueue(
     L3DRenderer* renderer,
     const char* name
 ) : L3DResource(L3D_RENDER_QUEUE, renderer),
-    m_name(name)
+    m_name(name),
+    m_compiled(false)
 {
     if (renderer) renderer->addRenderQueue(this);
 }
 
 L3DRenderQueue::~L3DRenderQueue()
 {
-    for (L3DRenderCommandList::reverse_iterator it = m_commands.rbegin(); it != m_commands.rend(); ++it)
-        delete *it;
+}
+
+void L3DRenderQueue::clear()
+{
     m_commands.clear();
+    m_compiled = false;
 }
 
 void L3DRenderQueue::appendCommands(const L3DRenderCommandList& commands)
 {
-    m_commands.reserve(commands.size());
     m_commands.insert(m_commands.end(), commands.begin(), commands.end());
+    m_compiled = false;
 }
 
 void L3DRenderQueue::addSwitchFrameBufferCommand(L3DFrameBuffer* frameBuffer)
 {
-    m_commands.push_back(
-        new L3DSwitchFrameBufferCommand(frameBuffer)
-    );
+    L3DRenderCommand& command = this->addCommand(L3D_SWITCH_FRAME_BUFFER);
+
+    if (frameBuffer)
+        command.switchFrameBuffer.frameBuffer = frameBuffer->handle();
 }
 
 void L3DRenderQueue::addClearBuffersCommand(
@@ -60,9 +67,15 @@ void L3DRenderQueue::addClearBuffersCommand(
     const L3DVec4& clearColor
 )
 {
-    m_commands.push_back(
-        new L3DClearBuffersCommand(colorBuffer, depthBuffer, stencilBuffer, clearColor)
-    );
+    L3DRenderCommand& command = this->addCommand(L3D_CLEAR_BUFFERS);
+
+    command.clearBuffers.colorBuffer = colorBuffer;
+    command.clearBuffers.depthBuffer = depthBuffer;
+    command.clearBuffers.stencilBuffer = stencilBuffer;
+    command.clearBuffers.clearColor[0] = clearColor.r;
+    command.clearBuffers.clearColor[1] = clearColor.g;
+    command.clearBuffers.clearColor[2] = clearColor.b;
+    command.clearBuffers.clearColor[3] = clearColor.a;
 }
 
 void L3DRenderQueue::addSetDepthTestCommand(
@@ -70,27 +83,28 @@ void L3DRenderQueue::addSetDepthTestCommand(
     const L3DDepthFactor& factor
 )
 {
-    m_commands.push_back(
-        new L3DSetDepthTestCommand(enable, factor)
-    );
+    L3DRenderCommand& command = this->addCommand(L3D_SET_DEPTH_TEST);
+
+    command.setDepthTest.enable = enable;
+    command.setDepthTest.factor = factor;
 }
 
 void L3DRenderQueue::addSetDepthMaskCommand(
     bool enable
 )
 {
-    m_commands.push_back(
-        new L3DSetDepthMaskCommand(enable)
-    );
+    L3DRenderCommand& command = this->addCommand(L3D_SET_DEPTH_MASK);
+
+    command.setDepthMask.enable = enable;
 }
 
 void L3DRenderQueue::addSetStencilTestCommand(
     bool enable
 )
 {
-    m_commands.push_back(
-        new L3DSetStencilTestCommand(enable)
-    );
+    L3DRenderCommand& command = this->addCommand(L3D_SET_STENCIL_TEST);
+
+    command.setStencilTest.enable = enable;
 }
 
 void L3DRenderQueue::addSetBlendCommand(
@@ -99,9 +113,11 @@ void L3DRenderQueue::addSetBlendCommand(
     const L3DBlendFactor& dstFactor
 )
 {
-    m_commands.push_back(
-        new L3DSetBlendCommand(enable, srcFactor, dstFactor)
-    );
+    L3DRenderCommand& command = this->addCommand(L3D_SET_BLEND);
+
+    command.setBlend.enable = enable;
+    command.setBlend.srcFactor = srcFactor;
+    command.setBlend.dstFactor = dstFactor;
 }
 
 void L3DRenderQueue::addSetCullFaceCommand(
@@ -109,14 +125,28 @@ void L3DRenderQueue::addSetCullFaceCommand(
     const L3DCullFace& cullFace
 )
 {
-    m_commands.push_back(
-        new L3DSetCullFaceCommand(enable, cullFace)
-    );
+    L3DRenderCommand& command = this->addCommand(L3D_SET_CULL_FACE);
+
+    command.setCullFace.enable = enable;
+    command.setCullFace.cullFace = cullFace;
 }
 
 void L3DRenderQueue::addDrawMeshesCommand(unsigned char renderLayer)
 {
-    m_commands.push_back(
-        new L3DDrawMeshesCommand(renderLayer)
-    );
+    L3DRenderCommand& command = this->addCommand(L3D_DRAW_MESHES);
+
+    command.drawMeshes.renderLayer = renderLayer;
+}
+
+L3DRenderCommand& L3DRenderQueue::addCommand(const L3DRenderCommandType& type)
+{
+    // Records are zeroed, so unset fields have known values.
+    L3DRenderCommand command;
+    memset(&command, 0, sizeof(L3DRenderCommand));
+    command.type = type;
+
+    m_commands.push_back(command);
+    m_compiled = false;
+
+    return m_commands.back();
 }
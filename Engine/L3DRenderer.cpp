@@ -21,7 +21,7 @@
 
 #include <stdio.h>
 #include <sstream>
-#include <list>
+#include <algorithm>
 #include <leaf3d/L3DBuffer.h>
 #include <leaf3d/L3DTexture.h>
 #include <leaf3d/L3DShader.h>
@@ -33,29 +33,52 @@
 #include <leaf3d/L3DMesh.h>
 #include <leaf3d/L3DRenderQueue.h>
 #include <leaf3d/L3DRenderer.h>
+#include <leaf3d/L3DMatrixBatch.h>
+#include <leaf3d/L3DGLBackend.h>
 
 using namespace l3d;
 
-typedef std::list<L3DMesh*> L3DRenderBucket;
+// Adds to a counter of current render layer, or of frame outside layers.
+#ifdef L3D_NO_FRAME_STATS
+#define L3D_COUNT(counter, value)
+#else
+#define L3D_COUNT(counter, value) (m_stats->counter += (value))
 
-struct _l3dMeshSortFunctor {
-    bool operator() (L3DMesh* i, L3DMesh* j) { return i->sortKey() < j->sortKey(); }
-};
+static unsigned int _triangleCount(const L3DDrawPrimitive& primitive, unsigned int vertexCount)
+{
+    return primitive == L3D_DRAW_TRIANGLES ? vertexCount / 3 : 0;
+}
+#endif
 
-static GLenum _toOpenGL(const L3DBufferType& orig)
+static unsigned int _bufferId(L3DBuffer* buffer)
 {
-    switch (orig)
-    {
-    case L3D_BUFFER_VERTEX:
-    case L3D_BUFFER_INSTANCE:
-        return GL_ARRAY_BUFFER;
-    case L3D_BUFFER_INDEX:
-        return GL_ELEMENT_ARRAY_BUFFER;
-    default:
-        break;
-    }
+    return buffer ? buffer->id() : 0;
+}
 
-    return 0;
+static L3DBufferArena* _bufferArena(L3DBuffer* buffer)
+{
+    return buffer ? buffer->arena() : L3D_NULLPTR;
+}
+
+// Return true if VAO of a can draw b, i.e. both read same attributes
+// from same arenas.
+static bool _sharesVertexArray(L3DMesh* a, L3DMesh* b)
+{
+    return a->material()->shaderProgram() == b->material()->shaderProgram()
+        && a->vertexFormat() == b->vertexFormat()
+        && _bufferArena(a->vertexBuffer()) == _bufferArena(b->vertexBuffer())
+        && _bufferArena(a->indexBuffer()) == _bufferArena(b->indexBuffer())
+        && !a->instanceBuffer()
+        && !b->instanceBuffer();
+}
+
+// Packets are sorted by mesh sort key, then by geometry, so that meshes
+// sharing it are adjacent. Ids of handles fit in 24 bits. Sort is stable,
+// so equal keys keep the order meshes are recorded in.
+static unsigned long long _drawPacketKey(L3DMesh* mesh)
+{
+    return ((unsigned long long)mesh->sortKey() << 32)
+        | (_bufferId(mesh->vertexBuffer()) & 0xFFFFFF);
 }
 
 static GLenum _toOpenGL(const L3DDrawType& orig)
@@ -383,13 +406,97 @@ static void _enableVertexAttribute(
     }
 }
 
+static bool _enableVertexAttributes(
+    const L3DVertexFormat& vertexFormat,
+    const GLint* locations
+)
+{
+    switch(vertexFormat)
+    {
+    case L3D_VERTEX_POS2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 2, GL_FLOAT, 2*sizeof(GLfloat), 0);
+        break;
+    case L3D_VERTEX_POS3:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 3*sizeof(GLfloat), 0);
+        break;
+    case L3D_VERTEX_POS2_UV2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 2, GL_FLOAT, 4*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 2, GL_FLOAT, 4*sizeof(GLfloat), (void*)(2*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_UV2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 5*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 2, GL_FLOAT, 5*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_UV3:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 6*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 3, GL_FLOAT, 6*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_NOR3_UV2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 8*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_NORMAL], 3, GL_FLOAT, 8*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 2, GL_FLOAT, 8*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_NOR3_UV3:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 9*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_NORMAL], 3, GL_FLOAT, 9*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 3, GL_FLOAT, 9*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_NOR3_UV2_UV2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 10*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_NORMAL], 3, GL_FLOAT, 10*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 2, GL_FLOAT, 10*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV1], 2, GL_FLOAT, 10*sizeof(GLfloat), (void*)(8*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_NOR3_TAN3_UV2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 11*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_NORMAL], 3, GL_FLOAT, 11*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_TANGENT], 3, GL_FLOAT, 11*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 2, GL_FLOAT, 11*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_NOR3_TAN3_UV3:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 12*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_NORMAL], 3, GL_FLOAT, 12*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_TANGENT], 3, GL_FLOAT, 12*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 3, GL_FLOAT, 12*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_NOR3_TAN3_UV2_UV2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 13*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_NORMAL], 3, GL_FLOAT, 13*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_TANGENT], 3, GL_FLOAT, 13*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 2, GL_FLOAT, 13*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV1], 2, GL_FLOAT, 13*sizeof(GLfloat), (void*)(11*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_NOR3_TAN3_UV2_UV2_UV2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 15*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_NORMAL], 3, GL_FLOAT, 15*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_TANGENT], 3, GL_FLOAT, 15*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 2, GL_FLOAT, 15*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV1], 2, GL_FLOAT, 15*sizeof(GLfloat), (void*)(11*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV2], 2, GL_FLOAT, 15*sizeof(GLfloat), (void*)(13*sizeof(GLfloat)));
+        break;
+    case L3D_VERTEX_POS3_NOR3_TAN3_UV2_UV2_UV2_UV2:
+        _enableVertexAttribute(locations[L3D_VERTEX_POSITION], 3, GL_FLOAT, 17*sizeof(GLfloat), 0);
+        _enableVertexAttribute(locations[L3D_VERTEX_NORMAL], 3, GL_FLOAT, 17*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_TANGENT], 3, GL_FLOAT, 17*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV0], 2, GL_FLOAT, 17*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV1], 2, GL_FLOAT, 17*sizeof(GLfloat), (void*)(11*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV2], 2, GL_FLOAT, 17*sizeof(GLfloat), (void*)(13*sizeof(GLfloat)));
+        _enableVertexAttribute(locations[L3D_VERTEX_UV3], 2, GL_FLOAT, 17*sizeof(GLfloat), (void*)(15*sizeof(GLfloat)));
+        break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
 static void _setUniform(
-    GLuint shaderProgram,
-    const char* name,
+    GLint gl_location,
     const L3DUniform& uniform
 )
 {
-    GLint gl_location = glGetUniformLocation(shaderProgram, name);
+    if (gl_location < 0)
+        return;
 
     switch (uniform.type)
     {
@@ -425,8 +532,121 @@ static void _setUniform(
     }
 }
 
-L3DRenderer::L3DRenderer()
+static const void* _uniformData(const L3DUniform& uniform)
+{
+    switch (uniform.type)
+    {
+    case L3D_UNIFORM_VEC2:
+        return uniform.value.valueVec2;
+    case L3D_UNIFORM_VEC3:
+        return uniform.value.valueVec3;
+    case L3D_UNIFORM_VEC4:
+        return uniform.value.valueVec4;
+    case L3D_UNIFORM_MAT3:
+        return uniform.value.valueMat3;
+    case L3D_UNIFORM_MAT4:
+        return uniform.value.valueMat4;
+    default:
+        return &uniform.value;
+    }
+}
+
+static unsigned int _uniformSize(const L3DUniform& uniform)
+{
+    switch (uniform.type)
+    {
+    case L3D_UNIFORM_FLOAT:
+        return sizeof(float);
+    case L3D_UNIFORM_INT:
+        return sizeof(int);
+    case L3D_UNIFORM_UINT:
+        return sizeof(unsigned int);
+    case L3D_UNIFORM_BOOL:
+        return sizeof(bool);
+    case L3D_UNIFORM_VEC2:
+        return 2 * sizeof(float);
+    case L3D_UNIFORM_VEC3:
+        return 3 * sizeof(float);
+    case L3D_UNIFORM_VEC4:
+        return 4 * sizeof(float);
+    case L3D_UNIFORM_MAT3:
+        return 9 * sizeof(float);
+    case L3D_UNIFORM_MAT4:
+        return 16 * sizeof(float);
+    default:
+        return 0;
+    }
+}
+
+static const unsigned int _unknownState = 0xFFFFFFFF;
+
+static const char* _frameUniformBlockName = "L3DFrame";
+static const GLuint _frameUniformBinding = 0;
+
+static const char* _drawDataBlockName = "L3DDraws";
+static const GLuint _drawDataBinding = 0;
+
+// Initial size of buffer arenas, in bytes.
+static const unsigned int _bufferArenaSize = 1 << 20;
+
+// Fixed attribute locations used by indirect draws.
+static const GLint _arenaAttributeLocations[L3D_MAX_VERTEX_ATTRIBUTE] = { 0, 1, 2, 3, 4, 5, 6 };
+static const GLuint _drawIdLocation = L3D_MAX_INSTANCE_ATTRIBUTE;
+
+// Fewest items worth a job of their own.
+static const unsigned int _minRecordedMeshesPerJob = 1024;
+static const unsigned int _boundsUpdateGrainSize = 256;
+static const unsigned int _cullGrainSize = 1024;
+
+// Normal matrices computed by a single kernel call.
+static const unsigned int _normalMatrixBatchSize = 64;
+
+void L3DRenderState::invalidate()
+{
+    this->shaderProgram = _unknownState;
+    this->vertexArray = _unknownState;
+    this->frameBuffer = _unknownState;
+    this->activeTextureUnit = _unknownState;
+
+    for (unsigned int i = 0; i < L3D_MAX_TEXTURE_UNITS; ++i)
+        for (unsigned int t = 0; t < 4; ++t)
+            this->textures[i][t] = _unknownState;
+
+    this->depthTest = _unknownState;
+    this->depthFunc = _unknownState;
+    this->depthMask = _unknownState;
+    this->stencilTest = _unknownState;
+    this->blend = _unknownState;
+    this->blendSrcFactor = _unknownState;
+    this->blendDstFactor = _unknownState;
+    this->cullFace = _unknownState;
+    this->cullFaceMode = _unknownState;
+}
+
+L3DRenderer::L3DRenderer() :
+    m_bufferRingIndex(0),
+    m_bufferRing(false),
+    m_skippedCalls(0),
+    m_frameUniformBuffer(0),
+    m_visibility(L3D_NULLPTR),
+    m_frameIndex(0),
+    m_occlusionCulling(false),
+    m_instanceStreamBuffer(0),
+    m_drawDataBuffer(0),
+    m_drawCommandBuffer(0),
+    m_drawIdBuffer(0),
+    m_drawIdCapacity(0),
+    m_jobs(L3DJobSystem::defaultWorkerCount()),
+    m_recordedMeshCount(0),
+    m_gpuTimers(false),
+    m_gpuTimerFrame(0),
+    m_stats(&m_frameStats)
 {
+    for (unsigned int i = 0; i < L3D_BUFFER_RING_SIZE; ++i)
+        m_bufferRingFences[i] = 0;
+
+    for (unsigned int l = 0; l <= L3D_MAX_RENDERLAYERS; ++l)
+        m_layerPackets[l] = 0;
 }
 
 L3DRenderer::~L3DRenderer()
@@ -434,58 +654,127 @@ L3DRenderer::~L3DRenderer()
     this->terminate();
 }
 
-int L3DRenderer::init()
+int L3DRenderer::init(const L3DBackend& backend)
 {
-    // Load OpenGL extensions.
-    if (!gladLoadGL()) {
+    // Load OpenGL extensions, or entry points of a fake backend.
+    if (!L3DGLBackend::install(backend)) {
         fprintf(stderr, "Failed to initialize OpenGL\n");
         return -1;
     }
 
+    // Creates buffer of per-frame uniforms, shared by all programs.
+    glGenBuffers(1, &m_frameUniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(L3DFrameUniforms), 0, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Creates buffer of instance matrices, refilled by each drawn layer.
+    glGenBuffers(1, &m_instanceStreamBuffer);
+
+    // Creates buffers of per-draw data and commands for indirect draws.
+    if (GLAD_GL_VERSION_4_3)
+    {
+        glGenBuffers(1, &m_drawDataBuffer);
+        glGenBuffers(1, &m_drawCommandBuffer);
+        glGenBuffers(1, &m_drawIdBuffer);
+    }
+
     return L3D_TRUE;
 }
 
 int L3DRenderer::terminate()
 {
-    for (L3DBufferPool::reverse_iterator it = m_buffers.rbegin(); it != m_buffers.rend(); ++it)
-        delete it->second;
-    m_buffers.clear();
+    // Deleted resources remove themselves from their pools.
+    while (!m_buffers.empty())
+        delete m_buffers.back();
 
-    for (L3DTexturePool::reverse_iterator it = m_textures.rbegin(); it != m_textures.rend(); ++it)
-        delete it->second;
-    m_textures.clear();
+    while (!m_textures.empty())
+        delete m_textures.back();
 
-    for (L3DShaderPool::reverse_iterator it = m_shaders.rbegin(); it != m_shaders.rend(); ++it)
-        delete it->second;
-    m_shaders.clear();
+    while (!m_shaders.empty())
+        delete m_shaders.back();
 
-    for (L3DShaderProgramPool::reverse_iterator it = m_shaderPrograms.rbegin(); it != m_shaderPrograms.rend(); ++it)
-        delete it->second;
-    m_shaderPrograms.clear();
+    while (!m_shaderPrograms.empty())
+        delete m_shaderPrograms.back();
 
-    for (L3DFrameBufferPool::reverse_iterator it = m_frameBuffers.rbegin(); it != m_frameBuffers.rend(); ++it)
-        delete it->second;
-    m_frameBuffers.clear();
+    while (!m_frameBuffers.empty())
+        delete m_frameBuffers.back();
 
-    for (L3DMaterialPool::reverse_iterator it = m_materials.rbegin(); it != m_materials.rend(); ++it)
-        delete it->second;
-    m_materials.clear();
+    while (!m_materials.empty())
+        delete m_materials.back();
 
-    for (L3DCameraPool::reverse_iterator it = m_cameras.rbegin(); it != m_cameras.rend(); ++it)
-        delete it->second;
-    m_cameras.clear();
+    while (!m_cameras.empty())
+        delete m_cameras.back();
 
-    for (L3DLightPool::reverse_iterator it = m_lights.rbegin(); it != m_lights.rend(); ++it)
-        delete it->second;
-    m_lights.clear();
+    while (!m_lights.empty())
+        delete m_lights.back();
 
-    for (L3DMeshPool::reverse_iterator it = m_meshes.rbegin(); it != m_meshes.rend(); ++it)
-        delete it->second;
-    m_meshes.clear();
+    while (!m_meshes.empty())
+        delete m_meshes.back();
+
+    while (!m_renderQueues.empty())
+        delete m_renderQueues.back();
+
+    for (unsigned int i = 0; i < L3D_MAX_RENDERLAYERS; ++i)
+        m_renderBuckets[i].meshes.clear();
+
+    m_commandBuckets.clear();
+    m_drawPackets.clear();
+
+    m_bvh.clear();
+    m_dirtyMeshes.clear();
+    m_transformGraph.clear();
+    m_nodeMeshes.clear();
+
+    if (m_frameUniformBuffer)
+    {
+        glDeleteBuffers(1, &m_frameUniformBuffer);
+        m_frameUniformBuffer = 0;
+    }
+
+    if (m_instanceStreamBuffer)
+    {
+        glDeleteBuffers(1, &m_instanceStreamBuffer);
+        m_instanceStreamBuffer = 0;
+    }
+
+    for (L3DVertexArrayPool::iterator it = m_indirectVertexArrays.begin(); it != m_indirectVertexArrays.end(); ++it)
+        glDeleteVertexArrays(1, &it->second);
+    m_indirectVertexArrays.clear();
 
-    for (L3DRenderQueuePool::reverse_iterator it = m_renderQueues.rbegin(); it != m_renderQueues.rend(); ++it)
+    // Buffers are already gone, arenas can be released.
+    for (L3DBufferArenaPool::iterator it = m_bufferArenas.begin(); it != m_bufferArenas.end(); ++it)
+    {
+        glDeleteBuffers(1, &it->second->buffer);
         delete it->second;
-    m_renderQueues.clear();
+    }
+    m_bufferArenas.clear();
+    m_dirtyBuffers.clear();
+    m_bufferRing = false;
+
+    for (unsigned int i = 0; i < L3D_BUFFER_RING_SIZE; ++i)
+    {
+        if (m_bufferRingFences[i])
+        {
+            glDeleteSync(m_bufferRingFences[i]);
+            m_bufferRingFences[i] = 0;
+        }
+    }
+
+    this->setGpuTiming(false);
+
+    if (m_drawDataBuffer)
+    {
+        glDeleteBuffers(1, &m_drawDataBuffer);
+        glDeleteBuffers(1, &m_drawCommandBuffer);
+        glDeleteBuffers(1, &m_drawIdBuffer);
+        m_drawDataBuffer = 0;
+        m_drawCommandBuffer = 0;
+        m_drawIdBuffer = 0;
+        m_drawIdCapacity = 0;
+    }
+
+    L3DGLBackend::uninstall();
 
     return L3D_TRUE;
 }
@@ -495,73 +784,281 @@ void L3DRenderer::renderFrame(L3DCamera* camera, L3DRenderQueue* renderQueue)
     if (!camera || !renderQueue)
         return;
 
+    // Data of previous frame is not needed anymore.
+    m_frameArena.reset();
+
+#ifndef L3D_NO_FRAME_STATS
+    m_frameStats = L3DFrameStats();
+    for (unsigned int l = 0; l < L3D_MAX_RENDERLAYERS; ++l)
+        m_layerStats[l] = L3DFrameStats();
+    m_stats = &m_frameStats;
+#endif
+
+    // State may have been changed outside the renderer between frames.
+    m_renderState.invalidate();
+    m_renderState.skippedCalls = 0;
+
+    // Camera doesn't change during frame, uploads its uniforms once.
+    this->updateFrameUniforms(camera);
+
+    // Uploads changed buffers before anything reads them.
+    this->uploadBuffers();
+
+    // Culls meshes once for all render layers.
+    ++m_frameIndex;
+    this->updateMeshBounds();
+    m_frustum.update(camera->proj * camera->view);
+    this->cullMeshes();
+
+    if (m_occlusionCulling)
+        this->occludeMeshes(camera->proj * camera->view);
+
+    // Commands are validated and resolved once, then executed as they are.
+    if (!renderQueue->isCompiled())
+        this->compileRenderQueue(renderQueue);
+
+    // Records draws of all layers of queue, possibly in parallel.
+    this->recordDrawPackets(renderQueue);
+
+    // Queries of this frame reuse the ones of oldest frame in ring.
+    if (m_gpuTimers)
+        this->readGpuTimings();
+
+    const L3DRenderCommandList& commands = renderQueue->compiledCommands();
+
+    for (L3DRenderCommandList::const_iterator it = commands.begin(); it != commands.end(); ++it)
+    {
+        bool timed = m_gpuTimers && this->beginGpuTiming(*it);
+
+        switch (it->type)
+        {
+        case L3D_SWITCH_FRAME_BUFFER:
+            this->switchFrameBuffer(it->switchFrameBuffer.frameBufferId);
+            break;
+        case L3D_CLEAR_BUFFERS:
+            this->clearBuffers(it->clearBuffers.clearMask, it->clearBuffers.clearColor);
+            break;
+        case L3D_SET_DEPTH_TEST:
+            this->setDepthTest(it->setDepthTest.enable, it->setDepthTest.factor);
+            break;
+        case L3D_SET_DEPTH_MASK:
+            this->setDepthMask(it->setDepthMask.enable);
+            break;
+        case L3D_SET_STENCIL_TEST:
+            this->setStencilTest(it->setStencilTest.enable);
+            break;
+        case L3D_SET_BLEND:
+            this->setBlend(it->setBlend.enable, it->setBlend.srcFactor, it->setBlend.dstFactor);
+            break;
+        case L3D_SET_CULL_FACE:
+            this->setCullFace(it->setCullFace.enable, it->setCullFace.cullFace);
+            break;
+        case L3D_DRAW_MESHES:
+            this->drawMeshes(camera, it->drawMeshes.renderLayer);
+            break;
+        default:
+            break;
+        }
+
+        if (timed)
+            this->endGpuTiming();
+    }
+
+    if (m_gpuTimers)
+        m_gpuTimerFrame = (m_gpuTimerFrame + 1) % L3D_GPU_TIMER_FRAMES;
+
+    // Leaves no mesh bound, so that later buffer changes can't alter it.
+    this->bindVertexArray(0);
+
+    // Marks end of reads from current region of ring arenas.
+    if (m_bufferRing && !m_bufferRingFences[m_bufferRingIndex])
+        m_bufferRingFences[m_bufferRingIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_skippedCalls = m_renderState.skippedCalls;
+
+#ifndef L3D_NO_FRAME_STATS
+    for (unsigned int l = 0; l < L3D_MAX_RENDERLAYERS; ++l)
+        m_frameStats += m_layerStats[l];
+#endif
+}
+
+void L3DRenderer::compileRenderQueue(L3DRenderQueue* renderQueue)
+{
     const L3DRenderCommandList& commands = renderQueue->commands();
+    L3DRenderCommandList& compiledCommands = renderQueue->m_compiledCommands;
+
+    compiledCommands.clear();
+    compiledCommands.reserve(commands.size());
 
+    // Invalid commands are dropped, so that execution needs no checks.
     for (L3DRenderCommandList::const_iterator it = commands.begin(); it != commands.end(); ++it)
     {
-        const L3DRenderCommand* command = *it;
+        L3DRenderCommand command = *it;
+        bool valid = true;
 
-        switch (command->type())
+        switch (command.type)
         {
         case L3D_SWITCH_FRAME_BUFFER:
         {
-            const L3DSwitchFrameBufferCommand* cmd = static_cast<const L3DSwitchFrameBufferCommand*>(command);
-            if (cmd)
-                this->switchFrameBuffer(cmd->frameBuffer);
+            L3DHandle handle = command.switchFrameBuffer.frameBuffer;
+            command.switchFrameBuffer.frameBufferId = 0;
+
+            if (handle.repr)
+            {
+                L3DFrameBuffer* frameBuffer = this->getFrameBuffer(handle);
+                valid = frameBuffer != L3D_NULLPTR;
+
+                if (valid)
+                    command.switchFrameBuffer.frameBufferId = frameBuffer->glId();
+            }
         }
         break;
 
         case L3D_CLEAR_BUFFERS:
         {
-            const L3DClearBuffersCommand* cmd = static_cast<const L3DClearBuffersCommand*>(command);
-            if (cmd)
-                this->clearBuffers(cmd->colorBuffer, cmd->depthBuffer, cmd->stencilBuffer, cmd->clearColor);
+            L3DClearBuffersCommand& cmd = command.clearBuffers;
+            cmd.clearMask = 0;
+            if (cmd.colorBuffer) cmd.clearMask |= GL_COLOR_BUFFER_BIT;
+            if (cmd.depthBuffer) cmd.clearMask |= GL_DEPTH_BUFFER_BIT;
+            if (cmd.stencilBuffer) cmd.clearMask |= GL_STENCIL_BUFFER_BIT;
+            valid = cmd.clearMask != 0;
         }
         break;
 
         case L3D_SET_DEPTH_TEST:
-        {
-            const L3DSetDepthTestCommand* cmd = static_cast<const L3DSetDepthTestCommand*>(command);
-            if (cmd)
-                this->setDepthTest(cmd->enable, cmd->factor);
-        }
-        break;
+            valid = !command.setDepthTest.enable || _toOpenGL(command.setDepthTest.factor);
+            break;
 
         case L3D_SET_DEPTH_MASK:
-        {
-            const L3DSetDepthMaskCommand* cmd = static_cast<const L3DSetDepthMaskCommand*>(command);
-            if (cmd)
-                this->setDepthMask(cmd->enable);
+        case L3D_SET_STENCIL_TEST:
+        case L3D_DRAW_MESHES:
+            break;
+
+        case L3D_SET_BLEND:
+            valid = !command.setBlend.enable || (_toOpenGL(command.setBlend.srcFactor) && _toOpenGL(command.setBlend.dstFactor));
+            break;
+
+        case L3D_SET_CULL_FACE:
+            valid = !command.setCullFace.enable || _toOpenGL(command.setCullFace.cullFace);
+            break;
+
+        default:
+            valid = false;
+            break;
         }
-        break;
 
-        case L3D_SET_STENCIL_TEST:
+        if (valid)
+            compiledCommands.push_back(command);
+        else
+            fprintf(stderr, "Render queue %s: dropping invalid command %d!\n", renderQueue->name(), (int)(it - commands.begin()));
+    }
+
+    renderQueue->m_compiled = true;
+}
+
+void L3DRenderer::recordDrawPackets(L3DRenderQueue* renderQueue)
+{
+    const L3DRenderCommandList& commands = renderQueue->compiledCommands();
+    bool recordLayer[L3D_MAX_RENDERLAYERS] = { false };
+    unsigned int meshCount = 0;
+
+    // Only layers drawn by queue are recorded.
+    for (L3DRenderCommandList::const_iterator it = commands.begin(); it != commands.end(); ++it)
+    {
+        if (it->type == L3D_DRAW_MESHES)
+            recordLayer[it->drawMeshes.renderLayer] = true;
+    }
+
+    m_recordedLayers.clear();
+    for (unsigned int l = 0; l < L3D_MAX_RENDERLAYERS; ++l)
+    {
+        if (recordLayer[l] && !m_renderBuckets[l].meshes.empty())
         {
-            const L3DSetStencilTestCommand* cmd = static_cast<const L3DSetStencilTestCommand*>(command);
-            if (cmd)
-                this->setStencilTest(cmd->enable);
+            m_recordedLayers.push_back(l);
+            meshCount += m_renderBuckets[l].meshes.size();
         }
-        break;
+    }
 
-        case L3D_SET_BLEND:
+    // Each job records a contiguous range of meshes into its own bucket.
+    // Small scenes are recorded by a single job, as more would cost more.
+    unsigned int bucketCount = meshCount / _minRecordedMeshesPerJob;
+    if (bucketCount > m_jobs.workerCount() + 1) bucketCount = m_jobs.workerCount() + 1;
+    if (bucketCount < 1) bucketCount = 1;
+
+    m_commandBuckets.resize(bucketCount);
+    m_recordedMeshCount = meshCount;
+
+    m_jobs.parallelFor(bucketCount, 1, &L3DRenderer::recordMeshesJob, this);
+
+    // Merges buckets in key order, layers are its highest byte.
+    L3DCommandBucket::merge(&m_commandBuckets[0], bucketCount, m_drawPackets, m_drawPacketScratch);
+
+    unsigned int packetCount = m_drawPackets.size();
+    unsigned int p = 0;
+
+    for (unsigned int l = 0; l <= L3D_MAX_RENDERLAYERS; ++l)
+    {
+        while (p < packetCount && (m_drawPackets[p].key >> 56) < l)
+            ++p;
+        m_layerPackets[l] = p;
+    }
+
+#ifndef L3D_NO_FRAME_STATS
+    for (std::vector<unsigned int>::const_iterator it = m_recordedLayers.begin(); it != m_recordedLayers.end(); ++it)
+        m_layerStats[*it].culledMeshes = m_renderBuckets[*it].meshes.size() - (m_layerPackets[*it + 1] - m_layerPackets[*it]);
+#endif
+}
+
+void L3DRenderer::recordMeshesJob(void* data, unsigned int first, unsigned int last)
+{
+    L3DRenderer* renderer = static_cast<L3DRenderer*>(data);
+    unsigned long long meshCount = renderer->m_recordedMeshCount;
+    unsigned int bucketCount = renderer->m_commandBuckets.size();
+
+    for (unsigned int b = first; b < last; ++b)
+    {
+        unsigned int firstMesh = meshCount * b / bucketCount;
+        unsigned int lastMesh = meshCount * (b + 1) / bucketCount;
+        renderer->recordMeshes(&renderer->m_commandBuckets[b], firstMesh, lastMesh - firstMesh);
+    }
+}
+
+void L3DRenderer::recordMeshes(
+    L3DCommandBucket* bucket,
+    unsigned int first,
+    unsigned int count
+)
+{
+    bucket->clear();
+
+    // Skips whole layers before first mesh of range.
+    for (std::vector<unsigned int>::const_iterator it = m_recordedLayers.begin(); it != m_recordedLayers.end() && count; ++it)
+    {
+        const std::vector<L3DMesh*>& meshes = m_renderBuckets[*it].meshes;
+
+        if (first >= meshes.size())
         {
-            const L3DSetBlendCommand* cmd = static_cast<const L3DSetBlendCommand*>(command);
-            if (cmd)
-                this->setBlend(cmd->enable, cmd->srcFactor, cmd->dstFactor);
+            first -= meshes.size();
+            continue;
         }
-        break;
 
-        case L3D_DRAW_MESHES:
+        unsigned int last = glm::min(first + count, (unsigned int)meshes.size());
+        count -= last - first;
+
+        for (unsigned int i = first; i < last; ++i)
         {
-            const L3DDrawMeshesCommand* cmd = static_cast<const L3DDrawMeshesCommand*>(command);
-            if (cmd)
-                this->drawMeshes(camera, cmd->renderLayer);
-        }
-        break;
+            L3DMesh* mesh = meshes[i];
 
-        default:
-        break;
+            // Skips meshes out of camera frustum and empty instances.
+            if (mesh->hasFlag(L3D_MESH_CULLING) && mesh->m_visibleFrame != m_frameIndex)
+                continue;
+            if (mesh->instanceBuffer() && mesh->instanceCount() == 0)
+                continue;
+
+            bucket->addPacket(_drawPacketKey(mesh), mesh);
         }
+
+        first = 0;
     }
 }
 
@@ -609,30 +1106,40 @@ void L3DRenderer::addResource(L3DResource* resource)
 
 void L3DRenderer::addBuffer(L3DBuffer* buffer)
 {
-    if (buffer && m_buffers.find(buffer->id()) == m_buffers.end())
+    if (buffer && !buffer->id())
     {
-        GLuint id = 0;
-        glGenBuffers(1, &id);
+        // Buffers are ranges of arenas, they have no OpenGL name.
+        unsigned int count = buffer->count();
 
-        if (buffer->count())
-        {
-            GLenum gl_type = _toOpenGL(buffer->type());
-            GLenum gl_draw_type = _toOpenGL(buffer->drawType());
+        if (!this->addToPool(m_buffers, buffer))
+            return;
 
-            glBindBuffer(gl_type, id);
-            glBufferData(gl_type, buffer->size(), buffer->data(), gl_draw_type);
-            glBindBuffer(gl_type, 0);
-        }
+        if (count)
+        {
+            this->allocateBuffer(buffer);
 
-        buffer->setId((unsigned short int)id);
+            L3DBufferArena* arena = buffer->m_arena;
 
-        m_buffers[id] = buffer;
+            // Mapped regions may still be in use, so they are written
+            // before next frames. Copy target is used, so that bound VAO
+            // is not affected.
+            if (arena->mappedData)
+            {
+                this->invalidateBuffer(buffer, 0, buffer->size());
+            }
+            else if (buffer->data())
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, arena->buffer);
+                glBufferSubData(GL_COPY_WRITE_BUFFER, buffer->offset() * arena->stride, count * arena->stride, buffer->data());
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            }
+        }
     }
 }
 
 void L3DRenderer::addTexture(L3DTexture* texture)
 {
-    if (texture && m_textures.find(texture->id()) == m_textures.end())
+    if (texture && !texture->id())
     {
         GLuint id = 0;
         glGenTextures(1, &id);
@@ -712,15 +1219,14 @@ void L3DRenderer::addTexture(L3DTexture* texture)
 
         glBindTexture(gl_type, 0);
 
-        texture->setId((unsigned short int)id);
-
-        m_textures[id] = texture;
+        texture->setGlId(id);
+        this->addToPool(m_textures, texture);
     }
 }
 
 void L3DRenderer::addShader(L3DShader* shader)
 {
-    if (shader && m_shaders.find(shader->id()) == m_shaders.end())
+    if (shader && !shader->id())
     {
         GLuint gl_type = _toOpenGL(shader->type());
 
@@ -739,26 +1245,25 @@ void L3DRenderer::addShader(L3DShader* shader)
             fprintf(stderr, "%s", infoLog);
         }
 
-        shader->setId((unsigned short int)id);
-
-        m_shaders[id] = shader;
+        shader->setGlId(id);
+        this->addToPool(m_shaders, shader);
     }
 }
 
 void L3DRenderer::addShaderProgram(L3DShaderProgram* shaderProgram)
 {
-    if (shaderProgram && m_shaderPrograms.find(shaderProgram->id()) == m_shaderPrograms.end())
+    if (shaderProgram && !shaderProgram->id())
     {
         GLuint id = glCreateProgram();
 
         if (shaderProgram->vertexShader())
-            glAttachShader(id, shaderProgram->vertexShader()->id());
+            glAttachShader(id, shaderProgram->vertexShader()->glId());
 
         if (shaderProgram->fragmentShader())
-            glAttachShader(id, shaderProgram->fragmentShader()->id());
+            glAttachShader(id, shaderProgram->fragmentShader()->glId());
 
         if (shaderProgram->geometryShader())
-            glAttachShader(id, shaderProgram->geometryShader()->id());
+            glAttachShader(id, shaderProgram->geometryShader()->glId());
 
         glLinkProgram(id);
 
@@ -771,32 +1276,127 @@ void L3DRenderer::addShaderProgram(L3DShaderProgram* shaderProgram)
             fprintf(stderr, "%s", infoLog);
         }
 
-        shaderProgram->setId((unsigned short int)id);
+        shaderProgram->setGlId(id);
+
+        // Reflects active uniforms once, so that they can be set by id.
+        this->reflectUniforms(shaderProgram);
+
+        // Programs reading model matrix from instance attribute can draw
+        // meshes sharing geometry at once.
+        L3DAttributeMap attributes = shaderProgram->attributes();
+        shaderProgram->setInstanceMatrixLocation(glGetAttribLocation(id, attributes[L3D_INSTANCE_MATRIX].c_str()));
+
+        // Binds per-frame uniform block, if used.
+        GLuint blockIndex = glGetUniformBlockIndex(id, _frameUniformBlockName);
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(id, blockIndex, _frameUniformBinding);
 
-        m_shaderPrograms[id] = shaderProgram;
+        // Binds per-draw storage block, if used. Such programs are drawn
+        // with multi-draw indirect calls.
+        if (GLAD_GL_VERSION_4_3)
+        {
+            GLuint drawBlockIndex = glGetProgramResourceIndex(id, GL_SHADER_STORAGE_BLOCK, _drawDataBlockName);
+            if (drawBlockIndex != GL_INVALID_INDEX)
+            {
+                glShaderStorageBlockBinding(id, drawBlockIndex, _drawDataBinding);
+                shaderProgram->setDrawsIndirect(true);
+            }
+        }
+
+        this->addToPool(m_shaderPrograms, shaderProgram);
     }
 }
 
-void L3DRenderer::addFrameBuffer(L3DFrameBuffer* frameBuffer)
+void L3DRenderer::reflectUniforms(L3DShaderProgram* shaderProgram)
 {
-    if (frameBuffer && m_frameBuffers.find(frameBuffer->id()) == m_frameBuffers.end())
-    {
-        GLuint id = 0;
-        glGenFramebuffers(1, &id);
-        glBindFramebuffer(GL_FRAMEBUFFER, id);
+    GLuint id = shaderProgram->glId();
+    GLint uniformCount = 0;
+    GLint maxLength = 0;
 
-        // Register texture attachments.
-        L3DTextureAttachments textures = frameBuffer->textureAttachments();
-        for (L3DTextureAttachments::iterator tex_it = textures.begin(); tex_it != textures.end(); ++tex_it)
-        {
-            GLenum gl_attachment_type = _toOpenGL(tex_it->first);
-            L3DTexture* texture = tex_it->second;
+    shaderProgram->clearUniformLocations();
+
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    if (uniformCount <= 0 || maxLength <= 0)
+        return;
+
+    std::vector<GLchar> nameBuffer(maxLength + 1);
+
+    for (GLint i = 0; i < uniformCount; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id, (GLuint)i, maxLength, &length, &size, &type, &nameBuffer[0]);
+
+        std::string name(&nameBuffer[0], length);
+        GLint location = glGetUniformLocation(id, name.c_str());
+
+        // Skips uniforms in blocks.
+        if (location < 0)
+            continue;
+
+        shaderProgram->setUniformLocation(L3DShaderProgram::uniformId(name), location);
+
+        // Arrays are reported by their first element, registers all of them.
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+        {
+            std::string baseName = name.substr(0, name.size() - 3);
+            shaderProgram->setUniformLocation(L3DShaderProgram::uniformId(baseName), location);
+
+            for (GLint k = 1; k < size; ++k)
+            {
+                std::ostringstream sstream;
+                sstream << baseName << "[" << k << "]";
+                shaderProgram->setUniformLocation(
+                    L3DShaderProgram::uniformId(sstream.str()),
+                    glGetUniformLocation(id, sstream.str().c_str())
+                );
+            }
+        }
+    }
+}
+
+void L3DRenderer::updateFrameUniforms(L3DCamera* camera)
+{
+    if (!m_frameUniformBuffer)
+        return;
+
+    L3DFrameUniforms frameUniforms;
+    frameUniforms.viewMat = camera->view;
+    frameUniforms.projMat = camera->proj;
+    frameUniforms.vpMat = camera->proj * camera->view;
+    frameUniforms.cameraPos = L3DVec4(camera->position(), 1.0f);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUniformBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(L3DFrameUniforms), &frameUniforms);
+    L3D_COUNT(uploadedBytes, sizeof(L3DFrameUniforms));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, _frameUniformBinding, m_frameUniformBuffer);
+}
+
+void L3DRenderer::addFrameBuffer(L3DFrameBuffer* frameBuffer)
+{
+    if (frameBuffer && !frameBuffer->id())
+    {
+        GLuint id = 0;
+        glGenFramebuffers(1, &id);
+        glBindFramebuffer(GL_FRAMEBUFFER, id);
+
+        // Register texture attachments.
+        L3DTextureAttachments textures = frameBuffer->textureAttachments();
+        for (L3DTextureAttachments::iterator tex_it = textures.begin(); tex_it != textures.end(); ++tex_it)
+        {
+            GLenum gl_attachment_type = _toOpenGL(tex_it->first);
+            L3DTexture* texture = tex_it->second;
 
             if (texture)
             {
                 this->addTexture(texture);
 
-                GLuint id = texture->id();
+                GLuint id = texture->glId();
                 GLenum gl_type = _toOpenGL(texture->type());
 
                 switch (texture->type())
@@ -828,57 +1428,32 @@ void L3DRenderer::addFrameBuffer(L3DFrameBuffer* frameBuffer)
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        frameBuffer->setId((unsigned short int)id);
-
-        m_frameBuffers[id] = frameBuffer;
+        frameBuffer->setGlId(id);
+        this->addToPool(m_frameBuffers, frameBuffer);
     }
 }
 
 void L3DRenderer::addMaterial(L3DMaterial* material)
 {
-    if (material && m_materials.find(material->id()) == m_materials.end())
-    {
-        GLuint id = 1;
-        if (m_materials.size() > 0)
-            id = m_materials.rbegin()->second->id() + 1;
-
-        material->setId((unsigned short int)id);
-
-        m_materials[id] = material;
-    }
+    if (material && !material->id())
+        this->addToPool(m_materials, material);
 }
 
 void L3DRenderer::addCamera(L3DCamera* camera)
 {
-    if (camera && m_cameras.find(camera->id()) == m_cameras.end())
-    {
-        GLuint id = 1;
-        if (m_cameras.size() > 0)
-            id = m_cameras.rbegin()->second->id() + 1;
-
-        camera->setId((unsigned short int)id);
-
-        m_cameras[id] = camera;
-    }
+    if (camera && !camera->id())
+        this->addToPool(m_cameras, camera);
 }
 
 void L3DRenderer::addLight(L3DLight* light)
 {
-    if (light && m_lights.find(light->id()) == m_lights.end())
-    {
-        GLuint id = 1;
-        if (m_lights.size() > 0)
-            id = m_lights.rbegin()->second->id() + 1;
-
-        light->setId((unsigned short int)id);
-
-        m_lights[id] = light;
-    }
+    if (light && !light->id())
+        this->addToPool(m_lights, light);
 }
 
 void L3DRenderer::addMesh(L3DMesh* mesh)
 {
-    if (mesh && m_meshes.find(mesh->id()) == m_meshes.end())
+    if (mesh && !mesh->id())
     {
         GLuint id;
         glGenVertexArrays(1, &id);
@@ -888,8 +1463,8 @@ void L3DRenderer::addMesh(L3DMesh* mesh)
         {
             this->addBuffer(mesh->vertexBuffer());
 
-            // Binds vertex buffer.
-            glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer()->id());
+            // Binds vertex arena, meshes are drawn from their base vertex.
+            glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer()->arena()->buffer);
 
             if (mesh->material() && mesh->material()->shaderProgram())
             {
@@ -898,87 +1473,12 @@ void L3DRenderer::addMesh(L3DMesh* mesh)
                 L3DAttributeMap shaderAttributes = shaderProgram->attributes();
 
                 // Enables vertex attributes.
-                GLint posAttrib     = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_VERTEX_POSITION].c_str());
-                GLint norAttrib     = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_VERTEX_NORMAL].c_str());
-                GLint tanAttrib     = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_VERTEX_TANGENT].c_str());
-                GLint tex0Attrib    = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_VERTEX_UV0].c_str());
-                GLint tex1Attrib    = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_VERTEX_UV1].c_str());
-                GLint tex2Attrib    = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_VERTEX_UV2].c_str());
-                GLint tex3Attrib    = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_VERTEX_UV3].c_str());
-
-                switch(mesh->vertexFormat())
+                GLint locations[L3D_MAX_VERTEX_ATTRIBUTE];
+                for (unsigned int a = 0; a < L3D_MAX_VERTEX_ATTRIBUTE; ++a)
+                    locations[a] = glGetAttribLocation(shaderProgram->glId(), shaderAttributes[a].c_str());
+
+                if (!_enableVertexAttributes(mesh->vertexFormat(), locations))
                 {
-                case L3D_VERTEX_POS2:
-                    _enableVertexAttribute(posAttrib, 2, GL_FLOAT, 2*sizeof(GLfloat), 0);
-                    break;
-                case L3D_VERTEX_POS3:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 3*sizeof(GLfloat), 0);
-                    break;
-                case L3D_VERTEX_POS2_UV2:
-                    _enableVertexAttribute(posAttrib, 2, GL_FLOAT, 4*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(tex0Attrib, 2, GL_FLOAT, 4*sizeof(GLfloat), (void*)(2*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_UV2:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 5*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(tex0Attrib, 2, GL_FLOAT, 5*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_UV3:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 6*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(tex0Attrib, 3, GL_FLOAT, 6*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_NOR3_UV2:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 8*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(norAttrib, 3, GL_FLOAT, 8*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex0Attrib, 2, GL_FLOAT, 8*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_NOR3_UV3:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 9*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(norAttrib, 3, GL_FLOAT, 9*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex0Attrib, 3, GL_FLOAT, 9*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_NOR3_UV2_UV2:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 10*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(norAttrib, 3, GL_FLOAT, 10*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex0Attrib, 2, GL_FLOAT, 10*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex1Attrib, 2, GL_FLOAT, 10*sizeof(GLfloat), (void*)(8*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_NOR3_TAN3_UV2:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 11*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(norAttrib, 3, GL_FLOAT, 11*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    _enableVertexAttribute(tanAttrib, 3, GL_FLOAT, 11*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex0Attrib, 2, GL_FLOAT, 11*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_NOR3_TAN3_UV3:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 12*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(norAttrib, 3, GL_FLOAT, 12*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    _enableVertexAttribute(tanAttrib, 3, GL_FLOAT, 12*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex0Attrib, 3, GL_FLOAT, 12*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_NOR3_TAN3_UV2_UV2:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 13*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(norAttrib, 3, GL_FLOAT, 13*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    _enableVertexAttribute(tanAttrib, 3, GL_FLOAT, 13*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex0Attrib, 2, GL_FLOAT, 13*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex1Attrib, 2, GL_FLOAT, 13*sizeof(GLfloat), (void*)(11*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_NOR3_TAN3_UV2_UV2_UV2:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 15*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(norAttrib, 3, GL_FLOAT, 15*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    _enableVertexAttribute(tanAttrib, 3, GL_FLOAT, 15*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex0Attrib, 2, GL_FLOAT, 15*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex1Attrib, 2, GL_FLOAT, 15*sizeof(GLfloat), (void*)(11*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex2Attrib, 2, GL_FLOAT, 15*sizeof(GLfloat), (void*)(13*sizeof(GLfloat)));
-                    break;
-                case L3D_VERTEX_POS3_NOR3_TAN3_UV2_UV2_UV2_UV2:
-                    _enableVertexAttribute(posAttrib, 3, GL_FLOAT, 17*sizeof(GLfloat), 0);
-                    _enableVertexAttribute(norAttrib, 3, GL_FLOAT, 17*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
-                    _enableVertexAttribute(tanAttrib, 3, GL_FLOAT, 17*sizeof(GLfloat), (void*)(6*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex0Attrib, 2, GL_FLOAT, 17*sizeof(GLfloat), (void*)(9*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex1Attrib, 2, GL_FLOAT, 17*sizeof(GLfloat), (void*)(11*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex2Attrib, 2, GL_FLOAT, 17*sizeof(GLfloat), (void*)(13*sizeof(GLfloat)));
-                    _enableVertexAttribute(tex3Attrib, 2, GL_FLOAT, 17*sizeof(GLfloat), (void*)(15*sizeof(GLfloat)));
-                    break;
-                default:
                     glDeleteVertexArrays(1, &id);
                     glBindVertexArray(0);
                     return;
@@ -990,82 +1490,35 @@ void L3DRenderer::addMesh(L3DMesh* mesh)
         {
             this->addBuffer(mesh->indexBuffer());
 
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer()->id());
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer()->arena()->buffer);
         }
 
         if (mesh->instanceBuffer() && mesh->instanceFormat())
         {
             this->addBuffer(mesh->instanceBuffer());
-
-            // Binds instance buffer.
-            glBindBuffer(GL_ARRAY_BUFFER, mesh->instanceBuffer()->id());
-
-            if (mesh->material() && mesh->material()->shaderProgram())
-            {
-                L3DMaterial* material = mesh->material();
-                L3DShaderProgram* shaderProgram = material->shaderProgram();
-                L3DAttributeMap shaderAttributes = shaderProgram->attributes();
-
-                // Enables instanced attributes.
-                GLint iposAttrib   = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_INSTANCE_POSITION].c_str());
-                GLint itexAttrib   = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_INSTANCE_UV].c_str());
-                GLint itransAttrib = glGetAttribLocation(shaderProgram->id(), shaderAttributes[L3D_INSTANCE_MATRIX].c_str());
-
-                switch(mesh->instanceFormat())
-                {
-                case L3D_INSTANCE_POS2:
-                    _enableVertexAttribute(iposAttrib, 2, GL_FLOAT, 2*sizeof(GLfloat), (void*)0, GL_FALSE, 1);
-                    break;
-                case L3D_INSTANCE_POS3:
-                    _enableVertexAttribute(iposAttrib, 3, GL_FLOAT, 3*sizeof(GLfloat), (void*)0, GL_FALSE, 1);
-                    break;
-                case L3D_INSTANCE_POS2_UV2:
-                    _enableVertexAttribute(iposAttrib, 2, GL_FLOAT, 4*sizeof(GLfloat), (void*)0, GL_FALSE, 1);
-                    _enableVertexAttribute(itexAttrib, 2, GL_FLOAT, 4*sizeof(GLfloat), (void*)(2*sizeof(GLfloat)), GL_FALSE, 1);
-                    break;
-                case L3D_INSTANCE_POS3_UV2:
-                    _enableVertexAttribute(iposAttrib, 3, GL_FLOAT, 5*sizeof(GLfloat), (void*)0, GL_FALSE, 1);
-                    _enableVertexAttribute(itexAttrib, 2, GL_FLOAT, 5*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)), GL_FALSE, 1);
-                    break;
-                case L3D_INSTANCE_TRANS4_TRANS4_TRANS4_TRANS4:
-                    _enableVertexAttribute(itransAttrib + 0, 4, GL_FLOAT, 16*sizeof(GLfloat), (void*)0, GL_FALSE, 1);
-                    _enableVertexAttribute(itransAttrib + 1, 4, GL_FLOAT, 16*sizeof(GLfloat), (void*)(4*sizeof(GLfloat)), GL_FALSE, 1);
-                    _enableVertexAttribute(itransAttrib + 2, 4, GL_FLOAT, 16*sizeof(GLfloat), (void*)(8*sizeof(GLfloat)), GL_FALSE, 1);
-                    _enableVertexAttribute(itransAttrib + 3, 4, GL_FLOAT, 16*sizeof(GLfloat), (void*)(12*sizeof(GLfloat)), GL_FALSE, 1);
-                    break;
-                case L3D_INSTANCE_TRANS4_TRANS4_TRANS4_TRANS4_UV2:
-                    _enableVertexAttribute(itransAttrib + 0, 4, GL_FLOAT, 18*sizeof(GLfloat), (void*)0, GL_FALSE, 1);
-                    _enableVertexAttribute(itransAttrib + 1, 4, GL_FLOAT, 18*sizeof(GLfloat), (void*)(4*sizeof(GLfloat)), GL_FALSE, 1);
-                    _enableVertexAttribute(itransAttrib + 2, 4, GL_FLOAT, 18*sizeof(GLfloat), (void*)(8*sizeof(GLfloat)), GL_FALSE, 1);
-                    _enableVertexAttribute(itransAttrib + 3, 4, GL_FLOAT, 18*sizeof(GLfloat), (void*)(12*sizeof(GLfloat)), GL_FALSE, 1);
-                    _enableVertexAttribute(itexAttrib, 2, GL_FLOAT, 18*sizeof(GLfloat), (void*)(16*sizeof(GLfloat)), GL_FALSE, 1);
-                    break;
-                default:
-                    break;
-                }
-            }
+            this->bindInstanceBuffer(mesh);
         }
 
         glBindVertexArray(0);
 
-        mesh->setId((unsigned short int)id);
+        // VAO is deleted along with mesh.
+        mesh->setGlId(id);
+        if (!this->addToPool(m_meshes, mesh))
+            return;
+
+        this->updateRenderBucket(mesh);
 
-        m_meshes[id] = mesh;
+        // Adds mesh to bounding volume hierarchy.
+        mesh->m_worldBounds = mesh->worldBounds();
+        mesh->m_worldRadius = mesh->worldBoundingSphere().radius;
+        mesh->m_bvhProxy = m_bvh.insert(mesh->m_worldBounds, mesh);
     }
 }
 
 void L3DRenderer::addRenderQueue(L3DRenderQueue* renderQueue)
 {
-    if (renderQueue && m_renderQueues.find(renderQueue->id()) == m_renderQueues.end())
-    {
-        GLuint id = 1;
-        if (m_renderQueues.size() > 0)
-            id = m_renderQueues.rbegin()->second->id() + 1;
-
-        renderQueue->setId((unsigned short int)id);
-
-        m_renderQueues[id] = renderQueue;
-    }
+    if (renderQueue && !renderQueue->id())
+        this->addToPool(m_renderQueues, renderQueue);
 }
 
 void L3DRenderer::removeResource(L3DResource* resource)
@@ -1114,9 +1567,20 @@ void L3DRenderer::removeBuffer(L3DBuffer* buffer)
 {
     if (buffer)
     {
-        GLuint id = buffer->id();
-        m_buffers[id] = L3D_NULLPTR;
-        glDeleteBuffers(1, &id);
+        if (buffer->m_dirtyFrames)
+        {
+            m_dirtyBuffers.erase(std::find(m_dirtyBuffers.begin(), m_dirtyBuffers.end(), buffer));
+            buffer->m_dirtyFrames = 0;
+        }
+
+        if (buffer->m_arena)
+        {
+            buffer->m_arena->allocator.release(buffer->m_block);
+            buffer->m_arena = L3D_NULLPTR;
+            buffer->m_block = L3D_INVALID_BLOCK;
+        }
+
+        m_buffers.remove(buffer->id());
         buffer->setId(0);
     }
 }
@@ -1125,10 +1589,11 @@ void L3DRenderer::removeTexture(L3DTexture* texture)
 {
     if (texture)
     {
-        GLuint id = texture->id();
-        m_textures[id] = L3D_NULLPTR;
+        GLuint id = texture->glId();
+        m_textures.remove(texture->id());
         glDeleteTextures(1, &id);
         texture->setId(0);
+        texture->setGlId(0);
     }
 }
 
@@ -1136,10 +1601,11 @@ void L3DRenderer::removeShader(L3DShader* shader)
 {
     if (shader)
     {
-        GLuint id = shader->id();
-        m_shaders[id] = L3D_NULLPTR;
+        GLuint id = shader->glId();
+        m_shaders.remove(shader->id());
         glDeleteShader(id);
         shader->setId(0);
+        shader->setGlId(0);
     }
 }
 
@@ -1147,10 +1613,11 @@ void L3DRenderer::removeShaderProgram(L3DShaderProgram* shaderProgram)
 {
     if (shaderProgram)
     {
-        GLuint id = shaderProgram->id();
-        m_shaderPrograms[id] = L3D_NULLPTR;
+        GLuint id = shaderProgram->glId();
+        m_shaderPrograms.remove(shaderProgram->id());
         glDeleteProgram(id);
         shaderProgram->setId(0);
+        shaderProgram->setGlId(0);
     }
 }
 
@@ -1158,11 +1625,16 @@ void L3DRenderer::removeFrameBuffer(L3DFrameBuffer* frameBuffer)
 {
     if (frameBuffer)
     {
-        GLuint id = frameBuffer->id();
-        m_frameBuffers[id] = L3D_NULLPTR;
+        GLuint id = frameBuffer->glId();
+        m_frameBuffers.remove(frameBuffer->id());
         glDeleteFramebuffers(1, &id);
         // TODO: clean frame buffer attachments.
         frameBuffer->setId(0);
+        frameBuffer->setGlId(0);
+
+        // Queues may refer to it, they are validated again.
+        for (L3DRenderQueuePool::iterator it = m_renderQueues.begin(); it != m_renderQueues.end(); ++it)
+            (*it)->invalidate();
     }
 }
 
@@ -1170,8 +1642,7 @@ void L3DRenderer::removeMaterial(L3DMaterial* material)
 {
     if (material)
     {
-        GLuint id = material->id();
-        m_materials[id] = L3D_NULLPTR;
+        m_materials.remove(material->id());
         // TODO: clean material resources.
         material->setId(0);
     }
@@ -1181,8 +1652,7 @@ void L3DRenderer::removeCamera(L3DCamera* camera)
 {
     if (camera)
     {
-        GLuint id = camera->id();
-        m_cameras[id] = L3D_NULLPTR;
+        m_cameras.remove(camera->id());
         // TODO: clean camera resources.
         camera->setId(0);
     }
@@ -1192,8 +1662,7 @@ void L3DRenderer::removeLight(L3DLight* light)
 {
     if (light)
     {
-        GLuint id = light->id();
-        m_lights[id] = L3D_NULLPTR;
+        m_lights.remove(light->id());
         // TODO: clean light resources.
         light->setId(0);
     }
@@ -1203,10 +1672,27 @@ void L3DRenderer::removeMesh(L3DMesh* mesh)
 {
     if (mesh)
     {
-        GLuint id = mesh->id();
-        m_meshes[id] = L3D_NULLPTR;
+        GLuint id = mesh->glId();
+        this->removeFromRenderBucket(mesh);
+
+        if (mesh->m_bvhProxy != L3D_BVH_NULL_NODE)
+        {
+            m_bvh.remove(mesh->m_bvhProxy);
+            mesh->m_bvhProxy = L3D_BVH_NULL_NODE;
+        }
+
+        if (mesh->m_boundsDirty)
+        {
+            m_dirtyMeshes.erase(std::find(m_dirtyMeshes.begin(), m_dirtyMeshes.end(), mesh));
+            mesh->m_boundsDirty = false;
+        }
+
+        this->attachMeshToNode(mesh, 0);
+
+        m_meshes.remove(mesh->id());
         glDeleteVertexArrays(1, &id);
         mesh->setId(0);
+        mesh->setGlId(0);
     }
 }
 
@@ -1214,8 +1700,7 @@ void L3DRenderer::removeRenderQueue(L3DRenderQueue* renderQueue)
 {
     if (renderQueue)
     {
-        GLuint id = renderQueue->id();
-        m_renderQueues[id] = L3D_NULLPTR;
+        m_renderQueues.remove(renderQueue->id());
         // TODO: clean render queue resources.
         renderQueue->setId(0);
     }
@@ -1226,25 +1711,25 @@ L3DResource* L3DRenderer::getResource(const L3DHandle& handle) const
     switch(handle.data.type)
     {
     case L3D_BUFFER:
-        return m_buffers.find(handle.data.id)->second;
+        return m_buffers.get(handle);
     case L3D_TEXTURE:
-        return m_textures.find(handle.data.id)->second;
+        return m_textures.get(handle);
     case L3D_SHADER:
-        return m_shaders.find(handle.data.id)->second;
+        return m_shaders.get(handle);
     case L3D_SHADER_PROGRAM:
-        return m_shaderPrograms.find(handle.data.id)->second;
+        return m_shaderPrograms.get(handle);
     case L3D_FRAME_BUFFER:
-        return m_frameBuffers.find(handle.data.id)->second;
+        return m_frameBuffers.get(handle);
     case L3D_MATERIAL:
-        return m_materials.find(handle.data.id)->second;
+        return m_materials.get(handle);
     case L3D_CAMERA:
-        return m_cameras.find(handle.data.id)->second;
+        return m_cameras.get(handle);
     case L3D_LIGHT:
-        return m_lights.find(handle.data.id)->second;
+        return m_lights.get(handle);
     case L3D_MESH:
-        return m_meshes.find(handle.data.id)->second;
+        return m_meshes.get(handle);
     case L3D_RENDER_QUEUE:
-        return m_renderQueues.find(handle.data.id)->second;
+        return m_renderQueues.get(handle);
     default:
         return L3D_NULLPTR;
     }
@@ -1253,7 +1738,7 @@ L3DResource* L3DRenderer::getResource(const L3DHandle& handle) const
 L3DBuffer* L3DRenderer::getBuffer(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_BUFFER)
-        return m_buffers.find(handle.data.id)->second;
+        return m_buffers.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1261,7 +1746,7 @@ L3DBuffer* L3DRenderer::getBuffer(const L3DHandle& handle) const
 L3DTexture* L3DRenderer::getTexture(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_TEXTURE)
-        return m_textures.find(handle.data.id)->second;
+        return m_textures.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1269,7 +1754,7 @@ L3DTexture* L3DRenderer::getTexture(const L3DHandle& handle) const
 L3DShader* L3DRenderer::getShader(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_SHADER)
-        return m_shaders.find(handle.data.id)->second;
+        return m_shaders.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1277,7 +1762,7 @@ L3DShader* L3DRenderer::getShader(const L3DHandle& handle) const
 L3DShaderProgram* L3DRenderer::getShaderProgram(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_SHADER_PROGRAM)
-        return m_shaderPrograms.find(handle.data.id)->second;
+        return m_shaderPrograms.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1285,7 +1770,7 @@ L3DShaderProgram* L3DRenderer::getShaderProgram(const L3DHandle& handle) const
 L3DFrameBuffer* L3DRenderer::getFrameBuffer(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_FRAME_BUFFER)
-        return m_frameBuffers.find(handle.data.id)->second;
+        return m_frameBuffers.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1293,7 +1778,7 @@ L3DFrameBuffer* L3DRenderer::getFrameBuffer(const L3DHandle& handle) const
 L3DMaterial* L3DRenderer::getMaterial(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_MATERIAL)
-        return m_materials.find(handle.data.id)->second;
+        return m_materials.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1301,7 +1786,7 @@ L3DMaterial* L3DRenderer::getMaterial(const L3DHandle& handle) const
 L3DCamera* L3DRenderer::getCamera(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_CAMERA)
-        return m_cameras.find(handle.data.id)->second;
+        return m_cameras.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1309,7 +1794,7 @@ L3DCamera* L3DRenderer::getCamera(const L3DHandle& handle) const
 L3DLight* L3DRenderer::getLight(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_LIGHT)
-        return m_lights.find(handle.data.id)->second;
+        return m_lights.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1317,7 +1802,7 @@ L3DLight* L3DRenderer::getLight(const L3DHandle& handle) const
 L3DMesh* L3DRenderer::getMesh(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_MESH)
-        return m_meshes.find(handle.data.id)->second;
+        return m_meshes.get(handle);
 
     return L3D_NULLPTR;
 }
@@ -1325,36 +1810,69 @@ L3DMesh* L3DRenderer::getMesh(const L3DHandle& handle) const
 L3DRenderQueue* L3DRenderer::getRenderQueue(const L3DHandle& handle) const
 {
     if (handle.data.type == L3D_RENDER_QUEUE)
-        return m_renderQueues.find(handle.data.id)->second;
+        return m_renderQueues.get(handle);
 
     return L3D_NULLPTR;
 }
 
-void L3DRenderer::switchFrameBuffer(L3DFrameBuffer* frameBuffer)
+void L3DRenderer::updateRenderBucket(L3DMesh* mesh)
+{
+    if (!mesh)
+        return;
+
+    this->removeFromRenderBucket(mesh);
+
+    // Only meshes which can be drawn are put in a render bucket.
+    if (mesh->material() && mesh->material()->shaderProgram())
+    {
+        L3DRenderBucket& renderBucket = m_renderBuckets[mesh->renderLayer()];
+
+        mesh->m_renderBucketLayer = mesh->renderLayer();
+        mesh->m_renderBucketIndex = renderBucket.meshes.size();
+        renderBucket.meshes.push_back(mesh);
+    }
+}
+
+void L3DRenderer::removeFromRenderBucket(L3DMesh* mesh)
+{
+    if (!mesh || mesh->m_renderBucketIndex < 0)
+        return;
+
+    L3DRenderBucket& renderBucket = m_renderBuckets[mesh->m_renderBucketLayer];
+    unsigned int index = mesh->m_renderBucketIndex;
+
+    // Swap with last mesh and pop: O(1), draws are sorted when recorded.
+    L3DMesh* last = renderBucket.meshes.back();
+    renderBucket.meshes[index] = last;
+    last->m_renderBucketIndex = index;
+    renderBucket.meshes.pop_back();
+
+    mesh->m_renderBucketIndex = -1;
+}
+
+void L3DRenderer::switchFrameBuffer(unsigned int frameBufferId)
 {
     // At every framebuffer switch, update mipmaps of attached textures.
     for (L3DFrameBufferPool::iterator fb_it = m_frameBuffers.begin(); fb_it!=m_frameBuffers.end(); ++fb_it)
     {
-        L3DFrameBuffer* fb = fb_it->second;
+        L3DFrameBuffer* fb = *fb_it;
         L3DTextureAttachments fb_textures = fb->textureAttachments();
         for (L3DTextureAttachments::iterator tex_it = fb_textures.begin(); tex_it!=fb_textures.end(); ++tex_it)
         {
             L3DTexture* texture = tex_it->second;
             if (texture && texture->useMipmap())
             {
-                GLenum gl_type = _toOpenGL(texture->type());
-                glBindTexture(gl_type, texture->id());
-                glGenerateMipmap(gl_type);
-                glBindTexture(gl_type, 0);
+                this->bindTexture(0, texture->type(), texture->glId());
+                glGenerateMipmap(_toOpenGL(texture->type()));
+                this->bindTexture(0, texture->type(), 0);
+                L3D_COUNT(mipmapRegenerations, 1);
             }
 
         }
     }
 
     // Switch to new framebuffer.
-    GLuint frameBufferId = frameBuffer ? frameBuffer->id() : 0;
-
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBufferId);
+    this->bindFrameBuffer(frameBufferId);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
     {
@@ -1363,18 +1881,11 @@ void L3DRenderer::switchFrameBuffer(L3DFrameBuffer* frameBuffer)
 }
 
 void L3DRenderer::clearBuffers(
-    bool colorBuffer,
-    bool depthBuffer,
-    bool stencilBuffer,
-    const L3DVec4& clearColor
+    unsigned int clearMask,
+    const float* clearColor
 )
 {
-    unsigned int clearMask = 0;
-    if (colorBuffer) clearMask |= GL_COLOR_BUFFER_BIT;
-    if (depthBuffer) clearMask |= GL_DEPTH_BUFFER_BIT;
-    if (stencilBuffer) clearMask |= GL_STENCIL_BUFFER_BIT;
-
-    glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
     glClear(clearMask);
 }
 
@@ -1383,18 +1894,48 @@ void L3DRenderer::setDepthTest(
     const L3DDepthFactor& factor
 )
 {
-    enable ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
-    if (enable) glDepthFunc(_toOpenGL(factor));
+    if (m_renderState.depthTest != (unsigned int)enable)
+    {
+        enable ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+        m_renderState.depthTest = enable;
+    }
+    else
+        ++m_renderState.skippedCalls;
+
+    if (enable)
+    {
+        GLenum gl_factor = _toOpenGL(factor);
+
+        if (m_renderState.depthFunc != gl_factor)
+        {
+            glDepthFunc(gl_factor);
+            m_renderState.depthFunc = gl_factor;
+        }
+        else
+            ++m_renderState.skippedCalls;
+    }
 }
 
 void L3DRenderer::setDepthMask(bool enable)
 {
-    glDepthMask(enable ? GL_TRUE : GL_FALSE);
+    if (m_renderState.depthMask != (unsigned int)enable)
+    {
+        glDepthMask(enable ? GL_TRUE : GL_FALSE);
+        m_renderState.depthMask = enable;
+    }
+    else
+        ++m_renderState.skippedCalls;
 }
 
 void L3DRenderer::setStencilTest(bool enable)
 {
-    enable ? glEnable(GL_STENCIL_TEST) : glDisable(GL_STENCIL_TEST);
+    if (m_renderState.stencilTest != (unsigned int)enable)
+    {
+        enable ? glEnable(GL_STENCIL_TEST) : glDisable(GL_STENCIL_TEST);
+        m_renderState.stencilTest = enable;
+    }
+    else
+        ++m_renderState.skippedCalls;
 }
 
 void L3DRenderer::setBlend(
@@ -1403,8 +1944,28 @@ void L3DRenderer::setBlend(
     const L3DBlendFactor& dstFactor
 )
 {
-    enable ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
-    if (enable) glBlendFunc(_toOpenGL(srcFactor), _toOpenGL(dstFactor));
+    if (m_renderState.blend != (unsigned int)enable)
+    {
+        enable ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+        m_renderState.blend = enable;
+    }
+    else
+        ++m_renderState.skippedCalls;
+
+    if (enable)
+    {
+        GLenum gl_src = _toOpenGL(srcFactor);
+        GLenum gl_dst = _toOpenGL(dstFactor);
+
+        if (m_renderState.blendSrcFactor != gl_src || m_renderState.blendDstFactor != gl_dst)
+        {
+            glBlendFunc(gl_src, gl_dst);
+            m_renderState.blendSrcFactor = gl_src;
+            m_renderState.blendDstFactor = gl_dst;
+        }
+        else
+            ++m_renderState.skippedCalls;
+    }
 }
 
 void L3DRenderer::setCullFace(
@@ -1412,167 +1973,1353 @@ void L3DRenderer::setCullFace(
     const L3DCullFace& cullFace
 )
 {
-    enable ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
-    if (enable) glCullFace(_toOpenGL(cullFace));
+    if (m_renderState.cullFace != (unsigned int)enable)
+    {
+        enable ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+        m_renderState.cullFace = enable;
+    }
+    else
+        ++m_renderState.skippedCalls;
+
+    if (enable)
+    {
+        GLenum gl_mode = _toOpenGL(cullFace);
+
+        if (m_renderState.cullFaceMode != gl_mode)
+        {
+            glCullFace(gl_mode);
+            m_renderState.cullFaceMode = gl_mode;
+        }
+        else
+            ++m_renderState.skippedCalls;
+    }
 }
 
-void L3DRenderer::drawMeshes(
-    L3DCamera* camera,
-    unsigned int renderLayer
-)
+void L3DRenderer::bindShaderProgram(unsigned int shaderProgram)
 {
-    if (!camera)
+    if (m_renderState.shaderProgram == shaderProgram)
+    {
+        ++m_renderState.skippedCalls;
         return;
+    }
 
-    L3DVec3 cameraPos = camera->position();
-    L3DMat4 vpMat = camera->proj * camera->view;
+    glUseProgram(shaderProgram);
+    m_renderState.shaderProgram = shaderProgram;
+    L3D_COUNT(shaderProgramBinds, 1);
+}
+
+void L3DRenderer::bindVertexArray(unsigned int vertexArray)
+{
+    if (m_renderState.vertexArray == vertexArray)
+    {
+        ++m_renderState.skippedCalls;
+        return;
+    }
+
+    glBindVertexArray(vertexArray);
+    m_renderState.vertexArray = vertexArray;
+    L3D_COUNT(vertexArrayBinds, 1);
+}
+
+void L3DRenderer::bindFrameBuffer(unsigned int frameBuffer)
+{
+    if (m_renderState.frameBuffer == frameBuffer)
+    {
+        ++m_renderState.skippedCalls;
+        return;
+    }
 
-    L3DRenderBucket renderBucket;
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    m_renderState.frameBuffer = frameBuffer;
+    L3D_COUNT(frameBufferSwitches, 1);
+}
 
-    // Iterate over all meshes, putting all with correct render layer to bucket.
-    for (L3DMeshPool::iterator it = m_meshes.begin(); it != m_meshes.end(); ++it)
+void L3DRenderer::bindTexture(
+    unsigned int unit,
+    const L3DTextureType& type,
+    unsigned int texture
+)
+{
+    // Units out of range are not tracked.
+    if (unit < L3D_MAX_TEXTURE_UNITS && m_renderState.textures[unit][type] == texture)
     {
-        L3DMesh* mesh = it->second;
+        ++m_renderState.skippedCalls;
+        return;
+    }
 
-        if (mesh && mesh->renderLayer() == renderLayer && mesh->material() && mesh->material()->shaderProgram())
-        {
-            renderBucket.push_back(mesh);
-        }
+    if (m_renderState.activeTextureUnit != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_renderState.activeTextureUnit = unit;
     }
 
-    // Sort the generated render bucket.
-    // TODO: no need to do it every frame! Make things smart allowing meshes to
-    //       notify when the bucket should be sorted again...
-    renderBucket.sort(_l3dMeshSortFunctor());
+    glBindTexture(_toOpenGL(type), texture);
+    L3D_COUNT(textureBinds, 1);
+
+    if (unit < L3D_MAX_TEXTURE_UNITS)
+        m_renderState.textures[unit][type] = texture;
+}
+
+int L3DRenderer::uniformLocationToWrite(
+    L3DShaderProgram* shaderProgram,
+    unsigned int uniformId,
+    const void* value,
+    unsigned int size
+)
+{
+    int location = shaderProgram->uniformLocation(uniformId);
+
+    if (location < 0)
+        return -1;
 
-    // Iterate over render bucket and render each collected mesh.
-    // Meshes in bucket are ordered now by material to reduce context changes.
-    for (L3DRenderBucket::iterator it = renderBucket.begin(); it != renderBucket.end(); ++it)
+    // Program keeps its uniform values, skips them if unchanged.
+    if (!shaderProgram->cacheUniformValue(uniformId, value, size))
     {
-        L3DMesh* mesh = *it;
-        L3DMaterial* material = mesh->material();
-        L3DShaderProgram* shaderProgram = material->shaderProgram();
-        GLenum gl_draw_primitive = _toOpenGL(mesh->drawPrimitive());
-        unsigned int index_count = mesh->indexCount();
-        unsigned int instance_count = mesh->instanceCount();
+        ++m_renderState.skippedCalls;
+        return -1;
+    }
 
-        // Binds VAO.
-        glBindVertexArray(mesh->id());
+    L3D_COUNT(uniformUploads, 1);
 
-        // Binds shaders.
-        glUseProgram(shaderProgram->id());
+    return location;
+}
 
-        // Binds uniforms.
-        L3DUniformMap uniforms = shaderProgram->uniforms();
-        for (L3DUniformMap::iterator unif_it = uniforms.begin(); unif_it!=uniforms.end(); ++unif_it)
-            _setUniform(shaderProgram->id(), unif_it->first.c_str(), unif_it->second);
+void L3DRenderer::setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DUniform& value)
+{
+    _setUniform(this->uniformLocationToWrite(shaderProgram, uniformId, _uniformData(value), _uniformSize(value)), value);
+}
 
-        // Binds matrices and vectors.
-        glUniform3fv(glGetUniformLocation(shaderProgram->id(), "u_cameraPos"), 1, glm::value_ptr(cameraPos));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram->id(), "u_vpMat"), 1, GL_FALSE, glm::value_ptr(vpMat));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram->id(), "u_viewMat"), 1, GL_FALSE, glm::value_ptr(camera->view));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram->id(), "u_projMat"), 1, GL_FALSE, glm::value_ptr(camera->proj));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram->id(), "u_modelMat"), 1, GL_FALSE, glm::value_ptr(mesh->transMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(shaderProgram->id(), "u_normalMat"), 1, GL_FALSE, glm::value_ptr(mesh->normalMatrix()));
+void L3DRenderer::setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, int value)
+{
+    GLint location = this->uniformLocationToWrite(shaderProgram, uniformId, &value, sizeof(value));
+    if (location >= 0) glUniform1i(location, value);
+}
 
-        // Binds material:
-        std::string materialName = "u_material.";
+void L3DRenderer::setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, float value)
+{
+    GLint location = this->uniformLocationToWrite(shaderProgram, uniformId, &value, sizeof(value));
+    if (location >= 0) glUniform1f(location, value);
+}
 
-        // 1. Colors.
-        for (L3DColorRegistry::iterator col_it = material->colors.begin(); col_it!=material->colors.end(); ++col_it)
-            _setUniform(shaderProgram->id(), (materialName + col_it->first).c_str(), col_it->second);
+void L3DRenderer::setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DVec3& value)
+{
+    GLint location = this->uniformLocationToWrite(shaderProgram, uniformId, glm::value_ptr(value), sizeof(value));
+    if (location >= 0) glUniform3fv(location, 1, glm::value_ptr(value));
+}
 
-        // 2. Parameters.
-        for (L3DParameterRegistry::iterator par_it = material->params.begin(); par_it!=material->params.end(); ++par_it)
-            _setUniform(shaderProgram->id(), (materialName + par_it->first).c_str(), par_it->second);
+void L3DRenderer::setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DVec4& value)
+{
+    GLint location = this->uniformLocationToWrite(shaderProgram, uniformId, glm::value_ptr(value), sizeof(value));
+    if (location >= 0) glUniform4fv(location, 1, glm::value_ptr(value));
+}
 
-        // 3. Textures.
-        if (material->textures.size() > 0)
-        {
-            std::string samplerName = "u_";
+void L3DRenderer::setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DMat3& value)
+{
+    GLint location = this->uniformLocationToWrite(shaderProgram, uniformId, glm::value_ptr(value), sizeof(value));
+    if (location >= 0) glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
 
-            unsigned int i = 0;
-            for (L3DTextureRegistry::iterator tex_it = material->textures.begin(); tex_it!=material->textures.end(); ++tex_it)
-            {
-                L3DTexture* texture = tex_it->second;
+void L3DRenderer::setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DMat4& value)
+{
+    GLint location = this->uniformLocationToWrite(shaderProgram, uniformId, glm::value_ptr(value), sizeof(value));
+    if (location >= 0) glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
 
-                if (texture)
-                {
-                    GLenum gl_type = _toOpenGL(texture->type());
-                    GLint gl_sampler = glGetUniformLocation(shaderProgram->id(), (samplerName + tex_it->first).c_str());
+void L3DRenderer::invalidateMeshBounds(L3DMesh* mesh)
+{
+    if (mesh && !mesh->m_boundsDirty && mesh->m_bvhProxy != L3D_BVH_NULL_NODE)
+    {
+        mesh->m_boundsDirty = true;
+        m_dirtyMeshes.push_back(mesh);
+    }
+}
 
-                    // Activate texture unit and bind sampler.
-                    glActiveTexture(GL_TEXTURE0 + i);
-                    glBindTexture(gl_type, texture->id());
-                    glUniform1i(gl_sampler, i);
+void L3DRenderer::updateMeshBounds()
+{
+    this->updateTransforms();
 
-                    // Set map flag.
-                    glUniform1i(glGetUniformLocation(shaderProgram->id(), (samplerName + tex_it->first + "Enabled").c_str()), GL_TRUE);
+    // Refits only meshes moved since last update. Bounds and normal
+    // matrices are computed by jobs, tree is updated afterwards.
+    m_jobs.parallelFor(m_dirtyMeshes.size(), _boundsUpdateGrainSize, &L3DRenderer::updateMeshBoundsJob, this);
 
-                    ++i;
-                }
-            }
-        }
-        else
-        {
-            glBindTexture(GL_TEXTURE_1D, 0);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glBindTexture(GL_TEXTURE_3D, 0);
-        }
+    for (std::vector<L3DMesh*>::iterator it = m_dirtyMeshes.begin(); it != m_dirtyMeshes.end(); ++it)
+    {
+        L3DMesh* mesh = *it;
+        mesh->m_boundsDirty = false;
+        m_bvh.move(mesh->m_bvhProxy, mesh->m_worldBounds);
+    }
 
-        // Binds lights.
-        int activeLightCount = 0;
-        for (L3DLightPool::iterator light_it = m_lights.begin(); light_it!=m_lights.end(); ++light_it)
-        {
-            L3DLight* light = light_it->second;
+    m_dirtyMeshes.clear();
+}
 
-            if (light && light->isOn() && L3D_TEST_BIT(light->renderLayerMask(), renderLayer))
-            {
-                std::ostringstream sstream;
-                sstream << "u_light[" << activeLightCount << "]";
-                std::string lightName = sstream.str();
-
-                _setUniform(shaderProgram->id(), (lightName + ".type").c_str(), light->type);
-                _setUniform(shaderProgram->id(), (lightName + ".position").c_str(), light->position);
-                _setUniform(shaderProgram->id(), (lightName + ".direction").c_str(), light->direction);
-                _setUniform(shaderProgram->id(), (lightName + ".color").c_str(), light->color);
-                _setUniform(shaderProgram->id(), (lightName + ".kc").c_str(), light->attenuation.kc);
-                _setUniform(shaderProgram->id(), (lightName + ".kl").c_str(), light->attenuation.kl);
-                _setUniform(shaderProgram->id(), (lightName + ".kq").c_str(), light->attenuation.kq);
-
-                ++activeLightCount;
-            }
-        }
+void L3DRenderer::attachMeshToNode(L3DMesh* mesh, unsigned int node)
+{
+    if (!mesh || mesh->m_node == node)
+        return;
 
-        // Passes count of active lights.
-        _setUniform(shaderProgram->id(), "u_lightNr", (int)activeLightCount);
+    if (node && !m_transformGraph.isValid(node))
+        return;
 
-        // Renders geometry.
-        if (index_count > 0)
-        {
-            // Renders vertices using indices.
-            if (instance_count > 1)
-            {
-                glDrawElementsInstanced(gl_draw_primitive, index_count, GL_UNSIGNED_INT, 0, instance_count);
-            }
-            else
-            {
-                glDrawElements(gl_draw_primitive, index_count, GL_UNSIGNED_INT, 0);
-            }
-        }
-        else
-        {
-            // Renders vertices without using indices.
-            if (instance_count > 1)
+    // Detached meshes keep their current world matrix.
+    if (mesh->m_node)
+    {
+        L3DMesh* last = m_nodeMeshes.back();
+        m_nodeMeshes[mesh->m_nodeMeshIndex] = last;
+        last->m_nodeMeshIndex = mesh->m_nodeMeshIndex;
+        m_nodeMeshes.pop_back();
+        mesh->m_nodeMeshIndex = -1;
+        mesh->m_node = 0;
+    }
+
+    // Current transform of attached mesh becomes relative to node.
+    if (node)
+    {
+        mesh->m_localMatrix = mesh->transMatrix;
+        mesh->m_node = node;
+        mesh->m_nodeMeshIndex = m_nodeMeshes.size();
+        m_nodeMeshes.push_back(mesh);
+        mesh->updateTransMatrix();
+    }
+}
+
+void L3DRenderer::updateTransforms()
+{
+    if (!m_transformGraph.update())
+        return;
+
+    for (std::vector<L3DMesh*>::iterator it = m_nodeMeshes.begin(); it != m_nodeMeshes.end(); ++it)
+    {
+        L3DMesh* mesh = *it;
+        if (m_transformGraph.hasChanged(mesh->m_node))
+            mesh->updateTransMatrix();
+    }
+}
+
+void L3DRenderer::updateMeshBoundsJob(void* data, unsigned int first, unsigned int last)
+{
+    L3DRenderer* renderer = static_cast<L3DRenderer*>(data);
+
+    const L3DMat4* transMatrices[_normalMatrixBatchSize];
+    L3DMat3* normalMatrices[_normalMatrixBatchSize];
+    unsigned int batchSize = 0;
+
+    for (unsigned int i = first; i < last; ++i)
+    {
+        L3DMesh* mesh = renderer->m_dirtyMeshes[i];
+        mesh->m_worldBounds = mesh->worldBounds();
+        mesh->m_worldRadius = mesh->worldBoundingSphere().radius;
+
+        transMatrices[batchSize] = &mesh->transMatrix;
+        normalMatrices[batchSize] = &mesh->m_normalMatrix;
+
+        if (++batchSize == _normalMatrixBatchSize || i + 1 == last)
+        {
+            L3DMatrixBatch::normalMatrices(transMatrices, normalMatrices, batchSize);
+            batchSize = 0;
+        }
+    }
+}
+
+void L3DRenderer::queryMeshes(const L3DAABB& aabb, std::vector<L3DMesh*>& meshes)
+{
+    this->updateMeshBounds();
+
+    std::vector<int> proxies;
+    m_bvh.query(aabb, proxies);
+
+    for (std::vector<int>::iterator it = proxies.begin(); it != proxies.end(); ++it)
+    {
+        L3DMesh* mesh = static_cast<L3DMesh*>(m_bvh.userData(*it));
+        if (mesh->m_worldBounds.overlaps(aabb))
+            meshes.push_back(mesh);
+    }
+}
+
+void L3DRenderer::queryMeshes(const L3DBoundingSphere& sphere, std::vector<L3DMesh*>& meshes)
+{
+    this->updateMeshBounds();
+
+    std::vector<int> proxies;
+    m_bvh.query(sphere, proxies);
+
+    for (std::vector<int>::iterator it = proxies.begin(); it != proxies.end(); ++it)
+    {
+        L3DMesh* mesh = static_cast<L3DMesh*>(m_bvh.userData(*it));
+        if (mesh->m_worldBounds.overlaps(sphere))
+            meshes.push_back(mesh);
+    }
+}
+
+void L3DRenderer::queryMeshes(
+    const L3DVec3& origin,
+    const L3DVec3& direction,
+    float maxDistance,
+    std::vector<L3DMesh*>& meshes
+)
+{
+    this->updateMeshBounds();
+
+    std::vector<int> proxies;
+    m_bvh.query(origin, direction, maxDistance, proxies);
+
+    // Sorts hits by distance along the ray.
+    std::vector<std::pair<float, L3DMesh*> > hits;
+    L3DVec3 invDirection = 1.0f / direction;
+
+    for (std::vector<int>::iterator it = proxies.begin(); it != proxies.end(); ++it)
+    {
+        L3DMesh* mesh = static_cast<L3DMesh*>(m_bvh.userData(*it));
+        float distance = 0;
+
+        if (mesh->m_worldBounds.intersects(origin, invDirection, maxDistance, &distance))
+            hits.push_back(std::make_pair(distance, mesh));
+    }
+
+    std::sort(hits.begin(), hits.end());
+
+    for (std::vector<std::pair<float, L3DMesh*> >::iterator it = hits.begin(); it != hits.end(); ++it)
+        meshes.push_back(it->second);
+}
+
+void L3DRenderer::cullMeshes()
+{
+    m_insideProxies.clear();
+    m_intersectingProxies.clear();
+
+    m_visibleMeshes.clear();
+
+    m_bvh.query(m_frustum, m_insideProxies, m_intersectingProxies);
+
+    // Meshes whose enlarged bounds are fully inside are visible.
+    for (std::vector<int>::iterator it = m_insideProxies.begin(); it != m_insideProxies.end(); ++it)
+    {
+        L3DMesh* mesh = static_cast<L3DMesh*>(m_bvh.userData(*it));
+        mesh->m_visibleFrame = m_frameIndex;
+        m_visibleMeshes.push_back(mesh);
+    }
+
+    // The others are tested all at once against their exact bounds.
+    unsigned int count = m_intersectingProxies.size();
+
+    if (count == 0)
+        return;
+
+    m_cullBounds.clear();
+    m_cullBounds.reserve(count);
+    m_visibility = m_frameArena.allocate<unsigned char>(count);
+
+    for (std::vector<int>::iterator it = m_intersectingProxies.begin(); it != m_intersectingProxies.end(); ++it)
+    {
+        L3DMesh* mesh = static_cast<L3DMesh*>(m_bvh.userData(*it));
+        m_cullBounds.add(mesh->m_worldBounds.center(), mesh->m_worldBounds.extents(), mesh->m_worldRadius);
+    }
+
+    m_jobs.parallelFor(count, _cullGrainSize, &L3DRenderer::cullMeshesJob, this);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (m_visibility[i])
+        {
+            L3DMesh* mesh = static_cast<L3DMesh*>(m_bvh.userData(m_intersectingProxies[i]));
+            mesh->m_visibleFrame = m_frameIndex;
+            m_visibleMeshes.push_back(mesh);
+        }
+    }
+}
+
+void L3DRenderer::cullMeshesJob(void* data, unsigned int first, unsigned int last)
+{
+    L3DRenderer* renderer = static_cast<L3DRenderer*>(data);
+    renderer->m_frustum.cull(renderer->m_cullBounds, first, last - first, renderer->m_visibility);
+}
+
+void L3DRenderer::occludeMeshes(const L3DMat4& vpMat)
+{
+    m_occlusionBuffer.clear(vpMat);
+
+    // Draws visible occluders in the depth buffer first.
+    for (std::vector<L3DMesh*>::iterator it = m_visibleMeshes.begin(); it != m_visibleMeshes.end(); ++it)
+    {
+        L3DMesh* mesh = *it;
+        L3DBuffer* vertexBuffer = mesh->vertexBuffer();
+        L3DBuffer* indexBuffer = mesh->indexBuffer();
+
+        if (!mesh->hasFlag(L3D_MESH_OCCLUDER) || mesh->drawPrimitive() != L3D_DRAW_TRIANGLES || !vertexBuffer)
+            continue;
+
+        // 2D vertices have no depth.
+        if (mesh->vertexFormat() == L3D_VERTEX_POS2 || mesh->vertexFormat() == L3D_VERTEX_POS2_UV2)
+            continue;
+
+        m_occlusionBuffer.rasterize(
+            vertexBuffer->data<float>(),
+            mesh->vertexCount(),
+            mesh->vertexFormat(),
+            indexBuffer ? indexBuffer->data<unsigned int>() : L3D_NULLPTR,
+            mesh->indexCount(),
+            mesh->transMatrix
+        );
+    }
+
+    if (m_occlusionBuffer.occluderTriangleCount() == 0)
+        return;
+
+    // Then tests the other meshes against it.
+    for (std::vector<L3DMesh*>::iterator it = m_visibleMeshes.begin(); it != m_visibleMeshes.end(); ++it)
+    {
+        L3DMesh* mesh = *it;
+
+        if (!mesh->hasFlag(L3D_MESH_CULLING) || mesh->hasFlag(L3D_MESH_OCCLUDER))
+            continue;
+
+        if (m_occlusionBuffer.isOccluded(mesh->m_worldBounds))
+            mesh->m_visibleFrame = 0;
+    }
+}
+
+void L3DRenderer::bindMaterial(
+    L3DShaderProgram* shaderProgram,
+    L3DMaterial* material
+)
+{
+    // Resolves registries to uniform ids, if they changed.
+    material->updateUniforms();
+
+    // 1. Colors.
+    const L3DMaterialColorList& colors = material->colorUniforms();
+    for (L3DMaterialColorList::const_iterator col_it = colors.begin(); col_it!=colors.end(); ++col_it)
+        this->setUniform(shaderProgram, col_it->id, *col_it->value);
+
+    // 2. Parameters.
+    const L3DMaterialParameterList& params = material->paramUniforms();
+    for (L3DMaterialParameterList::const_iterator par_it = params.begin(); par_it!=params.end(); ++par_it)
+        this->setUniform(shaderProgram, par_it->id, *par_it->value);
+
+    // 3. Textures.
+    const L3DMaterialTextureList& textures = material->textureUniforms();
+    if (textures.size() > 0)
+    {
+        unsigned int i = 0;
+        for (L3DMaterialTextureList::const_iterator tex_it = textures.begin(); tex_it!=textures.end(); ++tex_it)
+        {
+            L3DTexture* texture = *tex_it->value;
+
+            if (texture)
+            {
+                // Activate texture unit and bind sampler.
+                this->bindTexture(i, texture->type(), texture->glId());
+                this->setUniform(shaderProgram, tex_it->id, (int)i);
+
+                // Set map flag.
+                this->setUniform(shaderProgram, tex_it->flagId, (int)GL_TRUE);
+
+                ++i;
+            }
+        }
+    }
+    else
+    {
+        unsigned int unit = (m_renderState.activeTextureUnit < L3D_MAX_TEXTURE_UNITS) ? m_renderState.activeTextureUnit : 0;
+
+        this->bindTexture(unit, L3D_TEXTURE_1D, 0);
+        this->bindTexture(unit, L3D_TEXTURE_2D, 0);
+        this->bindTexture(unit, L3D_TEXTURE_3D, 0);
+    }
+}
+
+void L3DRenderer::bindLights(
+    L3DShaderProgram* shaderProgram,
+    unsigned int renderLayer
+)
+{
+    int activeLightCount = 0;
+    for (L3DLightPool::iterator light_it = m_lights.begin(); light_it!=m_lights.end(); ++light_it)
+    {
+        L3DLight* light = *light_it;
+
+        if (light && light->isOn() && L3D_TEST_BIT(light->renderLayerMask(), renderLayer))
+        {
+            if (activeLightCount < L3D_MAX_LIGHTS)
+            {
+                this->setUniform(shaderProgram, L3DShaderProgram::lightUniformId(activeLightCount, L3D_LIGHT_UNIFORM_TYPE), (int)light->type);
+                this->setUniform(shaderProgram, L3DShaderProgram::lightUniformId(activeLightCount, L3D_LIGHT_UNIFORM_POSITION), light->position);
+                this->setUniform(shaderProgram, L3DShaderProgram::lightUniformId(activeLightCount, L3D_LIGHT_UNIFORM_DIRECTION), light->direction);
+                this->setUniform(shaderProgram, L3DShaderProgram::lightUniformId(activeLightCount, L3D_LIGHT_UNIFORM_COLOR), light->color);
+                this->setUniform(shaderProgram, L3DShaderProgram::lightUniformId(activeLightCount, L3D_LIGHT_UNIFORM_KC), light->attenuation.kc);
+                this->setUniform(shaderProgram, L3DShaderProgram::lightUniformId(activeLightCount, L3D_LIGHT_UNIFORM_KL), light->attenuation.kl);
+                this->setUniform(shaderProgram, L3DShaderProgram::lightUniformId(activeLightCount, L3D_LIGHT_UNIFORM_KQ), light->attenuation.kq);
+            }
+
+            ++activeLightCount;
+        }
+    }
+
+    // Passes count of active lights.
+    this->setUniform(shaderProgram, L3D_UNIFORM_LIGHT_NR, activeLightCount);
+}
+
+void L3DRenderer::allocateBuffer(L3DBuffer* buffer)
+{
+    unsigned int key = (buffer->type() << 24) | (buffer->drawType() << 16) | buffer->stride();
+    unsigned int count = buffer->count();
+    std::pair<L3DBufferArenaPool::iterator, L3DBufferArenaPool::iterator> range = m_bufferArenas.equal_range(key);
+    L3DBufferArena* arena = L3D_NULLPTR;
+    int block = L3D_INVALID_BLOCK;
+
+    for (L3DBufferArenaPool::iterator it = range.first; it != range.second && block == L3D_INVALID_BLOCK; ++it)
+    {
+        arena = it->second;
+        block = arena->allocator.allocate(count);
+    }
+
+    // Mapped arenas can't grow, a new one is added instead.
+    if (block == L3D_INVALID_BLOCK)
+    {
+        if (arena && !arena->mappedData)
+            this->growBufferArena(arena, arena->allocator.capacity() + count);
+        else
+            m_bufferArenas.insert(std::make_pair(key, arena = this->createBufferArena(buffer)));
+
+        block = arena->allocator.allocate(count);
+    }
+
+    buffer->m_arena = arena;
+    buffer->m_block = block;
+}
+
+L3DBufferArena* L3DRenderer::createBufferArena(L3DBuffer* buffer)
+{
+    L3DBufferArena* arena = new L3DBufferArena();
+    arena->type = buffer->type();
+    arena->drawType = buffer->drawType();
+    arena->stride = buffer->stride();
+
+    unsigned int capacity = glm::max(buffer->count(), _bufferArenaSize / arena->stride);
+
+    glGenBuffers(1, &arena->buffer);
+
+    // Dynamic arenas are mapped once for their whole life, they fall back
+    // to orphaning without OpenGL 4.4.
+    if (arena->drawType == L3D_DRAW_DYNAMIC && GLAD_GL_VERSION_4_4)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr size = capacity * arena->stride * L3D_BUFFER_RING_SIZE;
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, arena->buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, 0, flags);
+        arena->mappedData = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        arena->regionCount = L3D_BUFFER_RING_SIZE;
+        arena->region = m_bufferRingIndex;
+        arena->allocator.grow(capacity);
+
+        m_bufferRing = true;
+    }
+    else
+    {
+        this->growBufferArena(arena, capacity);
+    }
+
+    return arena;
+}
+
+void L3DRenderer::growBufferArena(L3DBufferArena* arena, unsigned int capacity)
+{
+    unsigned int oldCapacity = arena->allocator.capacity();
+
+    if (capacity <= oldCapacity)
+        return;
+
+    capacity = glm::max(capacity, oldCapacity * 2);
+
+    unsigned int stride = arena->stride;
+    GLuint temp = 0;
+
+    // Content is moved through a temporary buffer, so that arena keeps its
+    // name and VAOs pointing to it stay valid.
+    if (oldCapacity)
+    {
+        glGenBuffers(1, &temp);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+        glBufferData(GL_COPY_WRITE_BUFFER, oldCapacity * stride, 0, GL_STREAM_COPY);
+        glBindBuffer(GL_COPY_READ_BUFFER, arena->buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity * stride);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena->buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity * stride, 0, _toOpenGL(arena->drawType));
+
+    if (temp)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, temp);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity * stride);
+        glDeleteBuffers(1, &temp);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    arena->allocator.grow(capacity);
+}
+
+void L3DRenderer::defragmentBuffers()
+{
+    std::vector<L3DBufferMove> moves;
+
+    for (L3DBufferArenaPool::iterator it = m_bufferArenas.begin(); it != m_bufferArenas.end(); ++it)
+    {
+        L3DBufferArena* arena = it->second;
+
+        moves.clear();
+        arena->allocator.defragment(moves);
+
+        if (moves.empty())
+            continue;
+
+        // Blocks only move towards the start and may overlap their old
+        // ranges, so moved span is copied aside first.
+        unsigned int stride = arena->stride;
+        unsigned int start = moves.front().srcOffset;
+        unsigned int end = moves.back().srcOffset + moves.back().size;
+
+        GLuint temp = 0;
+        glGenBuffers(1, &temp);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+        glBufferData(GL_COPY_WRITE_BUFFER, (end - start) * stride, 0, GL_STREAM_COPY);
+
+        for (unsigned int r = 0; r < arena->regionCount; ++r)
+        {
+            unsigned int base = r * arena->allocator.capacity();
+
+            glBindBuffer(GL_COPY_READ_BUFFER, arena->buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (base + start) * stride, 0, (end - start) * stride);
+
+            glBindBuffer(GL_COPY_READ_BUFFER, temp);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, arena->buffer);
+
+            for (std::vector<L3DBufferMove>::iterator m = moves.begin(); m != moves.end(); ++m)
+            {
+                glCopyBufferSubData(
+                    GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                    (m->srcOffset - start) * stride, (base + m->dstOffset) * stride, m->size * stride
+                );
+            }
+        }
+
+        glDeleteBuffers(1, &temp);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void L3DRenderer::invalidateBuffer(L3DBuffer* buffer, unsigned int offset, unsigned int size)
+{
+    if (!buffer->m_arena || size == 0)
+        return;
+
+    if (buffer->m_dirtyFrames)
+    {
+        buffer->m_dirtyBegin = glm::min(buffer->m_dirtyBegin, offset);
+        buffer->m_dirtyEnd = glm::max(buffer->m_dirtyEnd, offset + size);
+    }
+    else
+    {
+        buffer->m_dirtyBegin = offset;
+        buffer->m_dirtyEnd = offset + size;
+        m_dirtyBuffers.push_back(buffer);
+    }
+
+    // Range must reach every region of ring arenas.
+    buffer->m_dirtyFrames = buffer->m_arena->regionCount;
+}
+
+void L3DRenderer::uploadBuffers()
+{
+    // Moves ring arenas to next region, waiting for GPU to be done with
+    // frame which last read it.
+    if (m_bufferRing)
+    {
+        m_bufferRingIndex = (m_bufferRingIndex + 1) % L3D_BUFFER_RING_SIZE;
+
+        GLsync& fence = m_bufferRingFences[m_bufferRingIndex];
+        if (fence)
+        {
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, L3D_BUFFER_RING_TIMEOUT);
+
+            // Wait is bounded, region must be released before writing it.
+            if (result == GL_WAIT_FAILED || result == GL_TIMEOUT_EXPIRED)
+            {
+                fprintf(stderr, "Buffer ring fence %s, waiting for GPU to finish!\n", result == GL_WAIT_FAILED ? "failed" : "timed out");
+                glFinish();
+            }
+
+            glDeleteSync(fence);
+            fence = 0;
+        }
+
+        for (L3DBufferArenaPool::iterator it = m_bufferArenas.begin(); it != m_bufferArenas.end(); ++it)
+        {
+            if (it->second->mappedData)
+                it->second->region = m_bufferRingIndex;
+        }
+    }
+
+    unsigned int kept = 0;
+
+    for (unsigned int i = 0; i < m_dirtyBuffers.size(); ++i)
+    {
+        L3DBuffer* buffer = m_dirtyBuffers[i];
+        L3DBufferArena* arena = buffer->m_arena;
+        const unsigned char* data = buffer->data<unsigned char>();
+        unsigned int begin = buffer->m_dirtyBegin;
+        unsigned int size = buffer->m_dirtyEnd - begin;
+
+        if (!data)
+        {
+            // Nothing to upload.
+        }
+        else if (arena->mappedData)
+        {
+            memcpy(arena->mappedData + buffer->offset() * arena->stride + begin, data + begin, size);
+            L3D_COUNT(uploadedBytes, size);
+        }
+        else if (arena->drawType == L3D_DRAW_DYNAMIC)
+        {
+            arena->orphaned = true;
+        }
+        else
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, arena->buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, buffer->offset() * arena->stride + begin, size, data + begin);
+            L3D_COUNT(uploadedBytes, size);
+        }
+
+        if (--buffer->m_dirtyFrames > 0)
+            m_dirtyBuffers[kept++] = buffer;
+    }
+
+    m_dirtyBuffers.resize(kept);
+
+    for (L3DBufferArenaPool::iterator it = m_bufferArenas.begin(); it != m_bufferArenas.end(); ++it)
+    {
+        if (it->second->orphaned)
+            this->refillBufferArena(it->second);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void L3DRenderer::refillBufferArena(L3DBufferArena* arena)
+{
+    // Orphans old storage, so that frames still reading it are not
+    // stalled, then uploads all buffers of the arena again.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena->buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, arena->allocator.capacity() * arena->stride, 0, _toOpenGL(arena->drawType));
+
+    for (L3DBufferPool::iterator it = m_buffers.begin(); it != m_buffers.end(); ++it)
+    {
+        L3DBuffer* buffer = *it;
+
+        if (buffer->m_arena == arena && buffer->data())
+        {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, buffer->offset() * arena->stride, buffer->count() * arena->stride, buffer->data());
+            L3D_COUNT(uploadedBytes, buffer->count() * arena->stride);
+        }
+    }
+
+    arena->orphaned = false;
+}
+
+void L3DRenderer::setGpuTiming(bool enable)
+{
+    if (enable == m_gpuTimers || (enable && !GLAD_GL_VERSION_3_3))
+        return;
+
+    for (unsigned int i = 0; i < L3D_GPU_TIMER_FRAMES; ++i)
+    {
+        L3DGpuTimerFrame& frame = m_gpuTimerFrames[i];
+
+        if (enable)
+            glGenQueries(L3D_MAX_GPU_TIMINGS, frame.queries);
+        else
+            glDeleteQueries(L3D_MAX_GPU_TIMINGS, frame.queries);
+
+        frame.count = 0;
+    }
+
+    m_gpuTimers = enable;
+    m_gpuTimerFrame = 0;
+    m_gpuTimings.clear();
+}
+
+void L3DRenderer::readGpuTimings()
+{
+    L3DGpuTimerFrame& frame = m_gpuTimerFrames[m_gpuTimerFrame];
+
+    if (frame.count == 0)
+        return;
+
+    // Results come in order, if last one is missing GPU is too far behind
+    // and they are dropped rather than waited for.
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (available)
+    {
+        m_gpuTimings.resize(frame.count);
+
+        for (unsigned int i = 0; i < frame.count; ++i)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed);
+
+            m_gpuTimings[i] = frame.timings[i];
+            m_gpuTimings[i].milliseconds = elapsed / 1000000.0;
+        }
+    }
+
+    frame.count = 0;
+}
+
+bool L3DRenderer::beginGpuTiming(const L3DRenderCommand& command)
+{
+    L3DGpuTimerFrame& frame = m_gpuTimerFrames[m_gpuTimerFrame];
+
+    if (frame.count >= L3D_MAX_GPU_TIMINGS)
+        return false;
+
+    L3DGpuTiming& timing = frame.timings[frame.count];
+    timing.commandType = command.type;
+    timing.renderLayer = 0;
+    timing.frameIndex = m_frameIndex;
+
+    char name[32];
+
+    switch (command.type)
+    {
+    case L3D_SWITCH_FRAME_BUFFER:
+        snprintf(name, sizeof(name), "Switch frame buffer %u", command.switchFrameBuffer.frameBufferId);
+        break;
+    case L3D_CLEAR_BUFFERS:
+        snprintf(name, sizeof(name), "Clear buffers");
+        break;
+    case L3D_DRAW_MESHES:
+        timing.renderLayer = command.drawMeshes.renderLayer;
+        snprintf(name, sizeof(name), "Draw render layer %u", (unsigned int)command.drawMeshes.renderLayer);
+        break;
+    default:
+        return false;
+    }
+
+    // Groups passes in debuggers and GL call traces. KHR_debug has same
+    // entry points as OpenGL 4.3 in desktop contexts.
+    if (GLAD_GL_VERSION_4_3 || GLAD_GL_KHR_debug)
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, frame.count, -1, name);
+
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.count]);
+
+    return true;
+}
+
+void L3DRenderer::endGpuTiming()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+
+    if (GLAD_GL_VERSION_4_3 || GLAD_GL_KHR_debug)
+        glPopDebugGroup();
+
+    ++m_gpuTimerFrames[m_gpuTimerFrame].count;
+}
+
+L3DBufferStats L3DRenderer::bufferStats() const
+{
+    L3DBufferStats stats;
+    unsigned int freeSize = 0;
+    unsigned int largestFreeSize = 0;
+
+    for (L3DBufferArenaPool::const_iterator it = m_bufferArenas.begin(); it != m_bufferArenas.end(); ++it)
+    {
+        const L3DBufferArena* arena = it->second;
+        const L3DBufferAllocator& allocator = arena->allocator;
+        unsigned int largestFreeBlock = allocator.largestFreeBlock() * arena->stride;
+
+        stats.arenaCount++;
+        stats.bufferCount += allocator.allocationCount();
+        stats.capacity += allocator.capacity() * arena->stride;
+        stats.usedSize += allocator.usedSize() * arena->stride;
+        stats.freeBlockCount += allocator.freeBlockCount();
+        stats.largestFreeBlock = glm::max(stats.largestFreeBlock, largestFreeBlock);
+
+        freeSize += allocator.freeSize() * arena->stride;
+        largestFreeSize += largestFreeBlock;
+    }
+
+    if (freeSize > 0)
+        stats.fragmentation = 1.0f - (float)largestFreeSize / (float)freeSize;
+
+    if (stats.capacity > 0)
+        stats.utilisation = (float)stats.usedSize / (float)stats.capacity;
+
+    return stats;
+}
+
+void L3DRenderer::bindInstanceBuffer(L3DMesh* mesh)
+{
+    L3DBuffer* instanceBuffer = mesh->instanceBuffer();
+
+    if (!instanceBuffer->arena())
+        return;
+
+    // Binds instance arena. Attributes start at its beginning if draws
+    // can pass a base instance, at instances of this mesh otherwise.
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer->arena()->buffer);
+
+    mesh->m_instanceOffset = GLAD_GL_VERSION_4_2 ? 0 : instanceBuffer->offset();
+
+    GLintptr base = mesh->m_instanceOffset * instanceBuffer->stride();
+
+    if (mesh->material() && mesh->material()->shaderProgram())
+    {
+        L3DMaterial* material = mesh->material();
+        L3DShaderProgram* shaderProgram = material->shaderProgram();
+        L3DAttributeMap shaderAttributes = shaderProgram->attributes();
+
+        // Enables instanced attributes.
+        GLint iposAttrib   = glGetAttribLocation(shaderProgram->glId(), shaderAttributes[L3D_INSTANCE_POSITION].c_str());
+        GLint itexAttrib   = glGetAttribLocation(shaderProgram->glId(), shaderAttributes[L3D_INSTANCE_UV].c_str());
+        GLint itransAttrib = glGetAttribLocation(shaderProgram->glId(), shaderAttributes[L3D_INSTANCE_MATRIX].c_str());
+
+        switch(mesh->instanceFormat())
+        {
+        case L3D_INSTANCE_POS2:
+            _enableVertexAttribute(iposAttrib, 2, GL_FLOAT, 2*sizeof(GLfloat), (void*)base, GL_FALSE, 1);
+            break;
+        case L3D_INSTANCE_POS3:
+            _enableVertexAttribute(iposAttrib, 3, GL_FLOAT, 3*sizeof(GLfloat), (void*)base, GL_FALSE, 1);
+            break;
+        case L3D_INSTANCE_POS2_UV2:
+            _enableVertexAttribute(iposAttrib, 2, GL_FLOAT, 4*sizeof(GLfloat), (void*)base, GL_FALSE, 1);
+            _enableVertexAttribute(itexAttrib, 2, GL_FLOAT, 4*sizeof(GLfloat), (void*)(base + 2*sizeof(GLfloat)), GL_FALSE, 1);
+            break;
+        case L3D_INSTANCE_POS3_UV2:
+            _enableVertexAttribute(iposAttrib, 3, GL_FLOAT, 5*sizeof(GLfloat), (void*)base, GL_FALSE, 1);
+            _enableVertexAttribute(itexAttrib, 2, GL_FLOAT, 5*sizeof(GLfloat), (void*)(base + 3*sizeof(GLfloat)), GL_FALSE, 1);
+            break;
+        case L3D_INSTANCE_TRANS4_TRANS4_TRANS4_TRANS4:
+            _enableVertexAttribute(itransAttrib + 0, 4, GL_FLOAT, 16*sizeof(GLfloat), (void*)base, GL_FALSE, 1);
+            _enableVertexAttribute(itransAttrib + 1, 4, GL_FLOAT, 16*sizeof(GLfloat), (void*)(base + 4*sizeof(GLfloat)), GL_FALSE, 1);
+            _enableVertexAttribute(itransAttrib + 2, 4, GL_FLOAT, 16*sizeof(GLfloat), (void*)(base + 8*sizeof(GLfloat)), GL_FALSE, 1);
+            _enableVertexAttribute(itransAttrib + 3, 4, GL_FLOAT, 16*sizeof(GLfloat), (void*)(base + 12*sizeof(GLfloat)), GL_FALSE, 1);
+            break;
+        case L3D_INSTANCE_TRANS4_TRANS4_TRANS4_TRANS4_UV2:
+            _enableVertexAttribute(itransAttrib + 0, 4, GL_FLOAT, 18*sizeof(GLfloat), (void*)base, GL_FALSE, 1);
+            _enableVertexAttribute(itransAttrib + 1, 4, GL_FLOAT, 18*sizeof(GLfloat), (void*)(base + 4*sizeof(GLfloat)), GL_FALSE, 1);
+            _enableVertexAttribute(itransAttrib + 2, 4, GL_FLOAT, 18*sizeof(GLfloat), (void*)(base + 8*sizeof(GLfloat)), GL_FALSE, 1);
+            _enableVertexAttribute(itransAttrib + 3, 4, GL_FLOAT, 18*sizeof(GLfloat), (void*)(base + 12*sizeof(GLfloat)), GL_FALSE, 1);
+            _enableVertexAttribute(itexAttrib, 2, GL_FLOAT, 18*sizeof(GLfloat), (void*)(base + 16*sizeof(GLfloat)), GL_FALSE, 1);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void L3DRenderer::updateMeshInstances(L3DMesh* mesh)
+{
+    if (!mesh || !mesh->id() || !mesh->instanceBuffer())
+        return;
+
+    this->bindVertexArray(mesh->glId());
+
+    // Disables attributes of previous instances, as format may differ.
+    if (mesh->material() && mesh->material()->shaderProgram())
+    {
+        L3DShaderProgram* shaderProgram = mesh->material()->shaderProgram();
+        L3DAttributeMap shaderAttributes = shaderProgram->attributes();
+
+        GLint iposAttrib   = glGetAttribLocation(shaderProgram->glId(), shaderAttributes[L3D_INSTANCE_POSITION].c_str());
+        GLint itexAttrib   = glGetAttribLocation(shaderProgram->glId(), shaderAttributes[L3D_INSTANCE_UV].c_str());
+        GLint itransAttrib = glGetAttribLocation(shaderProgram->glId(), shaderAttributes[L3D_INSTANCE_MATRIX].c_str());
+
+        if (iposAttrib >= 0)
+            glDisableVertexAttribArray(iposAttrib);
+        if (itexAttrib >= 0)
+            glDisableVertexAttribArray(itexAttrib);
+        if (itransAttrib >= 0)
+        {
+            for (unsigned int c = 0; c < 4; ++c)
+                glDisableVertexAttribArray(itransAttrib + c);
+        }
+    }
+
+    this->bindInstanceBuffer(mesh);
+    this->bindVertexArray(0);
+}
+
+unsigned int L3DRenderer::indirectVertexArray(L3DMesh* mesh)
+{
+    L3DBufferArenaPair arenas(mesh->vertexBuffer()->arena(), mesh->indexBuffer()->arena());
+    std::pair<unsigned int, L3DBufferArenaPair> key(mesh->vertexFormat(), arenas);
+    L3DVertexArrayPool::iterator it = m_indirectVertexArrays.find(key);
+
+    if (it != m_indirectVertexArrays.end())
+        return it->second;
+
+    // Arenas keep their names when growing, so VAO is set up only once.
+    GLuint vertexArray = 0;
+    glGenVertexArrays(1, &vertexArray);
+
+    this->bindVertexArray(vertexArray);
+
+    glBindBuffer(GL_ARRAY_BUFFER, arenas.first->buffer);
+    _enableVertexAttributes(mesh->vertexFormat(), _arenaAttributeLocations);
+
+    // Each instance reads its draw id, so that per-draw data can be found
+    // from base instance of draw commands.
+    glBindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer);
+    glEnableVertexAttribArray(_drawIdLocation);
+    glVertexAttribIPointer(_drawIdLocation, 1, GL_UNSIGNED_INT, sizeof(GLuint), 0);
+    glVertexAttribDivisor(_drawIdLocation, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arenas.second->buffer);
+
+    return m_indirectVertexArrays[key] = vertexArray;
+}
+
+void L3DRenderer::reserveDrawIds(unsigned int count)
+{
+    if (count <= m_drawIdCapacity)
+        return;
+
+    m_drawIdCapacity = glm::max(count, glm::max(m_drawIdCapacity * 2, 1024u));
+
+    std::vector<GLuint> drawIds(m_drawIdCapacity);
+    for (unsigned int i = 0; i < m_drawIdCapacity; ++i)
+        drawIds[i] = i;
+
+    // Buffer name doesn't change, so VAOs of arenas stay valid.
+    glBindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_drawIdCapacity * sizeof(GLuint), &drawIds[0], GL_STATIC_DRAW);
+}
+
+void L3DRenderer::updateDrawItems(unsigned int firstPacket, unsigned int lastPacket)
+{
+    m_drawItems.clear();
+    m_instanceStream.clear();
+    m_drawData.clear();
+    m_drawCommands.clear();
+
+    for (unsigned int i = firstPacket; i < lastPacket; ++i)
+    {
+        L3DMesh* mesh = m_drawPackets[i].mesh;
+        L3DShaderProgram* shaderProgram = mesh->material()->shaderProgram();
+
+        L3DDrawItem item;
+        item.mesh = mesh;
+        item.firstInstance = 0;
+        item.instanceCount = 0;
+        item.indirectVertexArray = 0;
+        item.drawCommand = 0;
+
+        bool drawsIndirect = shaderProgram->drawsIndirect();
+
+        // Indirect programs read geometry from arenas and matrices by draw
+        // id, which meshes with own instances or no indices don't have.
+        if (drawsIndirect && (mesh->instanceBuffer() || !mesh->vertexCount() || !mesh->indexCount()))
+        {
+            if (!mesh->m_indirectRejected)
+                fprintf(stderr, "Mesh %u can't be drawn by an indirect program, skipping it!\n", mesh->id());
+
+            mesh->m_indirectRejected = true;
+            continue;
+        }
+
+        // Meshes with their own instances are drawn as they are.
+        if (mesh->instanceBuffer() || (!drawsIndirect && shaderProgram->instanceMatrixLocation() < 0))
+        {
+            m_drawItems.push_back(item);
+            continue;
+        }
+
+        m_instancedMeshes.clear();
+        m_instancedMeshes.push_back(mesh);
+
+        // Packets are sorted by material and geometry, so instances are
+        // the meshes following this one.
+        for (; i + 1 < lastPacket; ++i)
+        {
+            L3DMesh* next = m_drawPackets[i+1].mesh;
+
+            if (next->material() != mesh->material()
+                || next->vertexBuffer() != mesh->vertexBuffer()
+                || next->indexBuffer() != mesh->indexBuffer()
+                || next->drawPrimitive() != mesh->drawPrimitive()
+                || next->instanceBuffer())
+                break;
+
+            m_instancedMeshes.push_back(next);
+        }
+
+        item.instanceCount = m_instancedMeshes.size();
+
+        if (drawsIndirect)
+        {
+            item.firstInstance = m_drawData.size();
+            item.indirectVertexArray = this->indirectVertexArray(mesh);
+            item.drawCommand = m_drawCommands.size();
+
+            for (std::vector<L3DMesh*>::iterator it = m_instancedMeshes.begin(); it != m_instancedMeshes.end(); ++it)
+            {
+                L3DDrawData data;
+                data.modelMat = (*it)->transMatrix;
+                data.normalMat = L3DMat4((*it)->normalMatrix());
+                m_drawData.push_back(data);
+            }
+
+            L3DDrawCommand command;
+            command.count = mesh->indexCount();
+            command.instanceCount = item.instanceCount;
+            command.firstIndex = mesh->indexBuffer()->offset();
+            command.baseVertex = mesh->vertexBuffer()->offset();
+            command.baseInstance = item.firstInstance;
+            m_drawCommands.push_back(command);
+        }
+        else
+        {
+            item.firstInstance = m_instanceStream.size();
+
+            for (std::vector<L3DMesh*>::iterator it = m_instancedMeshes.begin(); it != m_instancedMeshes.end(); ++it)
+                m_instanceStream.push_back((*it)->transMatrix);
+        }
+
+        m_drawItems.push_back(item);
+    }
+
+    // Uploads all instance matrices of the layer at once. Previous data is
+    // orphaned, so that draws of other layers are not stalled.
+    if (!m_instanceStream.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceStreamBuffer);
+        glBufferData(GL_ARRAY_BUFFER, m_instanceStream.size() * sizeof(L3DMat4), &m_instanceStream[0], GL_STREAM_DRAW);
+        L3D_COUNT(uploadedBytes, m_instanceStream.size() * sizeof(L3DMat4));
+    }
+
+    // Same for per-draw data and commands of indirect draws.
+    if (!m_drawCommands.empty())
+    {
+        this->reserveDrawIds(m_drawData.size());
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_drawData.size() * sizeof(L3DDrawData), &m_drawData[0], GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, _drawDataBinding, m_drawDataBuffer);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, m_drawCommands.size() * sizeof(L3DDrawCommand), &m_drawCommands[0], GL_STREAM_DRAW);
+        L3D_COUNT(uploadedBytes, m_drawData.size() * sizeof(L3DDrawData) + m_drawCommands.size() * sizeof(L3DDrawCommand));
+    }
+}
+
+void L3DRenderer::bindInstanceStream(int location, unsigned int firstInstance)
+{
+    // Points instance matrix attribute of bound VAO to first instance.
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceStreamBuffer);
+
+    for (unsigned int c = 0; c < 4; ++c)
+    {
+        _enableVertexAttribute(
+            location + c, 4, GL_FLOAT, sizeof(L3DMat4),
+            (void*)(firstInstance * sizeof(L3DMat4) + c * sizeof(L3DVec4)),
+            GL_FALSE, 1
+        );
+    }
+}
+
+void L3DRenderer::drawMeshes(
+    L3DCamera* camera,
+    unsigned int renderLayer
+)
+{
+    if (!camera || renderLayer >= L3D_MAX_RENDERLAYERS)
+        return;
+
+    L3DVec3 cameraPos = camera->position();
+    L3DMat4 vpMat = camera->proj * camera->view;
+
+    // Work of layer is counted on its own.
+    m_stats = &m_layerStats[renderLayer];
+
+    // Collects packets of layer, grouping the ones which can be instanced.
+    this->updateDrawItems(m_layerPackets[renderLayer], m_layerPackets[renderLayer + 1]);
+
+    L3DShaderProgram* boundShaderProgram = L3D_NULLPTR;
+    L3DMaterial* boundMaterial = L3D_NULLPTR;
+    L3DMesh* layoutMesh = L3D_NULLPTR;
+
+    // Iterate over draw items and render each one.
+    // Meshes in bucket are ordered by material, so program and material
+    // state is bound only at their boundaries.
+    for (std::vector<L3DDrawItem>::iterator it = m_drawItems.begin(); it != m_drawItems.end(); ++it)
+    {
+        L3DMesh* mesh = it->mesh;
+        L3DMaterial* material = mesh->material();
+        L3DShaderProgram* shaderProgram = material->shaderProgram();
+        GLenum gl_draw_primitive = _toOpenGL(mesh->drawPrimitive());
+        unsigned int index_count = mesh->indexCount();
+        unsigned int instance_count = mesh->instanceCount();
+
+        if (shaderProgram != boundShaderProgram)
+        {
+            // Binds shaders.
+            this->bindShaderProgram(shaderProgram->glId());
+
+            // Binds uniforms.
+            const L3DUniformList& uniforms = shaderProgram->uniformList();
+            for (L3DUniformList::const_iterator unif_it = uniforms.begin(); unif_it!=uniforms.end(); ++unif_it)
+                this->setUniform(shaderProgram, unif_it->first, unif_it->second);
+
+            // Binds camera, needed only by programs not using "L3DFrame" block.
+            this->setUniform(shaderProgram, L3D_UNIFORM_CAMERA_POS, cameraPos);
+            this->setUniform(shaderProgram, L3D_UNIFORM_VP_MAT, vpMat);
+            this->setUniform(shaderProgram, L3D_UNIFORM_VIEW_MAT, camera->view);
+            this->setUniform(shaderProgram, L3D_UNIFORM_PROJ_MAT, camera->proj);
+
+            // Binds lights.
+            this->bindLights(shaderProgram, renderLayer);
+
+            boundShaderProgram = shaderProgram;
+            boundMaterial = L3D_NULLPTR;
+        }
+
+        // Binds material.
+        if (material != boundMaterial)
+        {
+            this->bindMaterial(shaderProgram, material);
+            boundMaterial = material;
+        }
+
+        // Draws following items with same material and arenas at once.
+        if (it->indirectVertexArray)
+        {
+            std::vector<L3DDrawItem>::iterator last = it;
+
+            while (last + 1 != m_drawItems.end()
+                   && (last + 1)->indirectVertexArray == it->indirectVertexArray
+                   && (last + 1)->mesh->material() == material
+                   && (last + 1)->mesh->drawPrimitive() == mesh->drawPrimitive())
+                ++last;
+
+            this->bindVertexArray(it->indirectVertexArray);
+            layoutMesh = L3D_NULLPTR;
+
+            glMultiDrawElementsIndirect(
+                gl_draw_primitive,
+                GL_UNSIGNED_INT,
+                (void*)(it->drawCommand * sizeof(L3DDrawCommand)),
+                (last - it) + 1,
+                0
+            );
+
+#ifndef L3D_NO_FRAME_STATS
+            for (std::vector<L3DDrawItem>::iterator item = it; item != last + 1; ++item)
+            {
+                const L3DDrawCommand& command = m_drawCommands[item->drawCommand];
+                L3D_COUNT(triangles, _triangleCount(mesh->drawPrimitive(), command.count) * command.instanceCount);
+                L3D_COUNT(vertices, command.count * command.instanceCount);
+            }
+#endif
+            L3D_COUNT(drawCalls, 1);
+            L3D_COUNT(instancedDrawCalls, 1);
+
+            it = last;
+            continue;
+        }
+
+        // Binds VAO. Geometry is read from arenas at mesh offsets, so VAO
+        // of previous mesh is kept if it has same layout.
+        if (!layoutMesh || !_sharesVertexArray(layoutMesh, mesh))
+        {
+            this->bindVertexArray(mesh->glId());
+            layoutMesh = mesh;
+        }
+
+        unsigned int base_vertex = mesh->vertexBuffer() ? mesh->vertexBuffer()->offset() : 0;
+        unsigned int base_instance = 0;
+
+        // Own instances are always drawn by instanced calls, starting from
+        // their offset, which moves with ring regions and defragmentation.
+        // Without base instance support VAO follows it instead.
+        if (mesh->instanceBuffer())
+        {
+            if (!GLAD_GL_VERSION_4_2 && mesh->m_instanceOffset != mesh->instanceBuffer()->offset())
+                this->bindInstanceBuffer(mesh);
+
+            base_instance = mesh->instanceBuffer()->offset() - mesh->m_instanceOffset;
+        }
+
+        // Binds matrices.
+        if (it->instanceCount > 0)
+        {
+            // Model matrices are read from instance stream.
+            this->bindInstanceStream(shaderProgram->instanceMatrixLocation(), it->firstInstance);
+            this->setUniform(shaderProgram, L3D_UNIFORM_MODEL_MAT, L3DMat4());
+            this->setUniform(shaderProgram, L3D_UNIFORM_NORMAL_MAT, L3DMat3());
+            instance_count = it->instanceCount;
+        }
+        else
+        {
+            this->setUniform(shaderProgram, L3D_UNIFORM_MODEL_MAT, mesh->transMatrix);
+            this->setUniform(shaderProgram, L3D_UNIFORM_NORMAL_MAT, mesh->normalMatrix());
+        }
+
+        bool instanced = (instance_count > 1 || mesh->instanceBuffer());
+
+#ifndef L3D_NO_FRAME_STATS
+        unsigned int vertex_count = index_count > 0 ? index_count : mesh->vertexCount();
+        L3D_COUNT(drawCalls, 1);
+        L3D_COUNT(instancedDrawCalls, (instanced || base_instance > 0) ? 1 : 0);
+        L3D_COUNT(triangles, _triangleCount(mesh->drawPrimitive(), vertex_count) * instance_count);
+        L3D_COUNT(vertices, vertex_count * instance_count);
+#endif
+
+        // Renders geometry.
+        if (index_count > 0)
+        {
+            // Renders vertices using indices.
+            void* first_index = (void*)(mesh->indexBuffer()->offset() * sizeof(GLuint));
+
+            if (base_instance > 0)
+            {
+                glDrawElementsInstancedBaseVertexBaseInstance(gl_draw_primitive, index_count, GL_UNSIGNED_INT, first_index, instance_count, base_vertex, base_instance);
+            }
+            else if (instanced)
+            {
+                glDrawElementsInstancedBaseVertex(gl_draw_primitive, index_count, GL_UNSIGNED_INT, first_index, instance_count, base_vertex);
+            }
+            else
+            {
+                glDrawElementsBaseVertex(gl_draw_primitive, index_count, GL_UNSIGNED_INT, first_index, base_vertex);
+            }
+        }
+        else
+        {
+            // Renders vertices without using indices.
+            if (base_instance > 0)
+            {
+                glDrawArraysInstancedBaseInstance(gl_draw_primitive, base_vertex, mesh->vertexCount(), instance_count, base_instance);
+            }
+            else if (instanced)
             {
-                glDrawArraysInstanced(gl_draw_primitive, 0, mesh->vertexCount(), instance_count);
+                glDrawArraysInstanced(gl_draw_primitive, base_vertex, mesh->vertexCount(), instance_count);
             }
             else
             {
-                glDrawArrays(gl_draw_primitive, 0, mesh->vertexCount());
+                glDrawArrays(gl_draw_primitive, base_vertex, mesh->vertexCount());
             }
         }
     }
 
-    glBindVertexArray(0);
+    m_stats = &m_frameStats;
 }
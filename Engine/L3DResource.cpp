@@ -30,7 +30,8 @@ L3DResource::~L3DResource()
 }
 
 L3DResource::L3DResource(L3DRenderer* renderer)
-  : m_renderer(renderer)
+  : m_glId(0),
+    m_renderer(renderer)
 {
     m_handle.repr = 0;
 }
@@ -38,9 +39,9 @@ L3DResource::L3DResource(L3DRenderer* renderer)
 L3DResource::L3DResource(
     const L3DResourceType& type,
     L3DRenderer* renderer
-) : m_renderer(renderer)
+) : m_glId(0),
+    m_renderer(renderer)
 {
+    m_handle.repr = 0;
     m_handle.data.type = type;
-    m_handle.data.flags = 0;
-    m_handle.data.id = 0;
 }
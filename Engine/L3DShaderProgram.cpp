@@ -20,12 +20,60 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <sstream>
 #include <leaf3d/L3DRenderer.h>
 #include <leaf3d/L3DShader.h>
 #include <leaf3d/L3DShaderProgram.h>
 
 using namespace l3d;
 
+typedef std::map<std::string, unsigned int> L3DUniformIdMap;
+
+static const char* _builtinUniformNames[L3D_MAX_BUILTIN_UNIFORM] = {
+    "u_cameraPos",
+    "u_vpMat",
+    "u_viewMat",
+    "u_projMat",
+    "u_modelMat",
+    "u_normalMat",
+    "u_lightNr"
+};
+
+static const char* _lightUniformNames[L3D_MAX_LIGHT_UNIFORM] = {
+    "type",
+    "position",
+    "direction",
+    "color",
+    "kc",
+    "kl",
+    "kq"
+};
+
+static L3DUniformIdMap& _uniformIds()
+{
+    static L3DUniformIdMap ids;
+
+    // Reserve ids of built-in and light uniforms.
+    if (ids.empty())
+    {
+        for (unsigned int i = 0; i < L3D_MAX_BUILTIN_UNIFORM; ++i)
+            ids[_builtinUniformNames[i]] = i;
+
+        for (unsigned int l = 0; l < L3D_MAX_LIGHTS; ++l)
+        {
+            for (unsigned int f = 0; f < L3D_MAX_LIGHT_UNIFORM; ++f)
+            {
+                std::ostringstream sstream;
+                sstream << "u_light[" << l << "]." << _lightUniformNames[f];
+                ids[sstream.str()] = L3DShaderProgram::lightUniformId(l, (L3DLightUniform)f);
+            }
+        }
+    }
+
+    return ids;
+}
+
 L3DUniform::L3DUniform(float value)
 {
     this->value.valueF = value;
@@ -126,9 +174,12 @@ L3DShaderProgram::L3DShaderProgram(
     m_fragmentShader(fragmentShader),
     m_geometryShader(geometryShader),
     m_uniforms(uniforms),
-    m_attributes(attributes)
+    m_attributes(attributes),
+    m_instanceMatrixLocation(-1),
+    m_drawsIndirect(false)
 {
-    if (renderer) renderer->addShaderProgram(this);
+    for (L3DUniformMap::const_iterator it = m_uniforms.begin(); it != m_uniforms.end(); ++it)
+        m_uniformList.push_back(std::make_pair(L3DShaderProgram::uniformId(it->first), it->second));
 
     if (m_attributes.empty())
     {
@@ -143,16 +194,43 @@ L3DShaderProgram::L3DShaderProgram(
         m_attributes[L3D_INSTANCE_UV] = "i_instanceUv";
         m_attributes[L3D_INSTANCE_MATRIX] = "i_instanceMat";
     }
+
+    // Attribute names are needed by renderer to reflect the program.
+    if (renderer) renderer->addShaderProgram(this);
 }
 
 void L3DShaderProgram::setUniform(const char* name, const L3DUniform& value)
 {
     m_uniforms[name] = value;
+
+    unsigned int id = L3DShaderProgram::uniformId(name);
+
+    for (L3DUniformList::iterator it = m_uniformList.begin(); it != m_uniformList.end(); ++it)
+    {
+        if (it->first == id)
+        {
+            it->second = value;
+            return;
+        }
+    }
+
+    m_uniformList.push_back(std::make_pair(id, value));
 }
 
 void L3DShaderProgram::removeUniform(const char* name)
 {
     m_uniforms.erase(name);
+
+    unsigned int id = L3DShaderProgram::uniformId(name);
+
+    for (L3DUniformList::iterator it = m_uniformList.begin(); it != m_uniformList.end(); ++it)
+    {
+        if (it->first == id)
+        {
+            m_uniformList.erase(it);
+            return;
+        }
+    }
 }
 
 void L3DShaderProgram::addAttribute(int attribute, const char* name)
@@ -164,3 +242,52 @@ void L3DShaderProgram::removeAttribute(int attribute)
 {
     m_attributes.erase(attribute);
 }
+
+unsigned int L3DShaderProgram::activeUniformCount() const
+{
+    unsigned int count = 0;
+
+    for (std::vector<L3DUniformSlot>::const_iterator it = m_uniformSlots.begin(); it != m_uniformSlots.end(); ++it)
+        if (it->location > -1) ++count;
+
+    return count;
+}
+
+void L3DShaderProgram::setUniformLocation(unsigned int uniformId, int location)
+{
+    if (uniformId >= m_uniformSlots.size())
+        m_uniformSlots.resize(uniformId + 1);
+
+    m_uniformSlots[uniformId].location = location;
+    m_uniformSlots[uniformId].size = 0;
+}
+
+bool L3DShaderProgram::cacheUniformValue(unsigned int uniformId, const void* value, unsigned int size)
+{
+    if (uniformId >= m_uniformSlots.size() || size > sizeof(m_uniformSlots[uniformId].value))
+        return true;
+
+    L3DUniformSlot& slot = m_uniformSlots[uniformId];
+
+    if (slot.size == size && memcmp(slot.value, value, size) == 0)
+        return false;
+
+    memcpy(slot.value, value, size);
+    slot.size = size;
+
+    return true;
+}
+
+unsigned int L3DShaderProgram::uniformId(const std::string& name)
+{
+    L3DUniformIdMap& ids = _uniformIds();
+
+    L3DUniformIdMap::iterator it = ids.find(name);
+    if (it != ids.end())
+        return it->second;
+
+    unsigned int id = ids.size();
+    ids[name] = id;
+
+    return id;
+}
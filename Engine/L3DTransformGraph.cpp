@@ -0,0 +1,309 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <algorithm>
+#include <leaf3d/L3DTransformGraph.h>
+
+using namespace l3d;
+
+L3DTransformGraph::L3DTransformGraph()
+  : m_indices(1, -1),
+    m_dirtyCount(0),
+    m_changedCount(0),
+    m_sorted(true)
+{
+}
+
+unsigned int L3DTransformGraph::createNode(
+    const L3DMat4& localMatrix,
+    unsigned int parent
+)
+{
+    unsigned int node = 0;
+
+    if (!m_freeIds.empty())
+    {
+        node = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    else if (m_indices.size() <= L3D_MAX_TRANSFORM_NODES)
+    {
+        node = m_indices.size();
+        m_indices.push_back(-1);
+    }
+    else
+        return 0;
+
+    // Appended nodes always come after their parents.
+    int parentIndex = this->isValid(parent) ? m_indices[parent] : -1;
+
+    m_indices[node] = m_ids.size();
+    m_ids.push_back(node);
+    m_parents.push_back(parentIndex);
+    m_localMatrices.push_back(localMatrix);
+    m_worldMatrices.push_back(parentIndex >= 0 ? m_worldMatrices[parentIndex] * localMatrix : localMatrix);
+    m_dirty.push_back(1);
+    m_changed.push_back(0);
+    ++m_dirtyCount;
+
+    return node;
+}
+
+void L3DTransformGraph::destroyNode(unsigned int node)
+{
+    if (!this->isValid(node))
+        return;
+
+    int index = m_indices[node];
+    int parentIndex = m_parents[index];
+    unsigned int count = m_ids.size();
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (m_parents[i] == index)
+        {
+            m_localMatrices[i] = m_localMatrices[index] * m_localMatrices[i];
+            m_parents[i] = parentIndex;
+            this->invalidate(i);
+        }
+    }
+
+    if (m_dirty[index])
+        --m_dirtyCount;
+
+    if (m_changed[index])
+        --m_changedCount;
+
+    // Removal keeps order of remaining nodes, so they stay sorted.
+    m_ids.erase(m_ids.begin() + index);
+    m_parents.erase(m_parents.begin() + index);
+    m_localMatrices.erase(m_localMatrices.begin() + index);
+    m_worldMatrices.erase(m_worldMatrices.begin() + index);
+    m_dirty.erase(m_dirty.begin() + index);
+    m_changed.erase(m_changed.begin() + index);
+
+    for (unsigned int i = 0; i < count - 1; ++i)
+    {
+        if (m_parents[i] > index)
+            --m_parents[i];
+
+        m_indices[m_ids[i]] = i;
+    }
+
+    m_indices[node] = -1;
+    m_freeIds.push_back(node);
+}
+
+void L3DTransformGraph::clear()
+{
+    m_ids.clear();
+    m_parents.clear();
+    m_localMatrices.clear();
+    m_worldMatrices.clear();
+    m_dirty.clear();
+    m_changed.clear();
+    m_indices.assign(1, -1);
+    m_freeIds.clear();
+    m_dirtyCount = 0;
+    m_changedCount = 0;
+    m_sorted = true;
+}
+
+unsigned int L3DTransformGraph::parent(unsigned int node) const
+{
+    if (!this->isValid(node))
+        return 0;
+
+    int parentIndex = m_parents[m_indices[node]];
+
+    return parentIndex >= 0 ? m_ids[parentIndex] : 0;
+}
+
+bool L3DTransformGraph::setParent(unsigned int node, unsigned int parent)
+{
+    if (!this->isValid(node))
+        return false;
+
+    int index = m_indices[node];
+    int parentIndex = this->isValid(parent) ? m_indices[parent] : -1;
+
+    // Parent links are right even when nodes are not sorted.
+    for (int i = parentIndex; i >= 0; i = m_parents[i])
+    {
+        if (i == index)
+            return false;
+    }
+
+    if (m_parents[index] != parentIndex)
+    {
+        m_parents[index] = parentIndex;
+        this->invalidate(index);
+
+        if (parentIndex > index)
+            m_sorted = false;
+    }
+
+    return true;
+}
+
+void L3DTransformGraph::setLocalMatrix(unsigned int node, const L3DMat4& localMatrix)
+{
+    if (!this->isValid(node))
+        return;
+
+    int index = m_indices[node];
+    m_localMatrices[index] = localMatrix;
+    this->invalidate(index);
+}
+
+unsigned int L3DTransformGraph::update()
+{
+    if (!m_sorted)
+        this->sort();
+
+    if (!m_dirtyCount)
+    {
+        // Nothing moved, just forget changes of last update.
+        if (m_changedCount)
+        {
+            m_changed.assign(m_changed.size(), 0);
+            m_changedCount = 0;
+        }
+
+        return 0;
+    }
+
+    unsigned int count = m_ids.size();
+    unsigned int changedCount = 0;
+
+    // Parents are always visited first, so their changes reach the whole
+    // subtree in this same pass.
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        int parentIndex = m_parents[i];
+        bool changed = m_dirty[i] || (parentIndex >= 0 && m_changed[parentIndex]);
+
+        m_changed[i] = changed;
+
+        if (changed)
+        {
+            if (parentIndex >= 0)
+                m_worldMatrices[i] = m_worldMatrices[parentIndex] * m_localMatrices[i];
+            else
+                m_worldMatrices[i] = m_localMatrices[i];
+
+            m_dirty[i] = 0;
+            ++changedCount;
+        }
+    }
+
+    m_dirtyCount = 0;
+    m_changedCount = changedCount;
+
+    return changedCount;
+}
+
+void L3DTransformGraph::invalidate(int index)
+{
+    if (!m_dirty[index])
+    {
+        m_dirty[index] = 1;
+        ++m_dirtyCount;
+    }
+}
+
+void L3DTransformGraph::sort()
+{
+    unsigned int count = m_ids.size();
+
+    // Children lists, in current order.
+    std::vector<int> firstChildren(count, -1);
+    std::vector<int> nextSiblings(count, -1);
+
+    for (int i = count - 1; i >= 0; --i)
+    {
+        int parentIndex = m_parents[i];
+        if (parentIndex >= 0)
+        {
+            nextSiblings[i] = firstChildren[parentIndex];
+            firstChildren[parentIndex] = i;
+        }
+    }
+
+    // Depth-first order keeps subtrees contiguous.
+    std::vector<int> order;
+    std::vector<int> stack;
+    order.reserve(count);
+
+    for (unsigned int root = 0; root < count; ++root)
+    {
+        if (m_parents[root] >= 0)
+            continue;
+
+        stack.push_back(root);
+
+        while (!stack.empty())
+        {
+            int i = stack.back();
+            stack.pop_back();
+            order.push_back(i);
+
+            // Pushed in reverse, so that first child is visited first.
+            unsigned int firstChild = stack.size();
+            for (int child = firstChildren[i]; child >= 0; child = nextSiblings[child])
+                stack.push_back(child);
+            std::reverse(stack.begin() + firstChild, stack.end());
+        }
+    }
+
+    std::vector<int> newIndices(count);
+    for (unsigned int i = 0; i < count; ++i)
+        newIndices[order[i]] = i;
+
+    std::vector<unsigned int> ids(count);
+    std::vector<int> parents(count);
+    std::vector<L3DMat4> localMatrices(count);
+    std::vector<L3DMat4> worldMatrices(count);
+    std::vector<unsigned char> dirty(count);
+    std::vector<unsigned char> changed(count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        int oldIndex = order[i];
+        int parentIndex = m_parents[oldIndex];
+
+        ids[i] = m_ids[oldIndex];
+        parents[i] = parentIndex >= 0 ? newIndices[parentIndex] : -1;
+        localMatrices[i] = m_localMatrices[oldIndex];
+        worldMatrices[i] = m_worldMatrices[oldIndex];
+        dirty[i] = m_dirty[oldIndex];
+        changed[i] = m_changed[oldIndex];
+        m_indices[ids[i]] = i;
+    }
+
+    m_ids.swap(ids);
+    m_parents.swap(parents);
+    m_localMatrices.swap(localMatrices);
+    m_worldMatrices.swap(worldMatrices);
+    m_dirty.swap(dirty);
+    m_changed.swap(changed);
+    m_sorted = true;
+}
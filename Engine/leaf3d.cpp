@@ -23,6 +23,7 @@
 #include <sstream>
 #include <leaf3d/leaf3d.h>
 #include <leaf3d/L3DRenderer.h>
+#include <leaf3d/L3DBuffer.h>
 #include <leaf3d/L3DTexture.h>
 #include <leaf3d/L3DShader.h>
 #include <leaf3d/L3DShaderProgram.h>
@@ -32,6 +33,8 @@
 #include <leaf3d/L3DLight.h>
 #include <leaf3d/L3DMesh.h>
 #include <leaf3d/L3DRenderQueue.h>
+#include <leaf3d/L3DGeometry.h>
+#include <leaf3d/L3DGLBackend.h>
 
 using namespace l3d;
 
@@ -76,12 +79,48 @@ static const std::string _getUniformName(const char* name, int index)
     return _name;
 }
 
-int l3dInit()
+static unsigned int _copyMeshHandles(
+    const std::vector<L3DMesh*>& meshes,
+    L3DHandle* results,
+    unsigned int maxResults
+)
+{
+    if (results)
+    {
+        for (unsigned int i = 0; i < meshes.size() && i < maxResults; ++i)
+            results[i] = meshes[i]->handle();
+    }
+
+    return meshes.size();
+}
+
+static unsigned int _nodeId(const L3DHandle& handle)
+{
+    if (handle.data.type == L3D_TRANSFORM_NODE && _renderer->transformGraph().isValid(handle.data.id))
+        return handle.data.id;
+
+    return 0;
+}
+
+static L3DHandle _nodeHandle(unsigned int node)
+{
+    L3DHandle handle = L3D_INVALID_HANDLE;
+
+    if (node)
+    {
+        handle.data.type = L3D_TRANSFORM_NODE;
+        handle.data.id = node;
+    }
+
+    return handle;
+}
+
+int l3dInit(const L3DBackend& backend)
 {
     if (_renderer == L3D_NULLPTR)
     {
         _renderer = new L3DRenderer();
-        return _renderer->init();
+        return _renderer->init(backend);
     }
 
     return L3D_TRUE;
@@ -111,6 +150,102 @@ void l3dRenderFrame(
     );
 }
 
+unsigned int l3dGetSkippedCallCount()
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    return _renderer->skippedCallCount();
+}
+
+void l3dSetOcclusionCulling(bool enable)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    _renderer->setOcclusionCulling(enable);
+}
+
+unsigned int l3dGetOccludedMeshCount()
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    return _renderer->occlusionBuffer().occludedCount();
+}
+
+void l3dDefragmentBuffers()
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    _renderer->defragmentBuffers();
+}
+
+L3DBufferStats l3dGetBufferStats()
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    return _renderer->bufferStats();
+}
+
+L3DFrameStats l3dGetFrameStats()
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    return _renderer->frameStats();
+}
+
+L3DFrameStats l3dGetRenderLayerStats(unsigned char renderLayer)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    return _renderer->frameStats(renderLayer);
+}
+
+void l3dSetGpuTiming(bool enable)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    _renderer->setGpuTiming(enable);
+}
+
+unsigned int l3dGetGpuTimings(
+    L3DGpuTiming* timings,
+    unsigned int maxTimings
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    const std::vector<L3DGpuTiming>& gpuTimings = _renderer->gpuTimings();
+
+    if (timings)
+    {
+        for (unsigned int i = 0; i < gpuTimings.size() && i < maxTimings; ++i)
+            timings[i] = gpuTimings[i];
+    }
+
+    return gpuTimings.size();
+}
+
+unsigned int l3dGetGLCalls(
+    L3DGLCall* calls,
+    unsigned int maxCalls
+)
+{
+    // Log outlives renderer, so that calls of l3dTerminate() can be read.
+    const std::vector<L3DGLCall>& glCalls = L3DGLBackend::calls();
+
+    if (calls)
+    {
+        for (unsigned int i = 0; i < glCalls.size() && i < maxCalls; ++i)
+            calls[i] = glCalls[i];
+    }
+
+    return glCalls.size();
+}
+
+void l3dClearGLCalls()
+{
+    L3DGLBackend::clearCalls();
+}
+
 L3DHandle l3dLoadForwardRenderQueue(
     unsigned int width,
     unsigned int height,
@@ -169,7 +304,7 @@ L3DHandle l3dLoadForwardRenderQueue(
 
     // Assign diffuse texture of framebuffer
     // to diffuse texture of fullscreen quad material.
-    fsQuadMaterial->textures["diffuseMap"] = frameBufferColorTexture;
+    fsQuadMaterial->setTexture("diffuseMap", frameBufferColorTexture);
 
     GLfloat vertices[] = {
     //   Position      Texcoords
@@ -199,7 +334,8 @@ L3DHandle l3dLoadForwardRenderQueue(
     renderQueue->addSwitchFrameBufferCommand(backendBuffer);
     renderQueue->addClearBuffersCommand(true, true, true, clearColor);
     renderQueue->addSetBlendCommand(false);
-    renderQueue->addSetCullFaceCommand(true, L3D_BACK_FACE);
+    // Cube and skybox are not wound for culling.
+    renderQueue->addSetCullFaceCommand(false);
 
     // 2. Render meshes not writing on depth buffer of frame buffer.
     renderQueue->addSetDepthTestCommand(false);
@@ -212,7 +348,6 @@ L3DHandle l3dLoadForwardRenderQueue(
     renderQueue->addDrawMeshesCommand(L3D_OPAQUE_MESH_RENDERLAYER);
 
     // 4. Render meshes with alpha-blend.
-    renderQueue->addSetCullFaceCommand(false);
     renderQueue->addSetBlendCommand(true);
     renderQueue->addDrawMeshesCommand(L3D_ALPHA_BLEND_MESH_RENDERLAYER);
 
@@ -229,6 +364,65 @@ L3DHandle l3dLoadForwardRenderQueue(
     return L3D_INVALID_HANDLE;
 }
 
+void l3dJobsSetWorkerCount(unsigned int count)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    _renderer->jobs().setWorkerCount(count);
+}
+
+unsigned int l3dJobsGetWorkerCount()
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    return _renderer->jobs().workerCount();
+}
+
+void l3dJobsRun(
+    L3DJobFunction function,
+    void* data,
+    L3DJobCounter* counter
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    _renderer->jobs().run(function, data, counter);
+}
+
+void l3dJobsWait(L3DJobCounter* counter)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    _renderer->jobs().wait(counter);
+}
+
+void l3dJobsParallelFor(
+    unsigned int count,
+    unsigned int grainSize,
+    L3DParallelForFunction function,
+    void* data
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    _renderer->jobs().parallelFor(count, grainSize, function, data);
+}
+
+void l3dUpdateBuffer(
+    const L3DHandle& target,
+    const void* data,
+    unsigned int offset,
+    unsigned int size
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DBuffer* buffer = _renderer->getBuffer(target);
+
+    if (buffer && data && size)
+        buffer->update(data, offset, size);
+}
+
 L3DHandle l3dLoadTexture(
     const L3DTextureType& type,
     const L3DImageFormat& format,
@@ -593,7 +787,7 @@ void l3dAddTextureToMaterial(
 
     L3DMaterial* material = _renderer->getMaterial(target);
     if (material)
-        material->textures[name] = _renderer->getTexture(texture);
+        material->setTexture(name, _renderer->getTexture(texture));
 
     return;
 }
@@ -892,7 +1086,7 @@ L3DHandle l3dLoadSkyBox(
         22, 23, 20,
     };
 
-    return l3dLoadMesh(
+    L3DHandle skyBox = l3dLoadMesh(
         vertices, 24,
         indices, 36,
         material,
@@ -900,6 +1094,11 @@ L3DHandle l3dLoadSkyBox(
         L3DMat4(), L3D_DRAW_STATIC, L3D_DRAW_TRIANGLES,
         renderLayer
     );
+
+    // Sky box follows the camera, it must never be culled.
+    l3dSetMeshFlag(skyBox, L3D_MESH_CULLING, false);
+
+    return skyBox;
 }
 
 L3DHandle l3dLoadGrid(
@@ -909,58 +1108,13 @@ L3DHandle l3dLoadGrid(
     unsigned int renderLayer
 )
 {
-    unsigned int numVertices = (n + 1) * (n + 1);
-    unsigned int numIndices = 6 * n * n;
+    unsigned int numVertices = L3DGeometry::gridVertexCount(n);
+    unsigned int numIndices = L3DGeometry::gridIndexCount(n);
 
     GLfloat* vertices = (GLfloat*)malloc(numVertices * 11 * sizeof(GLfloat));
     GLuint* indices = (GLuint*)malloc(numIndices * sizeof(GLuint));
 
-    GLfloat k = 1.0f / n;
-
-    // Generate vertices.
-    unsigned int v = 0;
-    for (unsigned int y = 0; y <= n; ++y) {
-        GLfloat ky = k * y;
-
-        for (unsigned int x = 0; x <= n; ++x) {
-            GLfloat kx = k * x;
-
-            // Position.
-            vertices[v+0]  = kx - 0.5f;
-            vertices[v+1]  = ky - 0.5f;
-            vertices[v+2]  = 0.0f;
-            // Normal.
-            vertices[v+3]  = 0.0f;
-            vertices[v+4]  = 0.0f;
-            vertices[v+5]  = 1.0f;
-            // Tangent.
-            vertices[v+6]  = 1.0f;
-            vertices[v+7]  = 0.0f;
-            vertices[v+8]  = 0.0f;
-            // Texcoords.
-            vertices[v+9]  = texMulFactor.x * x;
-            vertices[v+10] = texMulFactor.y * y;
-
-            v += 11;
-        }
-    }
-
-    // Generate indices.
-    unsigned int q = 0;
-    for (unsigned int y = 0; y < n; ++y) {
-        for (unsigned int x = 0; x < n; ++x) {
-            // First triangle.
-            indices[q    ] = x + y * n + y;
-            indices[q + 1] = x + y * n + y + 1;
-            indices[q + 2] = x + (y + 1) * n + y + 1;
-            // Second triangle.
-            indices[q + 3] = x + (y + 1) * n + y + 1;
-            indices[q + 4] = x + (y + 1) * n + y + 2;
-            indices[q + 5] = x + y * n + y + 1;
-
-            q += 6;
-        }
-    }
+    L3DGeometry::grid(n, texMulFactor, vertices, indices);
 
     return l3dLoadMesh(
         vertices, numVertices,
@@ -972,6 +1126,42 @@ L3DHandle l3dLoadGrid(
     );
 }
 
+L3DHandle l3dCloneMesh(
+    const L3DHandle& target,
+    const L3DMat4& transMatrix
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* source = _renderer->getMesh(target);
+
+    if (!source || !source->vertexBuffer())
+        return L3D_INVALID_HANDLE;
+
+    // Clone shares geometry with source, so they can be instanced.
+    L3DMesh* mesh = new L3DMesh(
+        _renderer,
+        source->vertexBuffer(),
+        source->indexBuffer(),
+        source->material(),
+        source->vertexFormat(),
+        transMatrix,
+        source->vertexBuffer()->drawType(),
+        source->drawPrimitive(),
+        source->renderLayer()
+    );
+
+    if (mesh)
+    {
+        mesh->setFlag(L3D_MESH_CULLING, source->hasFlag(L3D_MESH_CULLING));
+        mesh->setFlag(L3D_MESH_OCCLUDER, source->hasFlag(L3D_MESH_OCCLUDER));
+
+        return mesh->handle();
+    }
+
+    return L3D_INVALID_HANDLE;
+}
+
 L3DMat4 l3dGetMeshTrans(
     const L3DHandle& target
 )
@@ -998,6 +1188,21 @@ unsigned char l3dMeshRenderLayer(const L3DHandle& target)
     return 0;
 }
 
+bool l3dMeshHasFlag(
+    const L3DHandle& target,
+    const L3DMeshFlag& flag
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* mesh = _renderer->getMesh(target);
+
+    if (mesh)
+        return mesh->hasFlag(flag);
+
+    return false;
+}
+
 void l3dSetMeshTrans(
     const L3DHandle& target,
     const L3DMat4& trans
@@ -1008,7 +1213,7 @@ void l3dSetMeshTrans(
     L3DMesh* mesh = _renderer->getMesh(target);
 
     if (mesh)
-        mesh->transMatrix = trans;
+        mesh->setTransMatrix(trans);
 }
 
 void l3dTranslateMesh(
@@ -1078,6 +1283,20 @@ void l3dSetMeshRenderLayer(
         mesh->setRenderLayer(renderLayer);
 }
 
+void l3dSetMeshFlag(
+    const L3DHandle& target,
+    const L3DMeshFlag& flag,
+    bool enable
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* mesh = _renderer->getMesh(target);
+
+    if (mesh)
+        mesh->setFlag(flag, enable);
+}
+
 void l3dSetMeshInstances(
   const L3DHandle& target,
   void* instances,
@@ -1093,6 +1312,261 @@ void l3dSetMeshInstances(
       mesh->setInstances(instances, instanceCount, instanceFormat);
 }
 
+void* l3dMapMeshInstances(
+    const L3DHandle& target,
+    unsigned int maxInstanceCount,
+    const L3DInstanceFormat& instanceFormat
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* mesh = _renderer->getMesh(target);
+
+    if (mesh)
+        return mesh->mapInstances(maxInstanceCount, instanceFormat);
+
+    return L3D_NULLPTR;
+}
+
+void l3dCommitMeshInstances(
+    const L3DHandle& target,
+    unsigned int instanceCount
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* mesh = _renderer->getMesh(target);
+
+    if (mesh)
+        mesh->commitInstances(instanceCount);
+}
+
+L3DHandle l3dGetMeshVertexBuffer(const L3DHandle& target)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* mesh = _renderer->getMesh(target);
+
+    if (mesh && mesh->vertexBuffer())
+        return mesh->vertexBuffer()->handle();
+
+    return L3D_INVALID_HANDLE;
+}
+
+L3DHandle l3dGetMeshIndexBuffer(const L3DHandle& target)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* mesh = _renderer->getMesh(target);
+
+    if (mesh && mesh->indexBuffer())
+        return mesh->indexBuffer()->handle();
+
+    return L3D_INVALID_HANDLE;
+}
+
+void l3dUpdateMeshVertices(
+    const L3DHandle& target,
+    const float* vertices,
+    unsigned int vertexCount,
+    unsigned int firstVertex
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* mesh = _renderer->getMesh(target);
+
+    if (mesh && vertices && vertexCount)
+        mesh->updateVertices(vertices, vertexCount, firstVertex);
+}
+
+unsigned int l3dQueryMeshesInAABB(
+    const L3DAABB& aabb,
+    L3DHandle* results,
+    unsigned int maxResults
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    std::vector<L3DMesh*> meshes;
+    _renderer->queryMeshes(aabb, meshes);
+
+    return _copyMeshHandles(meshes, results, maxResults);
+}
+
+unsigned int l3dQueryMeshesInSphere(
+    const L3DVec3& center,
+    float radius,
+    L3DHandle* results,
+    unsigned int maxResults
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    std::vector<L3DMesh*> meshes;
+    _renderer->queryMeshes(L3DBoundingSphere(center, radius), meshes);
+
+    return _copyMeshHandles(meshes, results, maxResults);
+}
+
+unsigned int l3dQueryMeshesOnRay(
+    const L3DVec3& origin,
+    const L3DVec3& direction,
+    float maxDistance,
+    L3DHandle* results,
+    unsigned int maxResults
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    std::vector<L3DMesh*> meshes;
+    _renderer->queryMeshes(origin, direction, maxDistance, meshes);
+
+    return _copyMeshHandles(meshes, results, maxResults);
+}
+
+L3DHandle l3dLoadNode(
+    const L3DMat4& transMatrix,
+    const L3DHandle& parent
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _renderer->transformGraph().createNode(transMatrix, _nodeId(parent));
+
+    return _nodeHandle(node);
+}
+
+L3DHandle l3dGetNodeParent(const L3DHandle& target)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _nodeId(target);
+
+    if (node)
+        return _nodeHandle(_renderer->transformGraph().parent(node));
+
+    return L3D_INVALID_HANDLE;
+}
+
+L3DMat4 l3dGetNodeTrans(const L3DHandle& target)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _nodeId(target);
+
+    if (node)
+        return _renderer->transformGraph().localMatrix(node);
+
+    return L3DMat4();
+}
+
+L3DMat4 l3dGetNodeWorldTrans(const L3DHandle& target)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _nodeId(target);
+
+    // World matrices are updated once per frame, brings them up to date.
+    if (node)
+    {
+        _renderer->updateMeshBounds();
+        return _renderer->transformGraph().worldMatrix(node);
+    }
+
+    return L3DMat4();
+}
+
+bool l3dSetNodeParent(
+    const L3DHandle& target,
+    const L3DHandle& parent
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _nodeId(target);
+
+    if (node)
+        return _renderer->transformGraph().setParent(node, _nodeId(parent));
+
+    return false;
+}
+
+void l3dSetNodeTrans(
+    const L3DHandle& target,
+    const L3DMat4& trans
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _nodeId(target);
+
+    if (node)
+        _renderer->transformGraph().setLocalMatrix(node, trans);
+}
+
+void l3dTranslateNode(
+    const L3DHandle& target,
+    const L3DVec3& movement
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _nodeId(target);
+
+    if (node)
+    {
+        L3DTransformGraph& graph = _renderer->transformGraph();
+        graph.setLocalMatrix(node, glm::translate(graph.localMatrix(node), movement));
+    }
+}
+
+void l3dRotateNode(
+    const L3DHandle& target,
+    float radians,
+    const L3DVec3& direction
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _nodeId(target);
+
+    if (node)
+    {
+        L3DTransformGraph& graph = _renderer->transformGraph();
+        graph.setLocalMatrix(node, glm::rotate(graph.localMatrix(node), radians, direction));
+    }
+}
+
+void l3dScaleNode(
+    const L3DHandle& target,
+    const L3DVec3& factor
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    unsigned int node = _nodeId(target);
+
+    if (node)
+    {
+        L3DTransformGraph& graph = _renderer->transformGraph();
+        graph.setLocalMatrix(node, glm::scale(graph.localMatrix(node), factor));
+    }
+}
+
+void l3dAttachMeshToNode(
+    const L3DHandle& mesh,
+    const L3DHandle& node
+)
+{
+    L3D_ASSERT(_renderer != L3D_NULLPTR);
+
+    L3DMesh* target = _renderer->getMesh(mesh);
+
+    if (target)
+        _renderer->attachMeshToNode(target, _nodeId(node));
+}
+
 L3DHandle l3dLoadDirectionalLight(
     const L3DVec3& direction,
     const L3DVec4& color,
@@ -0,0 +1,104 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DBVH_H
+#define L3D_L3DBVH_H
+#pragma once
+
+#include <vector>
+#include "leaf3d/types.h"
+
+#define L3D_BVH_NULL_NODE -1
+#define L3D_BVH_AABB_MARGIN 0.1f
+
+namespace l3d
+{
+    class L3DFrustum;
+
+    struct L3DBVHNode
+    {
+        // Leaves hold enlarged bounds, so that small moves need no update.
+        L3DAABB         aabb;
+        void*           userData;
+        int             parent;
+        int             child1;
+        int             child2;
+        int             height;
+
+        bool isLeaf() const { return this->child1 == L3D_BVH_NULL_NODE; }
+    };
+
+    // Dynamic bounding volume hierarchy: a binary tree of AABBs, kept
+    // balanced by rotations while leaves are inserted, moved and removed.
+    class L3DBVH
+    {
+    private:
+        std::vector<L3DBVHNode> m_nodes;
+        int                     m_root;
+        int                     m_freeList;
+        unsigned int            m_leafCount;
+
+    public:
+        L3DBVH();
+
+        // Add a leaf, return its proxy id.
+        int insert(const L3DAABB& aabb, void* userData);
+        void remove(int proxy);
+
+        // Update bounds of a leaf. Return true if leaf has been reinserted.
+        bool move(int proxy, const L3DAABB& aabb);
+
+        void clear();
+
+        void* userData(int proxy) const { return m_nodes[proxy].userData; }
+        const L3DAABB& fatBounds(int proxy) const { return m_nodes[proxy].aabb; }
+        unsigned int leafCount() const { return m_leafCount; }
+        int height() const { return (m_root == L3D_BVH_NULL_NODE) ? 0 : m_nodes[m_root].height; }
+
+        // Collect proxies whose enlarged bounds overlap the given volume.
+        void query(const L3DAABB& aabb, std::vector<int>& proxies) const;
+        void query(const L3DBoundingSphere& sphere, std::vector<int>& proxies) const;
+        void query(
+            const L3DVec3& origin,
+            const L3DVec3& direction,
+            float maxDistance,
+            std::vector<int>& proxies
+        ) const;
+
+        // Split proxies in the ones fully inside the frustum and the ones
+        // crossing it, which need a finer test.
+        void query(
+            const L3DFrustum& frustum,
+            std::vector<int>& inside,
+            std::vector<int>& intersecting
+        ) const;
+
+    protected:
+        int allocateNode();
+        void freeNode(int node);
+        void insertLeaf(int leaf);
+        void removeLeaf(int leaf);
+        int balance(int node);
+        void collectLeaves(int node, std::vector<int>& proxies) const;
+    };
+}
+
+#endif // L3D_L3DBVH_H
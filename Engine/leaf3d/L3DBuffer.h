@@ -24,10 +24,13 @@
 #pragma once
 
 #include "leaf3d/L3DResource.h"
+#include "leaf3d/L3DObjectPool.h"
 
 namespace l3d
 {
-    class L3DBuffer : public L3DResource
+    struct L3DBufferArena;
+
+    class L3DBuffer : public L3DResource, public L3DPooled<L3DBuffer>
     {
     private:
         L3DBufferType   m_type;
@@ -35,6 +38,11 @@ namespace l3d
         unsigned int    m_size;
         unsigned int    m_stride;
         L3DDrawType     m_drawType;
+        L3DBufferArena* m_arena;
+        int             m_block;
+        unsigned int    m_dirtyBegin;
+        unsigned int    m_dirtyEnd;
+        unsigned int    m_dirtyFrames;
 
     public:
         L3DBuffer(
@@ -56,6 +64,28 @@ namespace l3d
 
         template<typename T>
         T*              data() const { return static_cast<T*>(m_data); }
+
+        // Shared buffer holding this one, if uploaded.
+        L3DBufferArena* arena() const { return m_arena; }
+
+        // Index of first element in shared buffer.
+        unsigned int    offset() const;
+
+        // Copy size bytes of data at offset, they are uploaded by renderer
+        // before next frame.
+        void update(
+            const void* data,
+            unsigned int offset,
+            unsigned int size
+        );
+
+        // Mark a range as changed, after writing to data() directly.
+        void invalidate(
+            unsigned int offset,
+            unsigned int size
+        );
+
+        friend class L3DRenderer;
     };
 }
 
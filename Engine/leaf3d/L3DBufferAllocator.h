@@ -0,0 +1,118 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DBUFFERALLOCATOR_H
+#define L3D_L3DBUFFERALLOCATOR_H
+#pragma once
+
+#include <vector>
+
+#define L3D_INVALID_BLOCK -1
+
+// Two-level segregated fit: first level splits sizes by power of two,
+// second level splits each of them in 2^L3D_TLSF_SL_BITS linear classes.
+#define L3D_TLSF_SL_BITS 4
+#define L3D_TLSF_SL_COUNT (1 << L3D_TLSF_SL_BITS)
+#define L3D_TLSF_FL_COUNT (32 - L3D_TLSF_SL_BITS + 1)
+
+namespace l3d
+{
+    // Block moved by defragmentation, offsets and size are in units.
+    struct L3DBufferMove
+    {
+        int             block;
+        unsigned int    srcOffset;
+        unsigned int    dstOffset;
+        unsigned int    size;
+    };
+
+    // Sub-allocator of ranges inside a larger buffer. It only keeps track of
+    // offsets, in units chosen by the caller (usually buffer elements), and
+    // doesn't touch the memory itself, so it can manage GPU buffers.
+    // Allocation and release run in constant time.
+    class L3DBufferAllocator
+    {
+    private:
+        struct Block
+        {
+            unsigned int    offset;
+            unsigned int    size;
+            int             prevPhysical;
+            int             nextPhysical;
+            int             prevFree;
+            int             nextFree;
+            bool            isFree;
+            bool            isUsed;
+        };
+
+        std::vector<Block>  m_blocks;
+        std::vector<int>    m_unusedBlocks;
+        int                 m_freeLists[L3D_TLSF_FL_COUNT][L3D_TLSF_SL_COUNT];
+        unsigned int        m_flBitmap;
+        unsigned int        m_slBitmaps[L3D_TLSF_FL_COUNT];
+        int                 m_firstBlock;
+        int                 m_lastBlock;
+        unsigned int        m_capacity;
+        unsigned int        m_usedSize;
+        unsigned int        m_allocationCount;
+        unsigned int        m_freeBlockCount;
+
+    public:
+        L3DBufferAllocator(unsigned int capacity = 0);
+
+        // Return a block id, or L3D_INVALID_BLOCK if there is no room.
+        int allocate(unsigned int size);
+        void release(int block);
+
+        unsigned int offset(int block) const { return m_blocks[block].offset; }
+        unsigned int size(int block) const { return m_blocks[block].size; }
+
+        // Add free space at the end.
+        void grow(unsigned int capacity);
+
+        // Pack blocks at the start, keeping their order. Moved blocks are
+        // appended to moves, sorted by offset.
+        void defragment(std::vector<L3DBufferMove>& moves);
+
+        void clear();
+
+        // Statistics.
+        unsigned int capacity() const { return m_capacity; }
+        unsigned int usedSize() const { return m_usedSize; }
+        unsigned int freeSize() const { return m_capacity - m_usedSize; }
+        unsigned int allocationCount() const { return m_allocationCount; }
+        unsigned int freeBlockCount() const { return m_freeBlockCount; }
+        unsigned int largestFreeBlock() const;
+
+        // Share of free space not in the largest free block, 0 if free
+        // space is contiguous.
+        float fragmentation() const;
+
+    protected:
+        int createBlock(unsigned int offset, unsigned int size);
+        void destroyBlock(int block);
+        void insertFreeBlock(int block);
+        void removeFreeBlock(int block);
+        int findFreeBlock(unsigned int size) const;
+    };
+}
+
+#endif // L3D_L3DBUFFERALLOCATOR_H
@@ -0,0 +1,81 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DCOMMANDBUCKET_H
+#define L3D_L3DCOMMANDBUCKET_H
+#pragma once
+
+#include <vector>
+
+namespace l3d
+{
+    class L3DMesh;
+
+    // Draw of a mesh. Packets are submitted in key order, so key holds
+    // everything draws are sorted by.
+    struct L3DDrawPacket
+    {
+        unsigned long long  key;
+        L3DMesh*            mesh;
+    };
+
+    typedef std::vector<L3DDrawPacket> L3DDrawPacketList;
+
+    // Draw packets recorded by a single thread. Buckets don't share any
+    // state, so threads can fill them in parallel, then they are merged
+    // in key order by the thread submitting them.
+    class L3DCommandBucket
+    {
+    protected:
+        L3DDrawPacketList m_packets;
+
+    public:
+        unsigned int packetCount() const { return m_packets.size(); }
+        const L3DDrawPacketList& packets() const { return m_packets; }
+
+        void clear() { m_packets.clear(); }
+
+        void addPacket(unsigned long long key, L3DMesh* mesh)
+        {
+            L3DDrawPacket packet;
+            packet.key = key;
+            packet.mesh = mesh;
+            m_packets.push_back(packet);
+        }
+
+        // Collect packets of all buckets, sorted by key.
+        static void merge(
+            const L3DCommandBucket* buckets,
+            unsigned int bucketCount,
+            L3DDrawPacketList& packets,
+            L3DDrawPacketList& scratch
+        );
+
+        // Sort packets by key, keeping order of equal keys. Radix sort,
+        // it skips bytes which are equal in all keys.
+        static void sort(
+            L3DDrawPacketList& packets,
+            L3DDrawPacketList& scratch
+        );
+    };
+}
+
+#endif // L3D_L3DCOMMANDBUCKET_H
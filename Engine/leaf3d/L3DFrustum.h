@@ -0,0 +1,114 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DFRUSTUM_H
+#define L3D_L3DFRUSTUM_H
+#pragma once
+
+#include <vector>
+#include "leaf3d/types.h"
+
+namespace l3d
+{
+    // World bounds stored as structure of arrays, tested in batches.
+    // Each entry is an AABB (center and extents) and a sphere radius
+    // around the same center.
+    class L3DBoundsArray
+    {
+    public:
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> extentX;
+        std::vector<float> extentY;
+        std::vector<float> extentZ;
+        std::vector<float> radius;
+
+    public:
+        unsigned int size() const { return this->radius.size(); }
+
+        void clear();
+        void reserve(unsigned int count);
+        void add(
+            const L3DVec3& center,
+            const L3DVec3& extents,
+            float radius
+        );
+        void addInfinite();
+    };
+
+    class L3DFrustum
+    {
+    public:
+        enum L3DFrustumPlane
+        {
+            L3D_FRUSTUM_LEFT = 0,
+            L3D_FRUSTUM_RIGHT,
+            L3D_FRUSTUM_BOTTOM,
+            L3D_FRUSTUM_TOP,
+            L3D_FRUSTUM_NEAR,
+            L3D_FRUSTUM_FAR,
+            L3D_MAX_FRUSTUM_PLANES
+        };
+
+        enum L3DFrustumTest
+        {
+            L3D_FRUSTUM_OUTSIDE = 0,
+            L3D_FRUSTUM_INTERSECTING,
+            L3D_FRUSTUM_INSIDE
+        };
+
+    private:
+        // Normalized planes (xyz = normal pointing inside, w = distance).
+        L3DVec4 m_planes[L3D_MAX_FRUSTUM_PLANES];
+
+    public:
+        L3DFrustum();
+        L3DFrustum(const L3DMat4& vpMat);
+
+        const L3DVec4& plane(const L3DFrustumPlane& plane) const { return m_planes[plane]; }
+
+        // Extract planes from a view-projection matrix.
+        void update(const L3DMat4& vpMat);
+
+        bool intersects(const L3DAABB& aabb) const;
+        bool intersects(const L3DBoundingSphere& sphere) const;
+        L3DFrustumTest classify(const L3DAABB& aabb) const;
+
+        // Write 1 to visibility for each entry inside or crossing the frustum,
+        // 0 otherwise. Return count of visible entries.
+        unsigned int cull(
+            const L3DBoundsArray& bounds,
+            unsigned char* visibility
+        ) const;
+
+        // Same for count entries from first one, which can be culled
+        // concurrently with other ranges of same array.
+        unsigned int cull(
+            const L3DBoundsArray& bounds,
+            unsigned int first,
+            unsigned int count,
+            unsigned char* visibility
+        ) const;
+    };
+}
+
+#endif // L3D_L3DFRUSTUM_H
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DGLBACKEND_H
+#define L3D_L3DGLBACKEND_H
+#pragma once
+
+#include <vector>
+#include "leaf3d/types.h"
+
+namespace l3d
+{
+    // Selects what OpenGL entry points loaded by glad do. OpenGL backend
+    // loads them from current context. Null backend replaces them with
+    // functions doing no work: they hand out fake object names, report
+    // shaders as compiled and reflect uniforms and attributes from shader
+    // sources, so that the engine runs without any context and only its
+    // own CPU time is spent. Recording backend does the same and logs all
+    // calls. Fake backends report OpenGL 3.3.
+    //
+    // Entry points are global, so is the installed backend.
+    class L3DGLBackend
+    {
+    public:
+        static bool install(const L3DBackend& backend);
+        static void uninstall();
+
+        static L3DBackend backend();
+
+        // Calls logged by recording backend, kept until it's installed
+        // again or they are cleared.
+        static const std::vector<L3DGLCall>& calls();
+        static void clearCalls();
+    };
+}
+
+#endif // L3D_L3DGLBACKEND_H
@@ -0,0 +1,48 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DGEOMETRY_H
+#define L3D_L3DGEOMETRY_H
+#pragma once
+
+#include "leaf3d/types.h"
+
+namespace l3d
+{
+    // Vertices and indices of built-in shapes, written to arrays owned by
+    // caller. Vertices have L3D_VERTEX_POS3_NOR3_TAN3_UV2 format.
+    class L3DGeometry
+    {
+    public:
+        static unsigned int gridVertexCount(unsigned int n) { return (n + 1) * (n + 1); }
+        static unsigned int gridIndexCount(unsigned int n) { return 6 * n * n; }
+
+        // Unit square on XY plane, facing +Z, split in n x n quads.
+        static void grid(
+            unsigned int n,
+            const L3DVec2& texMulFactor,
+            float* vertices,
+            unsigned int* indices
+        );
+    };
+}
+
+#endif // L3D_L3DGEOMETRY_H
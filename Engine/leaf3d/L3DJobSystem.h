@@ -0,0 +1,120 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DJOBSYSTEM_H
+#define L3D_L3DJOBSYSTEM_H
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "leaf3d/types.h"
+
+namespace l3d
+{
+    // Count of unfinished jobs. A job can depend on others by waiting for
+    // their counter, which runs pending jobs in the meantime.
+    class L3DJobCounter
+    {
+        friend class L3DJobSystem;
+
+    private:
+        std::atomic<unsigned int> m_value;
+
+    public:
+        L3DJobCounter() : m_value(0) {}
+
+        unsigned int value() const { return m_value.load(std::memory_order_acquire); }
+        bool isDone() const { return this->value() == 0; }
+
+    private:
+        L3DJobCounter(const L3DJobCounter&);
+        L3DJobCounter& operator=(const L3DJobCounter&);
+    };
+
+    struct L3DJob
+    {
+        L3DJobFunction  function;
+        void*           data;
+        L3DJobCounter*  counter;
+    };
+
+    // Work-stealing scheduler. Each thread pushes and pops jobs at the back
+    // of its own deque, idle threads steal them from the front of others.
+    // Thread calling run() and wait() takes part as worker 0.
+    //
+    // Without workers jobs are run as soon as they are added, on calling
+    // thread, so results are the same as running them in order.
+    class L3DJobSystem
+    {
+    private:
+        struct Worker
+        {
+            std::mutex          mutex;
+            std::deque<L3DJob>  jobs;
+        };
+
+        std::vector<Worker*>        m_workers;
+        std::vector<std::thread>    m_threads;
+        std::atomic<bool>           m_running;
+        std::atomic<unsigned int>   m_pendingJobCount;
+        std::mutex                  m_sleepMutex;
+        std::condition_variable     m_wakeUp;
+
+    public:
+        L3DJobSystem(unsigned int workerCount = 0);
+        ~L3DJobSystem();
+
+        // Threads besides calling one. Must not change while jobs run.
+        unsigned int workerCount() const { return m_threads.size(); }
+        void setWorkerCount(unsigned int count);
+
+        // Worker count making use of all cores.
+        static unsigned int defaultWorkerCount();
+
+        void run(
+            L3DJobFunction function,
+            void* data,
+            L3DJobCounter* counter = 0
+        );
+        void wait(L3DJobCounter* counter);
+
+        // Call function over [0, count) in chunks of grainSize items. Chunks
+        // don't depend on worker count, so results can be deterministic.
+        void parallelFor(
+            unsigned int count,
+            unsigned int grainSize,
+            L3DParallelForFunction function,
+            void* data
+        );
+
+    private:
+        bool runPendingJob(unsigned int workerIndex);
+        void workerLoop(unsigned int workerIndex);
+        void startWorkers(unsigned int count);
+        void stopWorkers();
+    };
+}
+
+#endif // L3D_L3DJOBSYSTEM_H
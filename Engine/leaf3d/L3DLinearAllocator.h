@@ -0,0 +1,72 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DLINEARALLOCATOR_H
+#define L3D_L3DLINEARALLOCATOR_H
+#pragma once
+
+#include <vector>
+#include "leaf3d/types.h"
+
+namespace l3d
+{
+    // Arena for short lived data. Allocation only moves an offset forward
+    // and everything is released at once by reset(), so objects stored in
+    // it must not need destructors. Not thread safe.
+    class L3DLinearAllocator
+    {
+    private:
+        struct Block
+        {
+            unsigned char*  data;
+            unsigned int    size;
+        };
+
+        std::vector<Block>  m_blocks;
+        unsigned int        m_blockSize;
+        unsigned int        m_currentBlock;
+        unsigned int        m_offset;
+        unsigned int        m_usedSize;
+
+    public:
+        L3DLinearAllocator(unsigned int blockSize = 64 * 1024);
+        ~L3DLinearAllocator();
+
+        unsigned int    usedSize() const { return m_usedSize; }
+        unsigned int    capacity() const;
+
+        void*   allocate(unsigned int size, unsigned int alignment = 16);
+
+        template <typename T>
+        T*      allocate(unsigned int count) { return static_cast<T*>(this->allocate(count * sizeof(T))); }
+
+        void    reset();
+
+    protected:
+        void    clearBlocks();
+
+    private:
+        L3DLinearAllocator(const L3DLinearAllocator&);
+        L3DLinearAllocator& operator=(const L3DLinearAllocator&);
+    };
+}
+
+#endif // L3D_L3DLINEARALLOCATOR_H
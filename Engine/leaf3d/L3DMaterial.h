@@ -25,7 +25,9 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include "leaf3d/L3DResource.h"
+#include "leaf3d/L3DObjectPool.h"
 
 namespace l3d
 {
@@ -36,16 +38,33 @@ namespace l3d
     typedef std::map<std::string,float> L3DParameterRegistry;
     typedef std::map<std::string,L3DTexture*> L3DTextureRegistry;
 
-    class L3DMaterial : public L3DResource
+    // Registry entry resolved to uniform ids.
+    template <typename T>
+    struct L3DMaterialUniform
+    {
+        unsigned int    id;
+        unsigned int    flagId;
+        const T*        value;
+    };
+
+    typedef std::vector<L3DMaterialUniform<L3DVec3> >     L3DMaterialColorList;
+    typedef std::vector<L3DMaterialUniform<float> >       L3DMaterialParameterList;
+    typedef std::vector<L3DMaterialUniform<L3DTexture*> > L3DMaterialTextureList;
+
+    class L3DMaterial : public L3DResource, public L3DPooled<L3DMaterial>
     {
     private:
         const char* m_name;
         L3DShaderProgram* m_shaderProgram;
-
-    public:
-        L3DColorRegistry colors;
-        L3DParameterRegistry params;
-        L3DTextureRegistry textures;
+        L3DMaterialColorList m_colorUniforms;
+        L3DMaterialParameterList m_paramUniforms;
+        L3DMaterialTextureList m_textureUniforms;
+        bool m_uniformsDirty;
+        // Resolved uniforms point into registries, so they are only
+        // changed through setters.
+        L3DColorRegistry m_colors;
+        L3DParameterRegistry m_params;
+        L3DTextureRegistry m_textures;
 
     public:
         L3DMaterial(
@@ -60,6 +79,20 @@ namespace l3d
 
         const char* name() const { return m_name; }
         L3DShaderProgram* shaderProgram() const { return m_shaderProgram; }
+        const L3DColorRegistry& colors() const { return m_colors; }
+        const L3DParameterRegistry& params() const { return m_params; }
+        const L3DTextureRegistry& textures() const { return m_textures; }
+
+        void setColor(const char* name, const L3DVec3& color);
+        void setParam(const char* name, float param);
+        void setTexture(const char* name, L3DTexture* texture);
+
+        // Resolve registry names to uniform ids when needed.
+        void updateUniforms();
+
+        const L3DMaterialColorList& colorUniforms() const { return m_colorUniforms; }
+        const L3DMaterialParameterList& paramUniforms() const { return m_paramUniforms; }
+        const L3DMaterialTextureList& textureUniforms() const { return m_textureUniforms; }
 
         static L3DMaterial* createBlinnPhongMaterial(
             L3DRenderer* renderer,
@@ -0,0 +1,47 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DMATRIXBATCH_H
+#define L3D_L3DMATRIXBATCH_H
+#pragma once
+
+#include "leaf3d/types.h"
+
+namespace l3d
+{
+    // Matrix math over many matrices at once, run on 4 of them per step
+    // when SSE is available, or on 8 when built with AVX (L3D_ENABLE_AVX
+    // option, off by default). Matrices are referred through pointers, so
+    // they can be read from and written to their owners.
+    class L3DMatrixBatch
+    {
+    public:
+        // Inverse transpose of upper 3x3 part, which transforms normals.
+        static L3DMat3 normalMatrix(const L3DMat4& matrix);
+        static void normalMatrices(
+            const L3DMat4* const* matrices,
+            L3DMat3* const* normalMatrices,
+            unsigned int count
+        );
+    };
+}
+
+#endif // L3D_L3DMATRIXBATCH_H
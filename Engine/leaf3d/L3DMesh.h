@@ -24,13 +24,14 @@
 #pragma once
 
 #include "leaf3d/L3DResource.h"
+#include "leaf3d/L3DObjectPool.h"
 
 namespace l3d
 {
     class L3DBuffer;
     class L3DMaterial;
 
-    class L3DMesh : public L3DResource
+    class L3DMesh : public L3DResource, public L3DPooled<L3DMesh>
     {
     public:
         L3DMat4             transMatrix;
@@ -45,6 +46,23 @@ namespace l3d
         L3DDrawPrimitive    m_drawPrimitive;
         unsigned char       m_renderLayer;
         unsigned int        m_sortKey;
+        unsigned char       m_renderBucketLayer;
+        int                 m_renderBucketIndex;
+        L3DAABB             m_bounds;
+        float               m_boundingRadius;
+        L3DAABB             m_worldBounds;
+        float               m_worldRadius;
+        int                 m_bvhProxy;
+        bool                m_boundsDirty;
+        unsigned int        m_visibleFrame;
+        unsigned int        m_instanceOffset;
+        unsigned int        m_instanceCount;
+        bool                m_ownsInstanceBuffer;
+        bool                m_indirectRejected;
+        unsigned int        m_node;
+        int                 m_nodeMeshIndex;
+        L3DMat4             m_localMatrix;
+        L3DMat3             m_normalMatrix;
 
     public:
         L3DMesh(
@@ -83,14 +101,38 @@ namespace l3d
         unsigned char       renderLayer() const { return m_renderLayer; }
         unsigned int        sortKey() const { return m_sortKey; }
 
-        L3DMat3             normalMatrix() const;
+        // Bounds in model space.
+        const L3DAABB&      bounds() const { return m_bounds; }
+        L3DBoundingSphere   boundingSphere() const { return L3DBoundingSphere(m_bounds.center(), m_boundingRadius); }
+
+        // Bounds in world space, transformed by transMatrix.
+        L3DAABB             worldBounds() const;
+        L3DBoundingSphere   worldBoundingSphere() const;
+
+        // Transform node the mesh is attached to, 0 if none. Attached meshes
+        // are moved relative to their node, and transMatrix follows it.
+        unsigned int        node() const { return m_node; }
+        const L3DMat4&      localMatrix() const { return m_node ? m_localMatrix : transMatrix; }
+
+        // Cached along transMatrix, renderer refreshes it before frames.
+        const L3DMat3&      normalMatrix() const { return m_normalMatrix; }
         unsigned int        vertexCount() const;
         unsigned int        indexCount() const;
         unsigned int        instanceCount() const;
         unsigned int        primitiveCount() const;
 
         void recalculateTangents();
+        void updateBounds();
+
+        // Overwrite vertices from firstVertex, bounds follow them. Meshes
+        // sharing vertex buffer keep their bounds.
+        void updateVertices(
+            const float* vertices,
+            unsigned int vertexCount,
+            unsigned int firstVertex = 0
+        );
 
+        void setTransMatrix(const L3DMat4& transMatrix);
         void translate(const L3DVec3& movement);
         void rotate(
             float radians,
@@ -100,6 +142,7 @@ namespace l3d
 
         void setMaterial(L3DMaterial* material);
         void setRenderLayer(unsigned char renderLayer);
+        void setFlag(unsigned char flag, bool enable = true) { L3DResource::setFlag(flag, enable); }
         void setInstances(
             L3DBuffer* instanceBuffer,
             const L3DInstanceFormat& instanceFormat
@@ -110,8 +153,25 @@ namespace l3d
             const L3DInstanceFormat& instanceFormat
         );
 
+        // Return room for maxInstanceCount instances, to be filled and then
+        // committed. Instance buffer is kept while it is large enough, so
+        // streaming instances each frame doesn't reallocate it.
+        void* mapInstances(
+            unsigned int maxInstanceCount,
+            const L3DInstanceFormat& instanceFormat
+        );
+        void commitInstances(unsigned int instanceCount);
+
     protected:
         void updateSortKey();
+
+        // Notify renderer that world bounds and normal matrix must be updated.
+        void invalidateWorldBounds();
+
+        // Recompute transMatrix of attached mesh from its local matrix.
+        void updateTransMatrix();
+
+        friend class L3DRenderer;
     };
 }
 
@@ -0,0 +1,103 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DOBJECTPOOL_H
+#define L3D_L3DOBJECTPOOL_H
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include "leaf3d/types.h"
+
+namespace l3d
+{
+    // Allocator of fixed size blocks. Memory is reserved in chunks holding
+    // many blocks, released ones are kept in a free list and reused first,
+    // so allocation and release run in constant time and objects of the
+    // same kind lie close to each other. Not thread safe.
+    class L3DObjectPool
+    {
+    private:
+        unsigned int                m_blockSize;
+        unsigned int                m_chunkBlockCount;
+        std::vector<unsigned char*> m_chunks;
+        void*                       m_freeBlock;
+        unsigned int                m_blockCount;
+
+    public:
+        L3DObjectPool(unsigned int blockSize, unsigned int chunkBlockCount = 256);
+        ~L3DObjectPool();
+
+        unsigned int    blockSize() const { return m_blockSize; }
+        unsigned int    blockCount() const { return m_blockCount; }
+        unsigned int    capacity() const { return m_chunks.size() * m_chunkBlockCount; }
+
+        void*   allocate();
+        void    release(void* block);
+
+    protected:
+        bool    grow();
+
+    private:
+        L3DObjectPool(const L3DObjectPool&);
+        L3DObjectPool& operator=(const L3DObjectPool&);
+    };
+
+    // Base making objects of class T allocated from a pool shared by all of
+    // them. Derived classes of different size fall back to the heap.
+    template <typename T>
+    class L3DPooled
+    {
+    public:
+        static L3DObjectPool& objectPool()
+        {
+            static L3DObjectPool pool(sizeof(T));
+            return pool;
+        }
+
+        static void* operator new(std::size_t size)
+        {
+            if (size != sizeof(T))
+                return ::operator new(size);
+
+            void* block = objectPool().allocate();
+
+            if (!block)
+                throw std::bad_alloc();
+
+            return block;
+        }
+
+        static void operator delete(void* block, std::size_t size)
+        {
+            if (!block)
+                return;
+
+            if (size != sizeof(T))
+                ::operator delete(block);
+            else
+                objectPool().release(block);
+        }
+    };
+}
+
+#endif // L3D_L3DOBJECTPOOL_H
@@ -0,0 +1,101 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DOCCLUSIONBUFFER_H
+#define L3D_L3DOCCLUSIONBUFFER_H
+#pragma once
+
+#include <vector>
+#include "leaf3d/types.h"
+
+#define L3D_OCCLUSION_BUFFER_WIDTH 256
+#define L3D_OCCLUSION_BUFFER_HEIGHT 128
+
+namespace l3d
+{
+    // Low resolution depth buffer filled on CPU with occluder triangles.
+    // Depth is stored in [0, 1], 1 is the far plane. Each level of the
+    // hierarchy keeps the farthest depth of 2x2 texels of the one below,
+    // so bounds can be tested against a few texels only.
+    class L3DOcclusionBuffer
+    {
+    private:
+        unsigned int                    m_width;
+        unsigned int                    m_height;
+        L3DMat4                         m_vpMat;
+        std::vector<std::vector<float> > m_levels;
+        std::vector<unsigned int>       m_levelWidths;
+        std::vector<unsigned int>       m_levelHeights;
+        std::vector<L3DVec4>            m_clipVertices;
+        bool                            m_hierarchyDirty;
+        unsigned int                    m_occluderTriangleCount;
+        unsigned int                    m_testedCount;
+        unsigned int                    m_occludedCount;
+
+    public:
+        L3DOcclusionBuffer(
+            unsigned int width = L3D_OCCLUSION_BUFFER_WIDTH,
+            unsigned int height = L3D_OCCLUSION_BUFFER_HEIGHT
+        );
+
+        // Width is rounded up to a multiple of 8.
+        void resize(unsigned int width, unsigned int height);
+
+        unsigned int width() const { return m_width; }
+        unsigned int height() const { return m_height; }
+        unsigned int levelCount() const { return m_levels.size(); }
+        float depth(unsigned int x, unsigned int y, unsigned int level = 0) const;
+
+        // Reset depth and statistics for a new view.
+        void clear(const L3DMat4& vpMat);
+
+        // Draw indexed triangles. Vertices have position in first 3 floats,
+        // stride is in floats. Without indices, vertices are taken in order.
+        void rasterize(
+            const float* vertices,
+            unsigned int vertexCount,
+            unsigned int stride,
+            const unsigned int* indices,
+            unsigned int indexCount,
+            const L3DMat4& modelMat = L3DMat4()
+        );
+
+        // Rebuild hierarchy. It is done on demand by isOccluded().
+        void updateHierarchy();
+
+        // Return true if world bounds are hidden by rasterized occluders.
+        bool isOccluded(const L3DAABB& aabb);
+
+        // Statistics since last clear.
+        unsigned int occluderTriangleCount() const { return m_occluderTriangleCount; }
+        unsigned int testedCount() const { return m_testedCount; }
+        unsigned int occludedCount() const { return m_occludedCount; }
+
+    protected:
+        void rasterizeTriangle(
+            const L3DVec4& v0,
+            const L3DVec4& v1,
+            const L3DVec4& v2
+        );
+    };
+}
+
+#endif // L3D_L3DOCCLUSIONBUFFER_H
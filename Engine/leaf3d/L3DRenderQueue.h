@@ -23,150 +23,93 @@
 #define L3D_L3DRENDERQUEUE_H
 #pragma once
 
-#include <queue>
+#include <vector>
 #include "leaf3d/L3DResource.h"
 
 namespace l3d
 {
     class L3DFrameBuffer;
 
-    class L3DRenderCommand
+    // Commands are plain records, stored contiguously by render queues.
+    // Fields marked as resolved are filled by L3DRenderer when it compiles
+    // the queue.
+    struct L3DSwitchFrameBufferCommand
     {
-    protected:
-        L3DRenderCommandType m_type;
-
-    public:
-        L3DRenderCommandType type() const { return m_type; }
-
-    protected:
-        L3DRenderCommand() : m_type(L3D_INVALID_RENDER_COMMAND) {}
-        L3DRenderCommand(const L3DRenderCommandType& type) : m_type(type) {}
-    };
-
-    typedef std::vector<L3DRenderCommand*> L3DRenderCommandList;
-
-    class L3DSwitchFrameBufferCommand : public L3DRenderCommand
-    {
-    public:
-        L3DFrameBuffer* frameBuffer;
-
-    public:
-        L3DSwitchFrameBufferCommand(
-            L3DFrameBuffer* frameBuffer = 0
-        ) : L3DRenderCommand(L3D_SWITCH_FRAME_BUFFER),
-            frameBuffer(frameBuffer) {}
+        L3DHandle frameBuffer;
+        unsigned int frameBufferId; // Resolved.
     };
 
-    class L3DClearBuffersCommand : public L3DRenderCommand
+    struct L3DClearBuffersCommand
     {
-    public:
         bool colorBuffer;
         bool depthBuffer;
         bool stencilBuffer;
-        L3DVec4 clearColor;
-
-    public:
-        L3DClearBuffersCommand(
-            bool colorBuffer = true,
-            bool depthBuffer = true,
-            bool stencilBuffer = true,
-            const L3DVec4& clearColor = L3DVec4(1, 1, 1, 1)
-        ) : L3DRenderCommand(L3D_CLEAR_BUFFERS),
-            colorBuffer(colorBuffer),
-            depthBuffer(depthBuffer),
-            stencilBuffer(stencilBuffer),
-            clearColor(clearColor) {}
+        unsigned int clearMask; // Resolved.
+        float clearColor[4];
     };
 
-    class L3DSetDepthTestCommand : public L3DRenderCommand
+    struct L3DSetDepthTestCommand
     {
-    public:
         bool enable;
         L3DDepthFactor factor;
-
-    public:
-        L3DSetDepthTestCommand(
-            bool enable = true,
-            const L3DDepthFactor& factor = L3D_LESS
-        ) : L3DRenderCommand(L3D_SET_DEPTH_TEST),
-            enable(enable),
-            factor(factor) {}
     };
 
-    class L3DSetDepthMaskCommand : public L3DRenderCommand
+    struct L3DSetDepthMaskCommand
     {
-    public:
         bool enable;
-
-    public:
-        L3DSetDepthMaskCommand(
-            bool enable = true
-        ) : L3DRenderCommand(L3D_SET_DEPTH_MASK),
-            enable(enable) {}
     };
 
-    class L3DSetStencilTestCommand : public L3DRenderCommand
+    struct L3DSetStencilTestCommand
     {
-    public:
         bool enable;
-
-    public:
-        L3DSetStencilTestCommand(
-            bool enable = true
-        ) : L3DRenderCommand(L3D_SET_STENCIL_TEST),
-            enable(enable) {}
     };
 
-    class L3DSetBlendCommand : public L3DRenderCommand
+    struct L3DSetBlendCommand
     {
-    public:
         bool enable;
         L3DBlendFactor srcFactor;
         L3DBlendFactor dstFactor;
-
-    public:
-        L3DSetBlendCommand(
-            bool enable = true,
-            const L3DBlendFactor& srcFactor = L3D_SRC_ALPHA,
-            const L3DBlendFactor& dstFactor = L3D_ONE_MINUS_SRC_ALPHA
-        ) : L3DRenderCommand(L3D_SET_BLEND),
-            enable(enable),
-            srcFactor(srcFactor),
-            dstFactor(dstFactor) {}
     };
 
-    class L3DSetCullFaceCommand : public L3DRenderCommand
+    struct L3DSetCullFaceCommand
     {
-    public:
         bool enable;
         L3DCullFace cullFace;
-
-    public:
-        L3DSetCullFaceCommand(
-            bool enable = true,
-            const L3DCullFace& cullFace = L3D_BACK_FACE
-        ) : L3DRenderCommand(L3D_SET_BLEND),
-            enable(enable),
-            cullFace(cullFace) {}
     };
 
-    class L3DDrawMeshesCommand : public L3DRenderCommand
+    struct L3DDrawMeshesCommand
     {
-    public:
         unsigned char renderLayer;
+    };
 
-    public:
-        L3DDrawMeshesCommand(
-            unsigned char renderLayer = 0
-        ) : L3DRenderCommand(L3D_DRAW_MESHES),
-            renderLayer(renderLayer) {}
+    struct L3DRenderCommand
+    {
+        L3DRenderCommandType type;
+
+        union
+        {
+            L3DSwitchFrameBufferCommand switchFrameBuffer;
+            L3DClearBuffersCommand      clearBuffers;
+            L3DSetDepthTestCommand      setDepthTest;
+            L3DSetDepthMaskCommand      setDepthMask;
+            L3DSetStencilTestCommand    setStencilTest;
+            L3DSetBlendCommand          setBlend;
+            L3DSetCullFaceCommand       setCullFace;
+            L3DDrawMeshesCommand        drawMeshes;
+        };
     };
 
+    typedef std::vector<L3DRenderCommand> L3DRenderCommandList;
+
     class L3DRenderQueue : public L3DResource
     {
+        friend class L3DRenderer;
+
     protected:
         const char* m_name;
         L3DRenderCommandList m_commands;
+        L3DRenderCommandList m_compiledCommands;
+        bool m_compiled;
 
     public:
         L3DRenderQueue(
@@ -178,6 +121,14 @@ namespace l3d
         const char* name() const { return m_name; }
         unsigned int commandCount() const { return m_commands.size(); }
         const L3DRenderCommandList& commands() const { return m_commands; }
+        const L3DRenderCommandList& compiledCommands() const { return m_compiledCommands; }
+        bool isCompiled() const { return m_compiled; }
+
+        // Queue is compiled again before its next execution.
+        void invalidate() { m_compiled = false; }
+
+        // Remove all commands, keeping their storage for next ones.
+        void clear();
 
         void appendCommands(const L3DRenderCommandList& commands);
 
@@ -210,6 +161,9 @@ namespace l3d
             const L3DCullFace& cullFace = L3D_BACK_FACE
         );
         void addDrawMeshesCommand(unsigned char renderLayer = 0);
+
+    protected:
+        L3DRenderCommand& addCommand(const L3DRenderCommandType& type);
     };
 }
 
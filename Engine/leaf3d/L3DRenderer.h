@@ -24,7 +24,26 @@
 #pragma once
 
 #include <map>
+#include <vector>
 #include "leaf3d/types.h"
+#include "leaf3d/L3DFrustum.h"
+#include "leaf3d/L3DBVH.h"
+#include "leaf3d/L3DOcclusionBuffer.h"
+#include "leaf3d/L3DBufferAllocator.h"
+#include "leaf3d/L3DCommandBucket.h"
+#include "leaf3d/L3DJobSystem.h"
+#include "leaf3d/L3DTransformGraph.h"
+#include "leaf3d/L3DSlotMap.h"
+#include "leaf3d/L3DLinearAllocator.h"
+
+// Regions of dynamic buffers, written in turn by following frames.
+#define L3D_BUFFER_RING_SIZE 3
+
+// Nanoseconds waited for GPU to release a region of dynamic buffers.
+#define L3D_BUFFER_RING_TIMEOUT 1000000000ull
+
+// Frames rendered before reading back results of GPU timer queries.
+#define L3D_GPU_TIMER_FRAMES 4
 
 namespace l3d
 {
@@ -39,22 +58,143 @@ namespace l3d
     class L3DLight;
     class L3DMesh;
     class L3DRenderQueue;
+    class L3DUniform;
+    struct L3DRenderCommand;
+
+    typedef L3DSlotMap<L3DBuffer>           L3DBufferPool;
+    typedef L3DSlotMap<L3DTexture>          L3DTexturePool;
+    typedef L3DSlotMap<L3DShader>           L3DShaderPool;
+    typedef L3DSlotMap<L3DShaderProgram>    L3DShaderProgramPool;
+    typedef L3DSlotMap<L3DFrameBuffer>      L3DFrameBufferPool;
+    typedef L3DSlotMap<L3DMaterial>         L3DMaterialPool;
+    typedef L3DSlotMap<L3DCamera>           L3DCameraPool;
+    typedef L3DSlotMap<L3DLight>            L3DLightPool;
+    typedef L3DSlotMap<L3DMesh>             L3DMeshPool;
+    typedef L3DSlotMap<L3DRenderQueue>      L3DRenderQueuePool;
+
+    // Meshes of a render layer, in no order: meshes are swap-removed, and
+    // draw order comes from draw packets sorted each frame.
+    struct L3DRenderBucket
+    {
+        std::vector<L3DMesh*>   meshes;
+    };
+
+    // Shared OpenGL buffer. Buffers with same type, stride and draw type
+    // are ranges of it, so that meshes can be drawn without rebinding
+    // their buffers. Allocator works in elements of stride bytes.
+    //
+    // Dynamic arenas are persistently mapped, when supported, and hold
+    // L3D_BUFFER_RING_SIZE copies of their content. Each frame draws from
+    // next region, written by CPU once GPU is done with it. They can't
+    // grow, so more of them may share same key.
+    struct L3DBufferArena
+    {
+        unsigned int        buffer;
+        L3DBufferType       type;
+        L3DDrawType         drawType;
+        unsigned int        stride;
+        L3DBufferAllocator  allocator;
+        unsigned char*      mappedData;
+        unsigned int        regionCount;
+        unsigned int        region;
+        bool                orphaned;
+
+        L3DBufferArena()
+          : buffer(0), type(L3D_BUFFER_VERTEX), drawType(L3D_DRAW_STATIC), stride(0),
+            mappedData(L3D_NULLPTR), regionCount(1), region(0), orphaned(false) {}
+    };
+
+    typedef std::multimap<unsigned int, L3DBufferArena*> L3DBufferArenaPool;
+
+    // VAOs with fixed attribute locations, one per vertex format and
+    // arenas of vertices and indices, used by multi-draw indirect calls.
+    typedef std::pair<L3DBufferArena*, L3DBufferArena*> L3DBufferArenaPair;
+    typedef std::map<std::pair<unsigned int, L3DBufferArenaPair>, unsigned int> L3DVertexArrayPool;
+
+    // Per-draw data, laid out as std430 "L3DDraws" block.
+    struct L3DDrawData
+    {
+        L3DMat4         modelMat;
+        L3DMat4         normalMat;
+    };
+
+    // Same layout as DrawElementsIndirectCommand.
+    struct L3DDrawCommand
+    {
+        unsigned int    count;
+        unsigned int    instanceCount;
+        unsigned int    firstIndex;
+        int             baseVertex;
+        unsigned int    baseInstance;
+    };
+
+    // Draw call of a render layer. Meshes sharing geometry and material are
+    // drawn as instances of the first one, with model matrices read from
+    // the instance stream, or from per-draw data if drawn indirectly.
+    struct L3DDrawItem
+    {
+        L3DMesh*            mesh;
+        unsigned int        firstInstance;
+        unsigned int        instanceCount;
+        unsigned int        indirectVertexArray;
+        unsigned int        drawCommand;
+    };
+
+    // Per-frame uniforms, laid out as std140 "L3DFrame" block.
+    struct L3DFrameUniforms
+    {
+        L3DMat4 viewMat;
+        L3DMat4 projMat;
+        L3DMat4 vpMat;
+        L3DVec4 cameraPos;
+    };
+
+    // Timer queries issued during a frame.
+    struct L3DGpuTimerFrame
+    {
+        unsigned int    queries[L3D_MAX_GPU_TIMINGS];
+        L3DGpuTiming    timings[L3D_MAX_GPU_TIMINGS];
+        unsigned int    count;
+
+        L3DGpuTimerFrame() : count(0) {}
+    };
+
+    // Shadow copy of OpenGL state, used to skip redundant calls.
+    struct L3DRenderState
+    {
+        unsigned int    shaderProgram;
+        unsigned int    vertexArray;
+        unsigned int    frameBuffer;
+        unsigned int    activeTextureUnit;
+        unsigned int    textures[L3D_MAX_TEXTURE_UNITS][4];
+        unsigned int    depthTest;
+        unsigned int    depthFunc;
+        unsigned int    depthMask;
+        unsigned int    stencilTest;
+        unsigned int    blend;
+        unsigned int    blendSrcFactor;
+        unsigned int    blendDstFactor;
+        unsigned int    cullFace;
+        unsigned int    cullFaceMode;
+
+        // Calls skipped during current frame.
+        unsigned int    skippedCalls;
 
-    typedef std::map<unsigned int, L3DBuffer*>          L3DBufferPool;
-    typedef std::map<unsigned int, L3DTexture*>         L3DTexturePool;
-    typedef std::map<unsigned int, L3DShader*>          L3DShaderPool;
-    typedef std::map<unsigned int, L3DShaderProgram*>   L3DShaderProgramPool;
-    typedef std::map<unsigned int, L3DFrameBuffer*>     L3DFrameBufferPool;
-    typedef std::map<unsigned int, L3DMaterial*>        L3DMaterialPool;
-    typedef std::map<unsigned int, L3DCamera*>          L3DCameraPool;
-    typedef std::map<unsigned int, L3DLight*>           L3DLightPool;
-    typedef std::map<unsigned int, L3DMesh*>            L3DMeshPool;
-    typedef std::map<unsigned int, L3DRenderQueue*>     L3DRenderQueuePool;
+        L3DRenderState() : skippedCalls(0) { this->invalidate(); }
+
+        // Forget tracked values, next calls will always reach OpenGL.
+        void invalidate();
+    };
 
     class L3DRenderer
     {
     private:
         L3DBufferPool           m_buffers;
+        L3DBufferArenaPool      m_bufferArenas;
+        std::vector<L3DBuffer*> m_dirtyBuffers;
+        GLsync                  m_bufferRingFences[L3D_BUFFER_RING_SIZE];
+        unsigned int            m_bufferRingIndex;
+        bool                    m_bufferRing;
         L3DTexturePool          m_textures;
         L3DShaderPool           m_shaders;
         L3DShaderProgramPool    m_shaderPrograms;
@@ -64,13 +204,56 @@ namespace l3d
         L3DLightPool            m_lights;
         L3DMeshPool             m_meshes;
         L3DRenderQueuePool      m_renderQueues;
+        L3DRenderBucket         m_renderBuckets[L3D_MAX_RENDERLAYERS];
+        L3DRenderState          m_renderState;
+        unsigned int            m_skippedCalls;
+        unsigned int            m_frameUniformBuffer;
+        L3DFrustum              m_frustum;
+        L3DBoundsArray          m_cullBounds;
+        unsigned char*          m_visibility;
+        L3DBVH                  m_bvh;
+        std::vector<L3DMesh*>   m_dirtyMeshes;
+        L3DTransformGraph       m_transformGraph;
+        std::vector<L3DMesh*>   m_nodeMeshes;
+        std::vector<int>        m_insideProxies;
+        std::vector<int>        m_intersectingProxies;
+        unsigned int            m_frameIndex;
+        std::vector<L3DMesh*>   m_visibleMeshes;
+        L3DLinearAllocator      m_frameArena;
+        L3DOcclusionBuffer      m_occlusionBuffer;
+        bool                    m_occlusionCulling;
+        std::vector<L3DDrawItem> m_drawItems;
+        std::vector<L3DMat4>    m_instanceStream;
+        unsigned int            m_instanceStreamBuffer;
+        std::vector<L3DMesh*>   m_instancedMeshes;
+        L3DVertexArrayPool      m_indirectVertexArrays;
+        std::vector<L3DDrawData> m_drawData;
+        std::vector<L3DDrawCommand> m_drawCommands;
+        unsigned int            m_drawDataBuffer;
+        unsigned int            m_drawCommandBuffer;
+        unsigned int            m_drawIdBuffer;
+        unsigned int            m_drawIdCapacity;
+        L3DJobSystem            m_jobs;
+        unsigned int            m_recordedMeshCount;
+        std::vector<unsigned int> m_recordedLayers;
+        std::vector<L3DCommandBucket> m_commandBuckets;
+        L3DDrawPacketList       m_drawPackets;
+        L3DDrawPacketList       m_drawPacketScratch;
+        unsigned int            m_layerPackets[L3D_MAX_RENDERLAYERS + 1];
+        bool                    m_gpuTimers;
+        L3DGpuTimerFrame        m_gpuTimerFrames[L3D_GPU_TIMER_FRAMES];
+        unsigned int            m_gpuTimerFrame;
+        std::vector<L3DGpuTiming> m_gpuTimings;
+        L3DFrameStats           m_frameStats;
+        L3DFrameStats           m_layerStats[L3D_MAX_RENDERLAYERS];
+        L3DFrameStats*          m_stats;
 
     public:
         L3DRenderer();
         virtual ~L3DRenderer();
 
         // Init and clearing.
-        int init();
+        int init(const L3DBackend& backend = L3D_BACKEND_OPENGL);
         int terminate();
 
         // Rendering.
@@ -130,14 +313,139 @@ namespace l3d
         unsigned int    meshCount() const { return m_meshes.size(); }
         unsigned int    renderQueueCount() const { return m_renderQueues.size(); }
 
+        // Keep render buckets in sync with mesh render layer and material.
+        void updateRenderBucket(L3DMesh* mesh);
+
+        // Rebind instance attributes of mesh VAO to its current buffer.
+        void updateMeshInstances(L3DMesh* mesh);
+
+        // Keep mesh world bounds and hierarchy in sync with transforms.
+        void invalidateMeshBounds(L3DMesh* mesh);
+        void updateMeshBounds();
+
+        // Hierarchy of transform nodes, meshes attached to them follow
+        // their world matrices. Detach mesh if node is 0.
+        L3DTransformGraph& transformGraph() { return m_transformGraph; }
+        void attachMeshToNode(L3DMesh* mesh, unsigned int node);
+
+        // Scratch memory released at the start of next frame.
+        L3DLinearAllocator& frameArena() { return m_frameArena; }
+
+        // Find meshes by world bounds.
+        void queryMeshes(const L3DAABB& aabb, std::vector<L3DMesh*>& meshes);
+        void queryMeshes(const L3DBoundingSphere& sphere, std::vector<L3DMesh*>& meshes);
+        void queryMeshes(
+            const L3DVec3& origin,
+            const L3DVec3& direction,
+            float maxDistance,
+            std::vector<L3DMesh*>& meshes
+        );
+
+        // Return count of redundant OpenGL calls skipped in last frame.
+        unsigned int skippedCallCount() const { return m_skippedCalls; }
+
+        // Jobs preparing frames, free to be used between them too.
+        L3DJobSystem& jobs() { return m_jobs; }
+
+        // Hide meshes behind the ones flagged as occluders.
+        bool isOcclusionCullingOn() const { return m_occlusionCulling; }
+        void setOcclusionCulling(bool enable) { m_occlusionCulling = enable; }
+        const L3DOcclusionBuffer& occlusionBuffer() const { return m_occlusionBuffer; }
+
+        // Work submitted in last frame, in total and by render layer. Empty
+        // if built with L3D_NO_FRAME_STATS.
+        const L3DFrameStats& frameStats() const { return m_frameStats; }
+        const L3DFrameStats& frameStats(unsigned char renderLayer) const { return m_layerStats[renderLayer]; }
+
+        // Time passes of render queue on GPU, results are available some
+        // frames later. Needs OpenGL 3.3.
+        bool isGpuTimingOn() const { return m_gpuTimers; }
+        void setGpuTiming(bool enable);
+        const std::vector<L3DGpuTiming>& gpuTimings() const { return m_gpuTimings; }
+
+        // Upload changed buffer range before next frame.
+        void invalidateBuffer(L3DBuffer* buffer, unsigned int offset, unsigned int size);
+
+        // Pack buffers at the start of their arenas.
+        void defragmentBuffers();
+        L3DBufferStats bufferStats() const;
+
     protected:
+        // Give resource an id of its pool, fail if pool is full.
+        template <typename T>
+        bool addToPool(L3DSlotMap<T>& pool, T* resource)
+        {
+            unsigned int id = pool.add(resource);
+            if (id) resource->setId(id, pool.generation(id));
+            return id != 0;
+        }
+
+        void reflectUniforms(L3DShaderProgram* shaderProgram);
+        void compileRenderQueue(L3DRenderQueue* renderQueue);
+        void updateFrameUniforms(L3DCamera* camera);
+        void removeFromRenderBucket(L3DMesh* mesh);
+        void updateTransforms();
+        void cullMeshes();
+        static void cullMeshesJob(void* data, unsigned int first, unsigned int last);
+        static void updateMeshBoundsJob(void* data, unsigned int first, unsigned int last);
+        void occludeMeshes(const L3DMat4& vpMat);
+        void updateDrawItems(unsigned int firstPacket, unsigned int lastPacket);
+
+        // Draw packets are recorded into a bucket per job.
+        void recordDrawPackets(L3DRenderQueue* renderQueue);
+        static void recordMeshesJob(void* data, unsigned int first, unsigned int last);
+        void recordMeshes(
+            L3DCommandBucket* bucket,
+            unsigned int first,
+            unsigned int count
+        );
+        void bindInstanceStream(int location, unsigned int firstInstance);
+
+        // Timer queries and debug groups around passes.
+        void readGpuTimings();
+        bool beginGpuTiming(const L3DRenderCommand& command);
+        void endGpuTiming();
+
+        // Buffer arenas.
+        void allocateBuffer(L3DBuffer* buffer);
+        L3DBufferArena* createBufferArena(L3DBuffer* buffer);
+        void growBufferArena(L3DBufferArena* arena, unsigned int capacity);
+        void uploadBuffers();
+        void refillBufferArena(L3DBufferArena* arena);
+        void bindInstanceBuffer(L3DMesh* mesh);
+
+        // Multi-draw indirect support, needs OpenGL 4.3.
+        unsigned int indirectVertexArray(L3DMesh* mesh);
+        void reserveDrawIds(unsigned int count);
+
+        // Cached state changes.
+        void bindShaderProgram(unsigned int shaderProgram);
+        void bindVertexArray(unsigned int vertexArray);
+        void bindFrameBuffer(unsigned int frameBuffer);
+        void bindTexture(
+            unsigned int unit,
+            const L3DTextureType& type,
+            unsigned int texture
+        );
+        void setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DUniform& value);
+        void setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, int value);
+        void setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, float value);
+        void setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DVec3& value);
+        void setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DVec4& value);
+        void setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DMat3& value);
+        void setUniform(L3DShaderProgram* shaderProgram, unsigned int uniformId, const L3DMat4& value);
+        int uniformLocationToWrite(
+            L3DShaderProgram* shaderProgram,
+            unsigned int uniformId,
+            const void* value,
+            unsigned int size
+        );
+
         // Render actions.
-        void switchFrameBuffer(L3DFrameBuffer* frameBuffer = 0);
+        void switchFrameBuffer(unsigned int frameBufferId = 0);
         void clearBuffers(
-            bool colorBuffer = true,
-            bool depthBuffer = true,
-            bool stencilBuffer = true,
-            const L3DVec4& clearColor = L3DVec4(1, 1, 1, 1)
+            unsigned int clearMask,
+            const float* clearColor
         );
         void setDepthTest(
             bool enable = true,
@@ -154,6 +462,14 @@ namespace l3d
             bool enable = true,
             const L3DCullFace& cullFace = L3D_BACK_FACE
         );
+        void bindMaterial(
+            L3DShaderProgram* shaderProgram,
+            L3DMaterial* material
+        );
+        void bindLights(
+            L3DShaderProgram* shaderProgram,
+            unsigned int renderLayer
+        );
         void drawMeshes(
             L3DCamera* camera,
             unsigned int renderLayer = 0
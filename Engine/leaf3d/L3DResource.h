@@ -33,6 +33,7 @@ namespace l3d
     {
     private:
         L3DHandle       m_handle;
+        unsigned int    m_glId;
         L3DRenderer*    m_renderer;
 
     public:
@@ -40,7 +41,11 @@ namespace l3d
 
         L3DHandle           handle() const { return m_handle; }
         L3DResourceType     resourceType() const { return (L3DResourceType)m_handle.data.type; }
-        unsigned short int  id() const { return m_handle.data.id; }
+        unsigned int        id() const { return m_handle.data.id; }
+        unsigned short int  generation() const { return m_handle.data.generation; }
+
+        // Name of OpenGL object backing the resource, if any.
+        unsigned int        glId() const { return m_glId; }
         unsigned char       flags() const { return m_handle.data.flags; }
         bool                hasFlag(unsigned char bit) const { return L3D_TEST_BIT(m_handle.data.flags, bit); }
         L3DRenderer*        renderer() const { return m_renderer; }
@@ -52,9 +57,10 @@ namespace l3d
             L3DRenderer* renderer  = L3D_NULLPTR
         );
 
-        void setId(unsigned short int id) { m_handle.data.id = id; }
+        void setId(unsigned int id, unsigned short int generation = 0) { m_handle.data.id = id; m_handle.data.generation = generation; }
+        void setGlId(unsigned int glId) { m_glId = glId; }
         void setFlags(unsigned char flags) { m_handle.data.flags = flags; }
-        void setFlag(unsigned char flag, bool enable = true) { L3D_SET_BIT(m_handle.data.flags, flag, enable); }
+        void setFlag(unsigned char flag, bool enable = true) { m_handle.data.flags = L3D_SET_BIT(m_handle.data.flags, flag, enable); }
 
         friend class L3DRenderer;
     };
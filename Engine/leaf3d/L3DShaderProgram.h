@@ -25,6 +25,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include "leaf3d/L3DResource.h"
 
 namespace l3d
@@ -53,8 +54,45 @@ namespace l3d
     };
 
     typedef std::map<std::string,L3DUniform> L3DUniformMap;
+    typedef std::vector<std::pair<unsigned int,L3DUniform> > L3DUniformList;
     typedef std::map<int,std::string> L3DAttributeMap;
 
+    // Uniforms set by the renderer. Their ids are reserved in this order.
+    enum L3DBuiltinUniform
+    {
+        L3D_UNIFORM_CAMERA_POS = 0,
+        L3D_UNIFORM_VP_MAT,
+        L3D_UNIFORM_VIEW_MAT,
+        L3D_UNIFORM_PROJ_MAT,
+        L3D_UNIFORM_MODEL_MAT,
+        L3D_UNIFORM_NORMAL_MAT,
+        L3D_UNIFORM_LIGHT_NR,
+        L3D_MAX_BUILTIN_UNIFORM
+    };
+
+    // Fields of each "u_light[i]" uniform.
+    enum L3DLightUniform
+    {
+        L3D_LIGHT_UNIFORM_TYPE = 0,
+        L3D_LIGHT_UNIFORM_POSITION,
+        L3D_LIGHT_UNIFORM_DIRECTION,
+        L3D_LIGHT_UNIFORM_COLOR,
+        L3D_LIGHT_UNIFORM_KC,
+        L3D_LIGHT_UNIFORM_KL,
+        L3D_LIGHT_UNIFORM_KQ,
+        L3D_MAX_LIGHT_UNIFORM
+    };
+
+    // Location of an active uniform and last value written to it.
+    struct L3DUniformSlot
+    {
+        int             location;
+        unsigned int    size;
+        unsigned int    value[16];
+
+        L3DUniformSlot() : location(-1), size(0) {}
+    };
+
     class L3DShaderProgram : public L3DResource
     {
     protected:
@@ -62,7 +100,11 @@ namespace l3d
         L3DShader*      m_fragmentShader;
         L3DShader*      m_geometryShader;
         L3DUniformMap   m_uniforms;
+        L3DUniformList  m_uniformList;
         L3DAttributeMap m_attributes;
+        std::vector<L3DUniformSlot> m_uniformSlots;
+        int             m_instanceMatrixLocation;
+        bool            m_drawsIndirect;
 
     public:
         L3DShaderProgram(
@@ -79,6 +121,7 @@ namespace l3d
         L3DShader* fragmentShader() const { return m_fragmentShader; }
         L3DShader* geometryShader() const { return m_geometryShader; }
         L3DUniformMap uniforms() const { return m_uniforms; }
+        const L3DUniformList& uniformList() const { return m_uniformList; }
         unsigned int uniformCount() const { return m_uniforms.size(); }
         L3DAttributeMap attributes() const { return m_attributes; }
         unsigned int attributeCount() const { return m_attributes.size(); }
@@ -88,6 +131,33 @@ namespace l3d
 
         void addAttribute(int attribute, const char* name);
         void removeAttribute(int attribute);
+
+        // Location of active uniforms, filled by the renderer at link time.
+        int uniformLocation(unsigned int uniformId) const
+        {
+            return (uniformId < m_uniformSlots.size()) ? m_uniformSlots[uniformId].location : -1;
+        }
+        unsigned int activeUniformCount() const;
+        void setUniformLocation(unsigned int uniformId, int location);
+        void clearUniformLocations() { m_uniformSlots.clear(); }
+
+        // Location of instance matrix attribute, -1 if program doesn't use it.
+        int instanceMatrixLocation() const { return m_instanceMatrixLocation; }
+        void setInstanceMatrixLocation(int location) { m_instanceMatrixLocation = location; }
+
+        // True if program reads model matrices from "L3DDraws" block.
+        bool drawsIndirect() const { return m_drawsIndirect; }
+        void setDrawsIndirect(bool enable) { m_drawsIndirect = enable; }
+
+        // Store value of an active uniform, return false if it is unchanged.
+        bool cacheUniformValue(unsigned int uniformId, const void* value, unsigned int size);
+
+        // Map uniform names to compact ids shared by all programs.
+        static unsigned int uniformId(const std::string& name);
+        static unsigned int lightUniformId(unsigned int light, const L3DLightUniform& field)
+        {
+            return L3D_MAX_BUILTIN_UNIFORM + light * L3D_MAX_LIGHT_UNIFORM + field;
+        }
     };
 }
 
@@ -0,0 +1,157 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DSLOTMAP_H
+#define L3D_L3DSLOTMAP_H
+#pragma once
+
+#include <vector>
+#include "leaf3d/types.h"
+
+namespace l3d
+{
+    // Items addressed by handle ids, kept in a dense array so they can be
+    // walked without gaps. Removal moves last item in place of removed one.
+    //
+    // Each id has a generation, increased when its item is removed, so
+    // that handles of removed items are detected even after their id has
+    // been given to a new item. Id 0 is never used.
+    template <typename T>
+    class L3DSlotMap
+    {
+    public:
+        typedef typename std::vector<T*>::iterator          iterator;
+        typedef typename std::vector<T*>::const_iterator    const_iterator;
+
+    private:
+        // Index of item if used, next free id otherwise.
+        struct L3DSlot
+        {
+            unsigned int        index;
+            unsigned short int  generation;
+            bool                used;
+        };
+
+        std::vector<T*>             m_items;
+        std::vector<unsigned int>   m_ids;
+        std::vector<L3DSlot>        m_slots;
+        unsigned int                m_freeId;
+
+    public:
+        L3DSlotMap() : m_slots(1), m_freeId(0) {}
+
+        unsigned int size() const { return m_items.size(); }
+        bool empty() const { return m_items.empty(); }
+
+        T* operator[](unsigned int index) const { return m_items[index]; }
+        T* back() const { return m_items.back(); }
+
+        iterator begin() { return m_items.begin(); }
+        iterator end() { return m_items.end(); }
+        const_iterator begin() const { return m_items.begin(); }
+        const_iterator end() const { return m_items.end(); }
+
+        // Return id given to item, 0 if all ids are taken.
+        unsigned int add(T* item)
+        {
+            unsigned int id = m_freeId;
+
+            if (id)
+            {
+                m_freeId = m_slots[id].index;
+            }
+            else if (m_slots.size() <= L3D_MAX_HANDLE_ID)
+            {
+                id = m_slots.size();
+
+                L3DSlot slot;
+                slot.generation = 1;
+                m_slots.push_back(slot);
+            }
+            else
+                return 0;
+
+            L3DSlot& slot = m_slots[id];
+            slot.index = m_items.size();
+            slot.used = true;
+
+            m_items.push_back(item);
+            m_ids.push_back(id);
+
+            return id;
+        }
+
+        void remove(unsigned int id)
+        {
+            if (id == 0 || id >= m_slots.size() || !m_slots[id].used)
+                return;
+
+            L3DSlot& slot = m_slots[id];
+            unsigned int last = m_items.size() - 1;
+
+            m_items[slot.index] = m_items[last];
+            m_ids[slot.index] = m_ids[last];
+            m_slots[m_ids[last]].index = slot.index;
+            m_items.pop_back();
+            m_ids.pop_back();
+
+            // Generation 0 is left to handles never given out.
+            if (++slot.generation == 0)
+                slot.generation = 1;
+
+            slot.used = false;
+            slot.index = m_freeId;
+            m_freeId = id;
+        }
+
+        // Removed ids keep their generations, so old handles stay stale.
+        void clear()
+        {
+            while (!m_ids.empty())
+                this->remove(m_ids.back());
+        }
+
+        unsigned short int generation(unsigned int id) const
+        {
+            return id < m_slots.size() ? m_slots[id].generation : 0;
+        }
+
+        T* get(unsigned int id, unsigned short int generation) const
+        {
+            if (id == 0 || id >= m_slots.size())
+                return L3D_NULLPTR;
+
+            const L3DSlot& slot = m_slots[id];
+
+            if (!slot.used || slot.generation != generation)
+                return L3D_NULLPTR;
+
+            return m_items[slot.index];
+        }
+
+        T* get(const L3DHandle& handle) const
+        {
+            return this->get(handle.data.id, handle.data.generation);
+        }
+    };
+}
+
+#endif // L3D_L3DSLOTMAP_H
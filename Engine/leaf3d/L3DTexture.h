@@ -24,10 +24,11 @@
 #pragma once
 
 #include "leaf3d/L3DResource.h"
+#include "leaf3d/L3DObjectPool.h"
 
 namespace l3d
 {
-    class L3DTexture : public L3DResource
+    class L3DTexture : public L3DResource, public L3DPooled<L3DTexture>
     {
     protected:
         L3DTextureType      m_type;
@@ -0,0 +1,96 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#ifndef L3D_L3DTRANSFORMGRAPH_H
+#define L3D_L3DTRANSFORMGRAPH_H
+#pragma once
+
+#include <vector>
+#include "leaf3d/types.h"
+
+// Ids must fit in a handle.
+#define L3D_MAX_TRANSFORM_NODES L3D_MAX_HANDLE_ID
+
+namespace l3d
+{
+    // Hierarchy of transforms, each node world matrix being its parent one
+    // times its local matrix. Nodes are stored as parallel arrays, sorted
+    // so that parents come before their children: world matrices are
+    // updated in a single linear pass, which only visits subtrees whose
+    // transforms changed since last update.
+    //
+    // Nodes are referred by ids, 0 being no node, as their indices change
+    // when the hierarchy does.
+    class L3DTransformGraph
+    {
+    private:
+        std::vector<unsigned int>   m_ids;
+        std::vector<int>            m_parents;
+        std::vector<L3DMat4>        m_localMatrices;
+        std::vector<L3DMat4>        m_worldMatrices;
+        std::vector<unsigned char>  m_dirty;
+        std::vector<unsigned char>  m_changed;
+        std::vector<int>            m_indices;
+        std::vector<unsigned int>   m_freeIds;
+        unsigned int                m_dirtyCount;
+        unsigned int                m_changedCount;
+        bool                        m_sorted;
+
+    public:
+        L3DTransformGraph();
+
+        unsigned int nodeCount() const { return m_ids.size(); }
+        bool isValid(unsigned int node) const { return node < m_indices.size() && m_indices[node] >= 0; }
+
+        // Return id of new node, or 0 if there is no room for it.
+        unsigned int createNode(
+            const L3DMat4& localMatrix = L3DMat4(),
+            unsigned int parent = 0
+        );
+
+        // Children of removed node are moved to its parent, keeping their
+        // world matrices.
+        void destroyNode(unsigned int node);
+        void clear();
+
+        unsigned int parent(unsigned int node) const;
+
+        // Fail if parent is a descendant of node.
+        bool setParent(unsigned int node, unsigned int parent);
+
+        const L3DMat4& localMatrix(unsigned int node) const { return m_localMatrices[m_indices[node]]; }
+        void setLocalMatrix(unsigned int node, const L3DMat4& localMatrix);
+
+        // World matrix as of last update.
+        const L3DMat4& worldMatrix(unsigned int node) const { return m_worldMatrices[m_indices[node]]; }
+
+        // Recompute world matrices of changed subtrees, return count of
+        // nodes whose world matrix changed.
+        unsigned int update();
+        bool hasChanged(unsigned int node) const { return m_changed[m_indices[node]] != 0; }
+
+    protected:
+        void invalidate(int index);
+        void sort();
+    };
+}
+
+#endif // L3D_L3DTRANSFORMGRAPH_H
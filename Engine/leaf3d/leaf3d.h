@@ -24,12 +24,13 @@
 #pragma once
 
 #include "leaf3d/types.h"
+#include "leaf3d/L3DJobSystem.h"
 
 using namespace l3d;
 
 /* Init & terminate ***********************************************************/
 
-L3D_API int l3dInit();
+L3D_API int l3dInit(const L3DBackend& backend = L3D_BACKEND_OPENGL);
 
 L3D_API int l3dTerminate();
 
@@ -40,6 +41,34 @@ L3D_API void l3dRenderFrame(
     const L3DHandle& renderQueue
 );
 
+L3D_API unsigned int l3dGetSkippedCallCount();
+
+L3D_API void l3dSetOcclusionCulling(bool enable);
+
+L3D_API unsigned int l3dGetOccludedMeshCount();
+
+L3D_API void l3dDefragmentBuffers();
+
+L3D_API L3DBufferStats l3dGetBufferStats();
+
+L3D_API L3DFrameStats l3dGetFrameStats();
+
+L3D_API L3DFrameStats l3dGetRenderLayerStats(unsigned char renderLayer);
+
+L3D_API void l3dSetGpuTiming(bool enable);
+
+L3D_API unsigned int l3dGetGpuTimings(
+    L3DGpuTiming* timings,
+    unsigned int maxTimings
+);
+
+L3D_API unsigned int l3dGetGLCalls(
+    L3DGLCall* calls,
+    unsigned int maxCalls
+);
+
+L3D_API void l3dClearGLCalls();
+
 L3D_API L3DHandle l3dLoadForwardRenderQueue(
     unsigned int width,
     unsigned int height,
@@ -47,6 +76,36 @@ L3D_API L3DHandle l3dLoadForwardRenderQueue(
     const L3DHandle& screenFragmentShader = L3D_INVALID_HANDLE
 );
 
+/* Jobs ***********************************************************************/
+
+L3D_API void l3dJobsSetWorkerCount(unsigned int count);
+
+L3D_API unsigned int l3dJobsGetWorkerCount();
+
+L3D_API void l3dJobsRun(
+    L3DJobFunction function,
+    void* data,
+    L3DJobCounter* counter = 0
+);
+
+L3D_API void l3dJobsWait(L3DJobCounter* counter);
+
+L3D_API void l3dJobsParallelFor(
+    unsigned int count,
+    unsigned int grainSize,
+    L3DParallelForFunction function,
+    void* data
+);
+
+/* Buffers ********************************************************************/
+
+L3D_API void l3dUpdateBuffer(
+    const L3DHandle& target,
+    const void* data,
+    unsigned int offset,
+    unsigned int size
+);
+
 /* Textures *******************************************************************/
 
 L3D_API L3DHandle l3dLoadTexture(
@@ -260,12 +319,22 @@ L3D_API L3DHandle l3dLoadGrid(
     unsigned int renderLayer = L3D_OPAQUE_MESH_RENDERLAYER
 );
 
+L3D_API L3DHandle l3dCloneMesh(
+    const L3DHandle& target,
+    const L3DMat4& transMatrix = L3DMat4()
+);
+
 L3D_API L3DMat4 l3dGetMeshTrans(
     const L3DHandle& target
 );
 
 L3D_API unsigned char l3dMeshRenderLayer(const L3DHandle& target);
 
+L3D_API bool l3dMeshHasFlag(
+    const L3DHandle& target,
+    const L3DMeshFlag& flag
+);
+
 L3D_API void l3dSetMeshTrans(
     const L3DHandle& target,
     const L3DMat4& trans
@@ -297,6 +366,12 @@ L3D_API void l3dSetMeshRenderLayer(
     unsigned char renderLayer
 );
 
+L3D_API void l3dSetMeshFlag(
+    const L3DHandle& target,
+    const L3DMeshFlag& flag,
+    bool enable = true
+);
+
 L3D_API void l3dSetMeshInstances(
     const L3DHandle& target,
     void* instances,
@@ -304,6 +379,93 @@ L3D_API void l3dSetMeshInstances(
     const L3DInstanceFormat& instanceFormat
 );
 
+L3D_API void* l3dMapMeshInstances(
+    const L3DHandle& target,
+    unsigned int maxInstanceCount,
+    const L3DInstanceFormat& instanceFormat
+);
+
+L3D_API void l3dCommitMeshInstances(
+    const L3DHandle& target,
+    unsigned int instanceCount
+);
+
+L3D_API L3DHandle l3dGetMeshVertexBuffer(const L3DHandle& target);
+
+L3D_API L3DHandle l3dGetMeshIndexBuffer(const L3DHandle& target);
+
+L3D_API void l3dUpdateMeshVertices(
+    const L3DHandle& target,
+    const float* vertices,
+    unsigned int vertexCount,
+    unsigned int firstVertex = 0
+);
+
+L3D_API unsigned int l3dQueryMeshesInAABB(
+    const L3DAABB& aabb,
+    L3DHandle* results,
+    unsigned int maxResults
+);
+
+L3D_API unsigned int l3dQueryMeshesInSphere(
+    const L3DVec3& center,
+    float radius,
+    L3DHandle* results,
+    unsigned int maxResults
+);
+
+L3D_API unsigned int l3dQueryMeshesOnRay(
+    const L3DVec3& origin,
+    const L3DVec3& direction,
+    float maxDistance,
+    L3DHandle* results,
+    unsigned int maxResults
+);
+
+/* Nodes **********************************************************************/
+
+L3D_API L3DHandle l3dLoadNode(
+    const L3DMat4& transMatrix = L3DMat4(),
+    const L3DHandle& parent = L3D_INVALID_HANDLE
+);
+
+L3D_API L3DHandle l3dGetNodeParent(const L3DHandle& target);
+
+L3D_API L3DMat4 l3dGetNodeTrans(const L3DHandle& target);
+
+L3D_API L3DMat4 l3dGetNodeWorldTrans(const L3DHandle& target);
+
+L3D_API bool l3dSetNodeParent(
+    const L3DHandle& target,
+    const L3DHandle& parent
+);
+
+L3D_API void l3dSetNodeTrans(
+    const L3DHandle& target,
+    const L3DMat4& trans
+);
+
+L3D_API void l3dTranslateNode(
+    const L3DHandle& target,
+    const L3DVec3& movement
+);
+
+L3D_API void l3dRotateNode(
+    const L3DHandle& target,
+    float radians,
+    const L3DVec3& direction = glm::vec3(0.0f, 1.0f, 0.0f)
+);
+
+L3D_API void l3dScaleNode(
+    const L3DHandle& target,
+    const L3DVec3& factor
+);
+
+L3D_API void l3dAttachMeshToNode(
+    const L3DHandle& mesh,
+    const L3DHandle& node
+);
+
 /* Lights *********************************************************************/
 
 L3D_API L3DHandle l3dLoadDirectionalLight(
@@ -44,6 +44,17 @@
 #define L3D_OPAQUE_MESH_RENDERLAYER 1
 #define L3D_ALPHA_BLEND_MESH_RENDERLAYER 2
 #define L3D_POSTPROCESSING_RENDERLAYER 255
+#define L3D_MAX_RENDERLAYERS 256
+
+#define L3D_MAX_LIGHTS 16
+
+#define L3D_MAX_TEXTURE_UNITS 16
+
+#define L3D_MAX_HANDLE_ID 0xFFFFFF
+
+#define L3D_MAX_GPU_TIMINGS 64
+
+#define L3D_MAX_GL_CALL_ARGS 10
 
 #define L3D_DEFAULT_LIGHT_RENDERLAYER_MASK L3D_BIT(L3D_OPAQUE_MESH_RENDERLAYER) | L3D_BIT(L3D_ALPHA_BLEND_MESH_RENDERLAYER)
 
@@ -250,7 +261,8 @@ namespace l3d
         L3D_CAMERA,
         L3D_LIGHT,
         L3D_MESH,
-        L3D_RENDER_QUEUE
+        L3D_RENDER_QUEUE,
+        L3D_TRANSFORM_NODE
     };
 
     enum L3D_API L3DBufferType
@@ -284,9 +296,23 @@ namespace l3d
         L3D_SET_DEPTH_MASK,
         L3D_SET_STENCIL_TEST,
         L3D_SET_BLEND,
+        L3D_SET_CULL_FACE,
         L3D_DRAW_MESHES
     };
 
+    enum L3D_API L3DMeshFlag
+    {
+        L3D_MESH_CULLING = 0,
+        L3D_MESH_OCCLUDER
+    };
+
+    enum L3D_API L3DBackend
+    {
+        L3D_BACKEND_OPENGL = 0,
+        L3D_BACKEND_NULL,
+        L3D_BACKEND_RECORDING
+    };
+
     enum L3D_API L3DLightType
     {
         L3D_LIGHT_DIRECTIONAL = 0,
@@ -307,25 +333,195 @@ namespace l3d
         float kq;
     };
 
+    struct L3D_API L3DBoundingSphere
+    {
+        L3DBoundingSphere(
+            const L3DVec3& center = L3DVec3(0, 0, 0),
+            float radius = 0
+        ) : center(center), radius(radius) {}
+
+        L3DVec3 center;
+        float   radius;
+    };
+
+    struct L3D_API L3DAABB
+    {
+        L3DAABB(
+            const L3DVec3& min = L3DVec3(0, 0, 0),
+            const L3DVec3& max = L3DVec3(0, 0, 0)
+        ) : min(min), max(max) {}
+
+        L3DVec3 center() const { return (this->min + this->max) * 0.5f; }
+        L3DVec3 extents() const { return (this->max - this->min) * 0.5f; }
+
+        // Half of the surface area, enough to compare boxes.
+        float area() const
+        {
+            L3DVec3 d = this->max - this->min;
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+
+        bool contains(const L3DAABB& aabb) const
+        {
+            return glm::all(glm::lessThanEqual(this->min, aabb.min))
+                && glm::all(glm::greaterThanEqual(this->max, aabb.max));
+        }
+
+        bool overlaps(const L3DAABB& aabb) const
+        {
+            return glm::all(glm::lessThanEqual(this->min, aabb.max))
+                && glm::all(glm::greaterThanEqual(this->max, aabb.min));
+        }
+
+        bool overlaps(const L3DBoundingSphere& sphere) const
+        {
+            L3DVec3 d = sphere.center - glm::clamp(sphere.center, this->min, this->max);
+            return glm::dot(d, d) <= sphere.radius * sphere.radius;
+        }
+
+        // Slab test, direction is passed inverted.
+        bool intersects(
+            const L3DVec3& origin,
+            const L3DVec3& invDirection,
+            float maxDistance,
+            float* distance = L3D_NULLPTR
+        ) const
+        {
+            L3DVec3 t1 = (this->min - origin) * invDirection;
+            L3DVec3 t2 = (this->max - origin) * invDirection;
+            L3DVec3 tMin = glm::min(t1, t2);
+            L3DVec3 tMax = glm::max(t1, t2);
+            float tEnter = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+            float tExit = glm::min(glm::min(tMax.x, tMax.y), glm::min(tMax.z, maxDistance));
+
+            if (distance) *distance = tEnter;
+
+            return tEnter <= tExit;
+        }
+
+        static L3DAABB merge(const L3DAABB& a, const L3DAABB& b)
+        {
+            return L3DAABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+        }
+
+        L3DVec3 min;
+        L3DVec3 max;
+    };
+
+    // Usage of shared buffers which renderer sub-allocates buffers from.
+    // Sizes are in bytes.
+    struct L3D_API L3DBufferStats
+    {
+        L3DBufferStats()
+          : arenaCount(0), bufferCount(0), capacity(0), usedSize(0),
+            largestFreeBlock(0), freeBlockCount(0), fragmentation(0), utilisation(0) {}
+
+        unsigned int    arenaCount;
+        unsigned int    bufferCount;
+        unsigned int    capacity;
+        unsigned int    usedSize;
+        unsigned int    largestFreeBlock;
+        unsigned int    freeBlockCount;
+
+        // Share of free space out of largest free blocks.
+        float           fragmentation;
+
+        // Share of capacity in use.
+        float           utilisation;
+    };
+
+    // GPU time taken by a pass of render queue: a frame buffer switch, a
+    // clear or the draws of a render layer. Results are read some frames
+    // after rendering, frameIndex tells which frame they belong to.
+    struct L3D_API L3DGpuTiming
+    {
+        L3DGpuTiming()
+          : commandType(L3D_INVALID_RENDER_COMMAND), renderLayer(0), frameIndex(0), milliseconds(0) {}
+
+        L3DRenderCommandType    commandType;
+        unsigned char           renderLayer;
+        unsigned int            frameIndex;
+        double                  milliseconds;
+    };
+
+    // Work submitted to OpenGL in a frame, as a whole or by a render layer.
+    // Triangles and vertices count every instance. Culled meshes are the
+    // ones of drawn layers which were skipped.
+    struct L3D_API L3DFrameStats
+    {
+        L3DFrameStats()
+          : drawCalls(0), instancedDrawCalls(0), triangles(0), vertices(0),
+            shaderProgramBinds(0), vertexArrayBinds(0), textureBinds(0), uniformUploads(0),
+            frameBufferSwitches(0), mipmapRegenerations(0), culledMeshes(0), uploadedBytes(0) {}
+
+        unsigned int    drawCalls;
+        unsigned int    instancedDrawCalls;
+        unsigned int    triangles;
+        unsigned int    vertices;
+        unsigned int    shaderProgramBinds;
+        unsigned int    vertexArrayBinds;
+        unsigned int    textureBinds;
+        unsigned int    uniformUploads;
+        unsigned int    frameBufferSwitches;
+        unsigned int    mipmapRegenerations;
+        unsigned int    culledMeshes;
+        unsigned int    uploadedBytes;
+
+        L3DFrameStats& operator+=(const L3DFrameStats& other)
+        {
+            drawCalls += other.drawCalls;
+            instancedDrawCalls += other.instancedDrawCalls;
+            triangles += other.triangles;
+            vertices += other.vertices;
+            shaderProgramBinds += other.shaderProgramBinds;
+            vertexArrayBinds += other.vertexArrayBinds;
+            textureBinds += other.textureBinds;
+            uniformUploads += other.uniformUploads;
+            frameBufferSwitches += other.frameBufferSwitches;
+            mipmapRegenerations += other.mipmapRegenerations;
+            culledMeshes += other.culledMeshes;
+            uploadedBytes += other.uploadedBytes;
+            return *this;
+        }
+    };
+
+    // OpenGL call logged by recording backend. Integers are stored as they
+    // are (signed ones sign extended), pointers as addresses and floats as
+    // their bits.
+    struct L3D_API L3DGLCall
+    {
+        L3DGLCall() : name(0), argCount(0), args() {}
+
+        const char*         name;
+        unsigned int        argCount;
+        unsigned long long  args[L3D_MAX_GL_CALL_ARGS];
+    };
+
+    // Jobs run by L3DJobSystem.
+    typedef void (*L3DJobFunction)(void* data);
+    typedef void (*L3DParallelForFunction)(void* data, unsigned int first, unsigned int last);
+
     // Almost-opaque resource handle:
     //
-    // x-------------------- repr ---------------------X
-    // |-- type --|-- flags --|---------- id ----------|
+    // x--------------------------------- repr ---------------------------------X
+    // |-- type --|-- flags --|-- generation --|---------- id ----------|-- 0 --|
     //
     // Could be used in different ways:
     //
     // > handle.repr
-    // > handle.data.type   (8bits)
-    // > handle.data.flags  (8bits, bitfield)
-    // > handle.data.id     (16bits)
+    // > handle.data.type       (8bits)
+    // > handle.data.flags      (8bits, bitfield)
+    // > handle.data.generation (16bits, tells reused ids apart)
+    // > handle.data.id         (24bits)
     typedef L3D_API union
     {
-        unsigned int repr;
+        unsigned long long repr;
         struct L3DHandleData
         {
             unsigned char type;
             unsigned char flags;
-            unsigned short int id;
+            unsigned short int generation;
+            unsigned int id : 24;
         } data;
     } L3DHandle;
 
@@ -144,15 +144,16 @@ int main()
     l3dTranslateMesh(cube1, L3DVec3(10, 3, -20));
     l3dScaleMesh(cube1, L3DVec3(6, 6, 6));
 
-    // Load a tree.
+    // Load a tree, its meshes are moved together by a node.
+    L3DHandle treeNode = l3dLoadNode();
+    l3dRotateNode(treeNode, 0.75f);
+    l3dTranslateNode(treeNode, L3DVec3(-45, 0, 20));
+    l3dScaleNode(treeNode, L3DVec3(10, 10, 10));
+
     unsigned int meshCount = 0;
     L3DHandle* tree = l3dutLoadMeshes("tree1.obj", blinnPhongShaderProgram, &meshCount);
     for (int i=0; i<meshCount; ++i)
-    {
-      l3dRotateMesh(tree[i], 0.75f);
-      l3dTranslateMesh(tree[i], L3DVec3(-45, 0, 20));
-      l3dScaleMesh(tree[i], L3DVec3(10, 10, 10));
-    }
+      l3dAttachMeshToNode(tree[i], treeNode);
 
     // Load a directional light.
     L3DHandle sunLight = l3dLoadDirectionalLight(L3DVec3(-2, -1, 5), SUN_LIGHT_COLOR);
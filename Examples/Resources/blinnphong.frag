@@ -36,6 +36,14 @@ in VertexData {
 
 /* UNIFORMS *******************************************************************/
 
+// Frame data, shared by all programs.
+layout(std140) uniform L3DFrame {
+    mat4 u_viewMat;
+    mat4 u_projMat;
+    mat4 u_vpMat;
+    vec3 u_cameraPos;
+};
+
 // Flags.
 uniform bool        u_specularMapEnabled;
 uniform bool        u_normalMapEnabled;
@@ -47,9 +55,6 @@ uniform sampler2D   u_specularMap;
 uniform sampler2D   u_normalMap;
 uniform sampler2D   u_alphaMap;
 
-// Camera position.
-uniform vec3        u_cameraPos;
-
 // Material and lights.
 uniform Material    u_material;
 uniform int         u_lightNr;
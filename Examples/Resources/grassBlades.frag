@@ -23,11 +23,17 @@ in VertexData {
 
 /* UNIFORMS **************************************************************/
 
+// Frame data, shared by all programs.
+layout(std140) uniform L3DFrame {
+    mat4 u_viewMat;
+    mat4 u_projMat;
+    mat4 u_vpMat;
+    vec3 u_cameraPos;
+};
+
 // Diffuse map.
 uniform sampler2D   u_diffuseMap;
 
-// Camera position.
-uniform vec3        u_cameraPos;
 uniform float       u_grassDistanceLOD1;
 uniform float       u_grassDistanceLOD2;
 uniform float       u_grassDistanceLOD3;
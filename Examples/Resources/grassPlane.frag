@@ -21,13 +21,18 @@ in VertexData {
 
 /* UNIFORMS *******************************************************************/
 
+// Frame data, shared by all programs.
+layout(std140) uniform L3DFrame {
+    mat4 u_viewMat;
+    mat4 u_projMat;
+    mat4 u_vpMat;
+    vec3 u_cameraPos;
+};
+
 // Diffuse map.
 uniform sampler2D   u_diffuseMap;
 uniform sampler2D   u_dirtMap;
 
-// Camera position.
-uniform vec3        u_cameraPos;
-
 // Material and lights.
 uniform Material    u_material;
 uniform float       u_grassDistanceLOD3;
@@ -0,0 +1,70 @@
+#version 430 core
+
+/* ATTRIBUTES *****************************************************************/
+
+layout(location = 0) in vec3 i_position;   // xyz - position
+layout(location = 1) in vec3 i_normal;     // xyz - normal
+layout(location = 2) in vec3 i_tangent;    // xyz - tangent
+layout(location = 3) in vec2 i_texcoord0;  // xy - texture0 coords
+layout(location = 10) in uint i_drawId;    // index of draw data
+
+/* UNIFORMS *******************************************************************/
+
+// Frame data, shared by all programs.
+layout(std140) uniform L3DFrame {
+    mat4 u_viewMat;
+    mat4 u_projMat;
+    mat4 u_vpMat;
+    vec3 u_cameraPos;
+};
+
+// Draw data, one entry per drawn mesh.
+struct L3DDrawData {
+    mat4 modelMat;
+    mat4 normalMat;
+};
+
+layout(std430) readonly buffer L3DDraws {
+    L3DDrawData u_draws[];
+};
+
+/* OUTPUTS ********************************************************************/
+
+// Data for fragment shader.
+out VertexData {
+  vec3    position;
+  vec3    normal;
+  vec3    tangent;
+  vec3    bitangent;
+  vec2    texcoord0;
+} vs_out;
+
+/* MAIN ***********************************************************************/
+
+void main(void)
+{
+    // Matrices.
+    mat4 modelMat = u_draws[i_drawId].modelMat;
+    mat3 normalMat = mat3(u_draws[i_drawId].normalMat);
+
+    // Vertex position in world space.
+    vec4 worldSpacePosition = modelMat * vec4(i_position, 1);
+    vs_out.position = worldSpacePosition.xyz / worldSpacePosition.w;
+
+    // Normal in world space.
+    vs_out.normal	= normalize(normalMat * i_normal);
+
+    // Tangent in world space.
+    vs_out.tangent	= normalize(normalMat * i_tangent);
+    // Re-orthogonalize tangent with respect to normal
+    vs_out.tangent = normalize(vs_out.tangent - dot(vs_out.tangent, vs_out.normal) * vs_out.normal);
+
+    // Bi-tagent in world space.
+    vs_out.bitangent = cross(vs_out.tangent, vs_out.normal);
+
+    // Texture coordinates to fragment shader.
+    vs_out.texcoord0	= i_texcoord0;
+
+    // Vertex position in screen space.
+    gl_Position	= u_vpMat * worldSpacePosition;
+}
@@ -10,9 +10,16 @@ in mat4 i_instanceMat;  // instance matrix
 
 /* UNIFORMS *******************************************************************/
 
+// Frame data, shared by all programs.
+layout(std140) uniform L3DFrame {
+    mat4 u_viewMat;
+    mat4 u_projMat;
+    mat4 u_vpMat;
+    vec3 u_cameraPos;
+};
+
 // Matrices.
 uniform mat4 u_modelMat;
-uniform mat4 u_vpMat;
 uniform mat3 u_normalMat;
 
 /* OUTPUTS ********************************************************************/
@@ -34,11 +41,14 @@ void main(void)
     vec4 worldSpacePosition = i_instanceMat * u_modelMat * vec4(i_position, 1);
     vs_out.position = worldSpacePosition.xyz / worldSpacePosition.w;
 
+    // Normal matrix of instance.
+    mat3 normalMat = transpose(inverse(mat3(i_instanceMat))) * u_normalMat;
+
     // Normal in world space.
-    vs_out.normal	= normalize(u_normalMat * i_normal);
+    vs_out.normal	= normalize(normalMat * i_normal);
 
     // Tangent in world space.
-    vs_out.tangent	= normalize(u_normalMat * i_tangent);
+    vs_out.tangent	= normalize(normalMat * i_tangent);
     // Re-orthogonalize tangent with respect to normal
     vs_out.tangent = normalize(vs_out.tangent - dot(vs_out.tangent, vs_out.normal) * vs_out.normal);
 
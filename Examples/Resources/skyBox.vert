@@ -6,10 +6,16 @@ in vec3 i_position;     // xyz - position
 
 /* UNIFORMS *******************************************************************/
 
+// Frame data, shared by all programs.
+layout(std140) uniform L3DFrame {
+    mat4 u_viewMat;
+    mat4 u_projMat;
+    mat4 u_vpMat;
+    vec3 u_cameraPos;
+};
+
 // Matrices.
 uniform mat4 u_modelMat;
-uniform mat4 u_viewMat;
-uniform mat4 u_projMat;
 uniform mat3 u_normalMat;
 
 /* OUTPUTS ********************************************************************/
@@ -37,15 +37,20 @@ in VertexData {
 
 /* UNIFORMS *******************************************************************/
 
+// Frame data, shared by all programs.
+layout(std140) uniform L3DFrame {
+    mat4 u_viewMat;
+    mat4 u_projMat;
+    mat4 u_vpMat;
+    vec3 u_cameraPos;
+};
+
 // Flags.
 uniform bool        u_normalMapEnabled;
 
 // Diffuse map.
 uniform sampler2D   u_normalMap;
 
-// Camera position.
-uniform vec3        u_cameraPos;
-
 // Material and lights.
 uniform Material    u_material;
 uniform int         u_lightNr;
@@ -11,9 +11,16 @@ in vec2 i_texcoord0;    // xy - texture0 coords
 
 /* UNIFORMS *******************************************************************/
 
+// Frame data, shared by all programs.
+layout(std140) uniform L3DFrame {
+    mat4 u_viewMat;
+    mat4 u_projMat;
+    mat4 u_vpMat;
+    vec3 u_cameraPos;
+};
+
 // Matrices.
 uniform mat4 u_modelMat;
-uniform mat4 u_vpMat;
 uniform mat3 u_normalMat;
 
 // Simulation.
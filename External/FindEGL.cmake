@@ -0,0 +1,28 @@
+# Locate system EGL library
+#
+# This module defines:
+#
+# EGL_FOUND, if false, do not try to link to EGL
+# EGL_LIBRARY, the name of the library to link against
+# EGL_LIBRARIES, the full list of libs to link against
+# EGL_INCLUDE_DIR, where to find EGL/egl.h
+#=============================================================================
+
+INCLUDE(FindPackageHandleStandardArgs)
+
+FIND_PATH(EGL_INCLUDE_DIR EGL/egl.h)
+FIND_LIBRARY(EGL_LIBRARY NAMES EGL)
+
+# Handle REQUIRD argument, define *_FOUND variable
+find_package_handle_standard_args(EGL
+  DEFAULT_MSG EGL_INCLUDE_DIR
+  EGL_LIBRARY
+)
+
+# Define EGL_LIBRARIES and EGL_INCLUDE_DIRS
+if (EGL_FOUND)
+  set(EGL_LIBRARIES ${EGL_LIBRARY})
+  set(EGL_INCLUDE_DIRS ${EGL_INCLUDE_DIR})
+endif (EGL_FOUND)
+
+mark_as_advanced(EGL_INCLUDE_DIR EGL_LIBRARY)
@@ -3662,6 +3662,10 @@ typedef void (APIENTRYP PFNGLTEXTUREBARRIERPROC)();
 GLAPI PFNGLTEXTUREBARRIERPROC glad_glTextureBarrier;
 #define glTextureBarrier glad_glTextureBarrier
 #endif
+#ifndef GL_KHR_debug
+#define GL_KHR_debug 1
+GLAPI int GLAD_GL_KHR_debug;
+#endif
 
 #ifdef __cplusplus
 }
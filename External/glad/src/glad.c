@@ -238,6 +238,7 @@ int GLAD_GL_VERSION_4_2;
 int GLAD_GL_VERSION_4_3;
 int GLAD_GL_VERSION_4_4;
 int GLAD_GL_VERSION_4_5;
+int GLAD_GL_KHR_debug;
 PFNGLCOPYTEXIMAGE1DPROC glad_glCopyTexImage1D;
 PFNGLVERTEXATTRIBI3UIPROC glad_glVertexAttribI3ui;
 PFNGLVERTEXARRAYELEMENTBUFFERPROC glad_glVertexArrayElementBuffer;
@@ -1683,8 +1684,22 @@ static void load_GL_VERSION_4_5(GLADloadproc load) {
 	glad_glGetnMinmax = (PFNGLGETNMINMAXPROC)load("glGetnMinmax");
 	glad_glTextureBarrier = (PFNGLTEXTUREBARRIERPROC)load("glTextureBarrier");
 }
+static void load_GL_KHR_debug(GLADloadproc load) {
+	if(!GLAD_GL_KHR_debug) return;
+	glad_glDebugMessageControl = (PFNGLDEBUGMESSAGECONTROLPROC)load("glDebugMessageControl");
+	glad_glDebugMessageInsert = (PFNGLDEBUGMESSAGEINSERTPROC)load("glDebugMessageInsert");
+	glad_glDebugMessageCallback = (PFNGLDEBUGMESSAGECALLBACKPROC)load("glDebugMessageCallback");
+	glad_glGetDebugMessageLog = (PFNGLGETDEBUGMESSAGELOGPROC)load("glGetDebugMessageLog");
+	glad_glPushDebugGroup = (PFNGLPUSHDEBUGGROUPPROC)load("glPushDebugGroup");
+	glad_glPopDebugGroup = (PFNGLPOPDEBUGGROUPPROC)load("glPopDebugGroup");
+	glad_glObjectLabel = (PFNGLOBJECTLABELPROC)load("glObjectLabel");
+	glad_glGetObjectLabel = (PFNGLGETOBJECTLABELPROC)load("glGetObjectLabel");
+	glad_glObjectPtrLabel = (PFNGLOBJECTPTRLABELPROC)load("glObjectPtrLabel");
+	glad_glGetObjectPtrLabel = (PFNGLGETOBJECTPTRLABELPROC)load("glGetObjectPtrLabel");
+}
 static int find_extensionsGL(void) {
 	if (!get_exts()) return 0;
+	GLAD_GL_KHR_debug = has_ext("GL_KHR_debug");
 	free_exts();
 	return 1;
 }
@@ -1775,6 +1790,7 @@ int gladLoadGLLoader(GLADloadproc load) {
 	load_GL_VERSION_4_5(load);
 
 	if (!find_extensionsGL()) return 0;
+	load_GL_KHR_debug(load);
 	return GLVersion.major != 0 || GLVersion.minor != 0;
 }
 
@@ -0,0 +1,178 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DBufferAllocator.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+TEST_CASE( "Test L3DBufferAllocator allocate and release", "[leaf3d][allocator]" )
+{
+    L3DBufferAllocator allocator(1024);
+
+    REQUIRE( allocator.capacity() == 1024 );
+    REQUIRE( allocator.freeSize() == 1024 );
+    REQUIRE( allocator.freeBlockCount() == 1 );
+
+    int a = allocator.allocate(100);
+    int b = allocator.allocate(200);
+    int c = allocator.allocate(300);
+
+    REQUIRE( a != L3D_INVALID_BLOCK );
+    REQUIRE( b != L3D_INVALID_BLOCK );
+    REQUIRE( c != L3D_INVALID_BLOCK );
+    REQUIRE( allocator.offset(a) == 0 );
+    REQUIRE( allocator.offset(b) == 100 );
+    REQUIRE( allocator.offset(c) == 300 );
+    REQUIRE( allocator.size(b) == 200 );
+    REQUIRE( allocator.usedSize() == 600 );
+    REQUIRE( allocator.allocationCount() == 3 );
+
+    REQUIRE( allocator.allocate(0) == L3D_INVALID_BLOCK );
+    REQUIRE( allocator.allocate(1000) == L3D_INVALID_BLOCK );
+
+    // Freed ranges are reused.
+    allocator.release(b);
+    REQUIRE( allocator.freeBlockCount() == 2 );
+
+    int d = allocator.allocate(150);
+    REQUIRE( allocator.offset(d) == 100 );
+
+    // Neighbours are merged back on release.
+    allocator.release(a);
+    allocator.release(c);
+    allocator.release(d);
+
+    REQUIRE( allocator.usedSize() == 0 );
+    REQUIRE( allocator.allocationCount() == 0 );
+    REQUIRE( allocator.freeBlockCount() == 1 );
+    REQUIRE( allocator.largestFreeBlock() == 1024 );
+}
+
+TEST_CASE( "Test L3DBufferAllocator grow", "[leaf3d][allocator]" )
+{
+    L3DBufferAllocator allocator(64);
+
+    int a = allocator.allocate(64);
+    REQUIRE( allocator.allocate(16) == L3D_INVALID_BLOCK );
+
+    allocator.grow(128);
+    REQUIRE( allocator.capacity() == 128 );
+
+    int b = allocator.allocate(16);
+    REQUIRE( b != L3D_INVALID_BLOCK );
+    REQUIRE( allocator.offset(b) == 64 );
+
+    // Trailing free space is extended in place.
+    allocator.grow(256);
+    REQUIRE( allocator.freeBlockCount() == 1 );
+    REQUIRE( allocator.largestFreeBlock() == 256 - 80 );
+
+    allocator.release(a);
+    allocator.release(b);
+    REQUIRE( allocator.largestFreeBlock() == 256 );
+
+    // Free block of exactly requested size is found, even if its class
+    // holds smaller sizes too.
+    L3DBufferAllocator exact(100);
+    REQUIRE( exact.allocate(100) != L3D_INVALID_BLOCK );
+    REQUIRE( exact.freeSize() == 0 );
+}
+
+TEST_CASE( "Test L3DBufferAllocator defragment", "[leaf3d][allocator]" )
+{
+    L3DBufferAllocator allocator(1000);
+
+    int blocks[10];
+    for (unsigned int i = 0; i < 10; ++i)
+        blocks[i] = allocator.allocate(50);
+
+    // Leaves a hole every other block.
+    for (unsigned int i = 0; i < 10; i += 2)
+        allocator.release(blocks[i]);
+
+    REQUIRE( allocator.freeSize() == 750 );
+    REQUIRE( allocator.largestFreeBlock() == 500 );
+    REQUIRE( allocator.fragmentation() > 0.3f );
+
+    // A request larger than any hole fails even if there is enough space.
+    L3DBufferAllocator copy = allocator;
+    REQUIRE( copy.allocate(600) == L3D_INVALID_BLOCK );
+
+    std::vector<L3DBufferMove> moves;
+    allocator.defragment(moves);
+
+    REQUIRE( moves.size() == 5 );
+    for (unsigned int i = 0; i < moves.size(); ++i)
+    {
+        REQUIRE( moves[i].block == blocks[i * 2 + 1] );
+        REQUIRE( moves[i].srcOffset == (i * 2 + 1) * 50 );
+        REQUIRE( moves[i].dstOffset == i * 50 );
+        REQUIRE( moves[i].size == 50 );
+        REQUIRE( allocator.offset(moves[i].block) == i * 50 );
+    }
+
+    REQUIRE( allocator.freeBlockCount() == 1 );
+    REQUIRE( allocator.fragmentation() == 0.0f );
+    REQUIRE( allocator.usedSize() == 250 );
+
+    int big = allocator.allocate(600);
+    REQUIRE( big != L3D_INVALID_BLOCK );
+    REQUIRE( allocator.offset(big) == 250 );
+
+    // Packed allocator has nothing to move.
+    moves.clear();
+    allocator.defragment(moves);
+    REQUIRE( moves.empty() );
+}
+
+TEST_CASE( "Test L3DBufferAllocator size classes", "[leaf3d][allocator]" )
+{
+    L3DBufferAllocator allocator(1 << 20);
+
+    std::vector<int> blocks;
+    unsigned int total = 0;
+
+    for (unsigned int size = 1; size < 5000; size = size * 3 + 1)
+    {
+        int block = allocator.allocate(size);
+        REQUIRE( block != L3D_INVALID_BLOCK );
+        REQUIRE( allocator.size(block) == size );
+        blocks.push_back(block);
+        total += size;
+    }
+
+    REQUIRE( allocator.usedSize() == total );
+
+    // Any found block must be large enough for the request.
+    for (unsigned int i = 0; i < blocks.size(); i += 2)
+        allocator.release(blocks[i]);
+
+    int block = allocator.allocate(1000);
+    REQUIRE( allocator.size(block) == 1000 );
+
+    for (unsigned int i = 1; i < blocks.size(); i += 2)
+        allocator.release(blocks[i]);
+    allocator.release(block);
+
+    REQUIRE( allocator.freeBlockCount() == 1 );
+    REQUIRE( allocator.usedSize() == 0 );
+}
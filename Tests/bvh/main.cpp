@@ -0,0 +1,140 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <algorithm>
+#include <leaf3d/L3DBVH.h>
+#include <leaf3d/L3DFrustum.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static L3DAABB _unitBox(const L3DVec3& center)
+{
+    return L3DAABB(center - L3DVec3(0.5f), center + L3DVec3(0.5f));
+}
+
+static bool _contains(const std::vector<int>& proxies, int proxy)
+{
+    return std::find(proxies.begin(), proxies.end(), proxy) != proxies.end();
+}
+
+TEST_CASE( "Test L3DBVH insert and remove", "[leaf3d][bvh]" )
+{
+    L3DBVH bvh;
+
+    REQUIRE(bvh.leafCount() == 0);
+    REQUIRE(bvh.height() == 0);
+
+    int proxies[64];
+    for (int i = 0; i < 64; ++i)
+        proxies[i] = bvh.insert(_unitBox(L3DVec3(i * 2, 0, 0)), &proxies[i]);
+
+    REQUIRE(bvh.leafCount() == 64);
+    REQUIRE(bvh.userData(proxies[10]) == &proxies[10]);
+
+    // Balanced tree of 64 leaves is far from a list.
+    REQUIRE(bvh.height() <= 12);
+
+    for (int i = 0; i < 64; i += 2)
+        bvh.remove(proxies[i]);
+
+    REQUIRE(bvh.leafCount() == 32);
+
+    std::vector<int> result;
+    bvh.query(L3DAABB(L3DVec3(-1000), L3DVec3(1000)), result);
+
+    REQUIRE(result.size() == 32);
+    REQUIRE(_contains(result, proxies[1]) == true);
+    REQUIRE(_contains(result, proxies[2]) == false);
+
+    bvh.clear();
+
+    REQUIRE(bvh.leafCount() == 0);
+}
+
+TEST_CASE( "Test L3DBVH volume queries", "[leaf3d][bvh][query]" )
+{
+    L3DBVH bvh;
+
+    int a = bvh.insert(_unitBox(L3DVec3(0, 0, 0)), L3D_NULLPTR);
+    int b = bvh.insert(_unitBox(L3DVec3(10, 0, 0)), L3D_NULLPTR);
+    int c = bvh.insert(_unitBox(L3DVec3(0, 0, -20)), L3D_NULLPTR);
+
+    std::vector<int> result;
+    bvh.query(L3DAABB(L3DVec3(8, -1, -1), L3DVec3(12, 1, 1)), result);
+
+    REQUIRE(result.size() == 1);
+    REQUIRE(result[0] == b);
+
+    result.clear();
+    bvh.query(L3DBoundingSphere(L3DVec3(0, 0, -18), 2), result);
+
+    REQUIRE(result.size() == 1);
+    REQUIRE(result[0] == c);
+
+    // Moving within the enlarged bounds needs no reinsertion.
+    REQUIRE(bvh.move(a, _unitBox(L3DVec3(0.05f, 0, 0))) == false);
+    REQUIRE(bvh.move(a, _unitBox(L3DVec3(10, 0, 5))) == true);
+
+    result.clear();
+    bvh.query(_unitBox(L3DVec3(10, 0, 5)), result);
+
+    REQUIRE(result.size() == 1);
+    REQUIRE(result[0] == a);
+}
+
+TEST_CASE( "Test L3DBVH ray and frustum queries", "[leaf3d][bvh][query]" )
+{
+    L3DBVH bvh;
+
+    int near = bvh.insert(_unitBox(L3DVec3(0, 0, -5)), L3D_NULLPTR);
+    int far = bvh.insert(_unitBox(L3DVec3(0, 0, -50)), L3D_NULLPTR);
+    int side = bvh.insert(_unitBox(L3DVec3(100, 0, -5)), L3D_NULLPTR);
+    int behind = bvh.insert(_unitBox(L3DVec3(0, 0, 5)), L3D_NULLPTR);
+
+    std::vector<int> result;
+    bvh.query(L3DVec3(0, 0, 0), L3DVec3(0, 0, -1), 100, result);
+
+    REQUIRE(result.size() == 2);
+    REQUIRE(_contains(result, near) == true);
+    REQUIRE(_contains(result, far) == true);
+
+    result.clear();
+    bvh.query(L3DVec3(0, 0, 0), L3DVec3(0, 0, -1), 10, result);
+
+    REQUIRE(result.size() == 1);
+    REQUIRE(result[0] == near);
+
+    // Camera at origin, looking at -Z.
+    L3DMat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    L3DMat4 view = glm::lookAt(L3DVec3(0, 0, 0), L3DVec3(0, 0, -1), L3DVec3(0, 1, 0));
+    L3DFrustum frustum(proj * view);
+
+    std::vector<int> inside;
+    std::vector<int> intersecting;
+    bvh.query(frustum, inside, intersecting);
+
+    REQUIRE(inside.size() + intersecting.size() == 2);
+    REQUIRE((_contains(inside, near) || _contains(intersecting, near)) == true);
+    REQUIRE((_contains(inside, far) || _contains(intersecting, far)) == true);
+    REQUIRE(_contains(inside, side) == false);
+    REQUIRE(_contains(intersecting, behind) == false);
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <leaf3d/L3DCommandBucket.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static bool _packetLess(const L3DDrawPacket& a, const L3DDrawPacket& b)
+{
+    return a.key < b.key;
+}
+
+TEST_CASE( "Test L3DCommandBucket sort", "[leaf3d][commandbucket]" )
+{
+    L3DDrawPacketList packets;
+    L3DDrawPacketList scratch;
+
+    srand(42);
+
+    // Few distinct keys, spread over all bytes, to check stability too.
+    for (unsigned int i = 0; i < 1000; ++i)
+    {
+        L3DDrawPacket packet;
+        packet.key = ((unsigned long long)(rand() % 4) << 56) | ((unsigned long long)(rand() % 3) << 24) | (rand() % 5);
+        packet.mesh = (L3DMesh*)(size_t)(i + 1);
+        packets.push_back(packet);
+    }
+
+    L3DDrawPacketList expected = packets;
+    std::stable_sort(expected.begin(), expected.end(), _packetLess);
+
+    L3DCommandBucket::sort(packets, scratch);
+
+    REQUIRE( packets.size() == expected.size() );
+
+    for (unsigned int i = 0; i < packets.size(); ++i)
+    {
+        REQUIRE( packets[i].key == expected[i].key );
+        REQUIRE( packets[i].mesh == expected[i].mesh );
+    }
+}
+
+TEST_CASE( "Test L3DCommandBucket merge", "[leaf3d][commandbucket]" )
+{
+    L3DCommandBucket buckets[3];
+    L3DDrawPacketList packets;
+    L3DDrawPacketList scratch;
+
+    buckets[0].addPacket(5, (L3DMesh*)5);
+    buckets[0].addPacket(1, (L3DMesh*)1);
+    buckets[2].addPacket(3, (L3DMesh*)3);
+    buckets[2].addPacket(0x100000000ULL, (L3DMesh*)6);
+    buckets[2].addPacket(2, (L3DMesh*)2);
+
+    L3DCommandBucket::merge(buckets, 3, packets, scratch);
+
+    REQUIRE( packets.size() == 5 );
+    REQUIRE( packets[0].mesh == (L3DMesh*)1 );
+    REQUIRE( packets[1].mesh == (L3DMesh*)2 );
+    REQUIRE( packets[2].mesh == (L3DMesh*)3 );
+    REQUIRE( packets[3].mesh == (L3DMesh*)5 );
+    REQUIRE( packets[4].mesh == (L3DMesh*)6 );
+
+    // Buckets are left as they are, ready to be cleared by their threads.
+    REQUIRE( buckets[0].packetCount() == 2 );
+
+    buckets[0].clear();
+
+    REQUIRE( buckets[0].packetCount() == 0 );
+}
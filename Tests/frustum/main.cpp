@@ -0,0 +1,86 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DFrustum.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static L3DFrustum _testFrustum()
+{
+    // Camera at origin, looking at -Z.
+    L3DMat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    L3DMat4 view = glm::lookAt(L3DVec3(0, 0, 0), L3DVec3(0, 0, -1), L3DVec3(0, 1, 0));
+
+    return L3DFrustum(proj * view);
+}
+
+TEST_CASE( "Test L3DFrustum sphere intersection", "[leaf3d][frustum][intersects]" )
+{
+    L3DFrustum frustum = _testFrustum();
+
+    REQUIRE(frustum.intersects(L3DBoundingSphere(L3DVec3(0, 0, -10), 1)) == true);
+    REQUIRE(frustum.intersects(L3DBoundingSphere(L3DVec3(0, 0, 10), 1)) == false);
+    REQUIRE(frustum.intersects(L3DBoundingSphere(L3DVec3(0, 0, -200), 1)) == false);
+    REQUIRE(frustum.intersects(L3DBoundingSphere(L3DVec3(-12, 0, -10), 1)) == false);
+    REQUIRE(frustum.intersects(L3DBoundingSphere(L3DVec3(-10.5f, 0, -10), 1)) == true);
+}
+
+TEST_CASE( "Test L3DFrustum AABB intersection", "[leaf3d][frustum][intersects]" )
+{
+    L3DFrustum frustum = _testFrustum();
+
+    REQUIRE(frustum.intersects(L3DAABB(L3DVec3(-1, -1, -11), L3DVec3(1, 1, -9))) == true);
+    REQUIRE(frustum.intersects(L3DAABB(L3DVec3(-1, -1, 9), L3DVec3(1, 1, 11))) == false);
+    REQUIRE(frustum.intersects(L3DAABB(L3DVec3(-1, -1, -1), L3DVec3(1, 1, 1))) == true);
+    REQUIRE(frustum.intersects(L3DAABB(L3DVec3(-30, -1, -11), L3DVec3(-12, 1, -9))) == false);
+}
+
+TEST_CASE( "Test L3DFrustum batch culling", "[leaf3d][frustum][cull]" )
+{
+    L3DFrustum frustum = _testFrustum();
+    L3DBoundsArray bounds;
+
+    // More than four entries, so both batched and remaining ones are tested.
+    bounds.add(L3DVec3(0, 0, -10), L3DVec3(1, 1, 1), 1.8f);
+    bounds.add(L3DVec3(0, 0, 10), L3DVec3(1, 1, 1), 1.8f);
+    bounds.add(L3DVec3(-14, 0, -10), L3DVec3(1, 1, 1), 1.8f);
+    bounds.add(L3DVec3(0, 50, -10), L3DVec3(1, 1, 1), 1.8f);
+    bounds.add(L3DVec3(5, 5, -50), L3DVec3(1, 1, 1), 1.8f);
+    bounds.addInfinite();
+    bounds.add(L3DVec3(0, 0, -150), L3DVec3(1, 1, 1), 1.8f);
+
+    // Sphere radius bounds loose extents.
+    bounds.add(L3DVec3(0, 0, 12), L3DVec3(20, 20, 20), 1.0f);
+
+    unsigned char visibility[8];
+
+    REQUIRE(bounds.size() == 8);
+    REQUIRE(frustum.cull(bounds, visibility) == 3);
+    REQUIRE(visibility[0] == 1);
+    REQUIRE(visibility[1] == 0);
+    REQUIRE(visibility[2] == 0);
+    REQUIRE(visibility[3] == 0);
+    REQUIRE(visibility[4] == 1);
+    REQUIRE(visibility[5] == 1);
+    REQUIRE(visibility[6] == 0);
+    REQUIRE(visibility[7] == 0);
+}
@@ -0,0 +1,58 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DGeometry.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+TEST_CASE( "Test L3DGeometry grid", "[leaf3d][geometry][grid]" )
+{
+    REQUIRE(L3DGeometry::gridVertexCount(2) == 9);
+    REQUIRE(L3DGeometry::gridIndexCount(2) == 24);
+
+    float vertices[9 * 11];
+    unsigned int indices[24];
+
+    L3DGeometry::grid(2, L3DVec2(4, 2), vertices, indices);
+
+    // First and last vertices are opposite corners.
+    REQUIRE(vertices[0] == Approx(-0.5f));
+    REQUIRE(vertices[1] == Approx(-0.5f));
+    REQUIRE(vertices[8 * 11 + 0] == Approx(0.5f));
+    REQUIRE(vertices[8 * 11 + 1] == Approx(0.5f));
+
+    // Normal and tangent.
+    REQUIRE(vertices[4 * 11 + 5] == 1.0f);
+    REQUIRE(vertices[4 * 11 + 6] == 1.0f);
+
+    // Texcoords are scaled per quad.
+    REQUIRE(vertices[8 * 11 + 9] == Approx(8.0f));
+    REQUIRE(vertices[8 * 11 + 10] == Approx(4.0f));
+
+    // Both triangles of last quad.
+    REQUIRE(indices[18] == 4);
+    REQUIRE(indices[19] == 5);
+    REQUIRE(indices[20] == 7);
+    REQUIRE(indices[21] == 7);
+    REQUIRE(indices[22] == 8);
+    REQUIRE(indices[23] == 5);
+}
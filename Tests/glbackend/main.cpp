@@ -0,0 +1,168 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <string.h>
+#include <vector>
+#include <leaf3d/leaf3d.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static const char* _vertexShader = GLSL(
+    in vec3 i_position;
+    in mat4 i_instanceMat;
+
+    layout(std140) uniform L3DFrame {
+        mat4 u_viewMat;
+        mat4 u_projMat;
+        mat4 u_vpMat;
+        vec3 u_cameraPos;
+    };
+
+    uniform mat4 u_modelMat;
+
+    void main()
+    {
+        gl_Position = u_vpMat * i_instanceMat * u_modelMat * vec4(i_position, 1);
+    }
+);
+
+static const char* _fragmentShader = GLSL(
+    struct Material {
+        vec3    diffuse;
+        float   shininess;
+    };
+
+    uniform Material material;
+
+    out vec4 o_color;
+
+    void main()
+    {
+        o_color = vec4(material.diffuse, 1);
+    }
+);
+
+static std::vector<L3DGLCall> _glCalls(const char* name)
+{
+    std::vector<L3DGLCall> calls(l3dGetGLCalls(0, 0));
+    if (!calls.empty())
+        l3dGetGLCalls(&calls[0], calls.size());
+
+    std::vector<L3DGLCall> matches;
+    for (unsigned int i = 0; i < calls.size(); ++i)
+        if (!strcmp(calls[i].name, name))
+            matches.push_back(calls[i]);
+
+    return matches;
+}
+
+// A mesh and its clones, which share geometry and are drawn as instances.
+static L3DHandle _loadScene(unsigned int clones)
+{
+    L3DHandle vertexShader = l3dLoadShader(L3D_SHADER_VERTEX, _vertexShader);
+    L3DHandle fragmentShader = l3dLoadShader(L3D_SHADER_FRAGMENT, _fragmentShader);
+    L3DHandle shaderProgram = l3dLoadShaderProgram(vertexShader, fragmentShader);
+    L3DHandle material = l3dLoadMaterial("material", shaderProgram);
+
+    L3DHandle cube = l3dLoadCube(material);
+    for (unsigned int i = 0; i < clones; ++i)
+        l3dCloneMesh(cube, glm::translate(L3DMat4(), L3DVec3(i % 3 - 1.0f, i / 3 - 1.0f, 0)));
+
+    return l3dLoadForwardRenderQueue(64, 64);
+}
+
+TEST_CASE( "Test null backend", "[leaf3d][glbackend][null]" )
+{
+    REQUIRE(l3dInit(L3D_BACKEND_NULL) == L3D_TRUE);
+
+    L3DHandle renderQueue = _loadScene(3);
+    L3DHandle camera = l3dLoadCamera();
+
+    l3dRenderFrame(camera, renderQueue);
+
+    // Engine runs as usual, nothing is logged.
+    REQUIRE(l3dGetFrameStats().instancedDrawCalls == 1);
+    REQUIRE(l3dGetGLCalls(0, 0) == 0);
+
+    l3dTerminate();
+}
+
+TEST_CASE( "Test recording backend", "[leaf3d][glbackend][recording]" )
+{
+    REQUIRE(l3dInit(L3D_BACKEND_RECORDING) == L3D_TRUE);
+
+    L3DHandle renderQueue = _loadScene(9);
+    L3DHandle camera = l3dLoadCamera();
+
+    // Uniforms are reflected from shader sources, structs by their fields.
+    REQUIRE(_glCalls("glGetUniformLocation").size() >= 3);
+
+    l3dRenderFrame(camera, renderQueue);
+
+    // Records second frame only, once resources are uploaded.
+    l3dClearGLCalls();
+    l3dRenderFrame(camera, renderQueue);
+
+    SECTION( "One draw per instanced batch" )
+    {
+        std::vector<L3DGLCall> draws = _glCalls("glDrawElementsInstancedBaseVertex");
+
+        REQUIRE(draws.size() == 1);
+        REQUIRE(draws[0].argCount == 6);
+        REQUIRE(draws[0].args[1] == 36);
+        REQUIRE(draws[0].args[4] == 10);
+    }
+
+    SECTION( "No redundant binds" )
+    {
+        const char* binds[] = { "glUseProgram", "glBindVertexArray", "glBindFramebuffer" };
+
+        for (unsigned int b = 0; b < 3; ++b)
+        {
+            std::vector<L3DGLCall> calls = _glCalls(binds[b]);
+
+            // Bound object is the last argument.
+            REQUIRE(!calls.empty());
+            for (unsigned int i = 1; i < calls.size(); ++i)
+            {
+                unsigned int last = calls[i].argCount - 1;
+                REQUIRE(calls[i].args[last] != calls[i - 1].args[last]);
+            }
+        }
+    }
+
+    SECTION( "Calls are recorded until terminate" )
+    {
+        unsigned int frameCalls = l3dGetGLCalls(0, 0);
+
+        l3dTerminate();
+
+        REQUIRE(l3dGetGLCalls(0, 0) > frameCalls);
+        REQUIRE(!_glCalls("glDeleteBuffers").empty());
+
+        l3dClearGLCalls();
+
+        REQUIRE(l3dGetGLCalls(0, 0) == 0);
+    }
+
+    l3dTerminate();
+}
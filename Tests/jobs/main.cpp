@@ -0,0 +1,135 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <atomic>
+#include <vector>
+#include <leaf3d/L3DJobSystem.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static void _incrementJob(void* data)
+{
+    static_cast<std::atomic<unsigned int>*>(data)->fetch_add(1);
+}
+
+static void _squareJob(void* data, unsigned int first, unsigned int last)
+{
+    std::vector<unsigned int>& values = *static_cast<std::vector<unsigned int>*>(data);
+
+    for (unsigned int i = first; i < last; ++i)
+        values[i] = i * i;
+}
+
+static void _chunkJob(void* data, unsigned int first, unsigned int last)
+{
+    std::vector<unsigned int>& chunks = *static_cast<std::vector<unsigned int>*>(data);
+    chunks[first] = last - first;
+}
+
+struct _DependentJobs
+{
+    L3DJobSystem*               jobs;
+    L3DJobCounter               firstStage;
+    std::atomic<unsigned int>   firstStageCount;
+    unsigned int                seenByLastStage;
+};
+
+static void _lastStageJob(void* data)
+{
+    _DependentJobs* dependent = static_cast<_DependentJobs*>(data);
+
+    // Waits for jobs it depends on, running them if needed.
+    dependent->jobs->wait(&dependent->firstStage);
+    dependent->seenByLastStage = dependent->firstStageCount;
+}
+
+TEST_CASE( "Test L3DJobSystem run and wait", "[leaf3d][jobs]" )
+{
+    for (unsigned int workerCount = 0; workerCount < 4; ++workerCount)
+    {
+        L3DJobSystem jobs(workerCount);
+        L3DJobCounter counter;
+        std::atomic<unsigned int> count(0);
+
+        REQUIRE( jobs.workerCount() == workerCount );
+
+        for (unsigned int i = 0; i < 1000; ++i)
+            jobs.run(_incrementJob, &count, &counter);
+
+        jobs.wait(&counter);
+
+        REQUIRE( counter.isDone() );
+        REQUIRE( count == 1000 );
+    }
+}
+
+TEST_CASE( "Test L3DJobSystem dependencies", "[leaf3d][jobs]" )
+{
+    L3DJobSystem jobs(3);
+    _DependentJobs dependent;
+    dependent.jobs = &jobs;
+    dependent.firstStageCount = 0;
+    dependent.seenByLastStage = 0;
+
+    for (unsigned int i = 0; i < 100; ++i)
+        jobs.run(_incrementJob, &dependent.firstStageCount, &dependent.firstStage);
+
+    // Likely to start before first stage is over.
+    L3DJobCounter lastStage;
+    jobs.run(_lastStageJob, &dependent, &lastStage);
+
+    jobs.wait(&lastStage);
+
+    REQUIRE( dependent.seenByLastStage == 100 );
+}
+
+TEST_CASE( "Test L3DJobSystem parallel for", "[leaf3d][jobs]" )
+{
+    L3DJobSystem jobs(0);
+
+    std::vector<unsigned int> chunks(1000, 0);
+    jobs.parallelFor(1000, 64, _chunkJob, &chunks);
+
+    std::vector<unsigned int> values(1000, 0);
+    jobs.parallelFor(1000, 64, _squareJob, &values);
+
+    // Chunks and results don't depend on worker count.
+    for (unsigned int workerCount = 1; workerCount < 4; ++workerCount)
+    {
+        jobs.setWorkerCount(workerCount);
+
+        REQUIRE( jobs.workerCount() == workerCount );
+
+        std::vector<unsigned int> otherChunks(1000, 0);
+        jobs.parallelFor(1000, 64, _chunkJob, &otherChunks);
+
+        std::vector<unsigned int> otherValues(1000, 0);
+        jobs.parallelFor(1000, 64, _squareJob, &otherValues);
+
+        REQUIRE( otherChunks == chunks );
+        REQUIRE( otherValues == values );
+    }
+
+    REQUIRE( chunks[0] == 64 );
+    REQUIRE( chunks[960] == 40 );
+    REQUIRE( values[999] == 999 * 999 );
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DLinearAllocator.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+TEST_CASE( "Test L3DLinearAllocator allocation", "[leaf3d][linearallocator]" )
+{
+    L3DLinearAllocator arena(256);
+
+    REQUIRE( arena.capacity() == 0 );
+
+    unsigned char* a = static_cast<unsigned char*>(arena.allocate(10));
+    unsigned char* b = static_cast<unsigned char*>(arena.allocate(8, 16));
+
+    REQUIRE( a != L3D_NULLPTR );
+    REQUIRE( b == a + 16 );
+    REQUIRE( arena.usedSize() == 24 );
+    REQUIRE( arena.capacity() == 256 );
+
+    float* floats = arena.allocate<float>(4);
+    floats[3] = 1.0f;
+
+    REQUIRE( reinterpret_cast<unsigned char*>(floats) == a + 32 );
+    REQUIRE( arena.usedSize() == 48 );
+}
+
+TEST_CASE( "Test L3DLinearAllocator growth and reset", "[leaf3d][linearallocator]" )
+{
+    L3DLinearAllocator arena(64);
+
+    void* first = arena.allocate(48);
+    void* second = arena.allocate(48);
+    void* large = arena.allocate(200);
+
+    REQUIRE( first != L3D_NULLPTR );
+    REQUIRE( second != L3D_NULLPTR );
+    REQUIRE( large != L3D_NULLPTR );
+    REQUIRE( arena.usedSize() == 296 );
+    REQUIRE( arena.capacity() == 328 );
+
+    // Blocks used so far are merged, next uses fit in one of them.
+    arena.reset();
+
+    REQUIRE( arena.usedSize() == 0 );
+    REQUIRE( arena.capacity() == 328 );
+
+    unsigned char* a = static_cast<unsigned char*>(arena.allocate(48));
+    unsigned char* b = static_cast<unsigned char*>(arena.allocate(48));
+    unsigned char* c = static_cast<unsigned char*>(arena.allocate(200));
+
+    REQUIRE( b == a + 48 );
+    REQUIRE( c == a + 96 );
+    REQUIRE( arena.capacity() == 328 );
+}
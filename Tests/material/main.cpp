@@ -0,0 +1,92 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DShaderProgram.h>
+#include <leaf3d/L3DMaterial.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+TEST_CASE( "Test L3DShaderProgram uniform ids", "[leaf3d][material][uniformId]" )
+{
+    REQUIRE(L3DShaderProgram::uniformId("u_modelMat") == L3D_UNIFORM_MODEL_MAT);
+    REQUIRE(L3DShaderProgram::uniformId("u_lightNr") == L3D_UNIFORM_LIGHT_NR);
+    REQUIRE(L3DShaderProgram::uniformId("u_light[2].color") == L3DShaderProgram::lightUniformId(2, L3D_LIGHT_UNIFORM_COLOR));
+
+    unsigned int id = L3DShaderProgram::uniformId("u_testUniform");
+
+    REQUIRE(L3DShaderProgram::uniformId("u_testUniform") == id);
+    REQUIRE(L3DShaderProgram::uniformId("u_otherTestUniform") != id);
+}
+
+TEST_CASE( "Test caching L3DShaderProgram uniform values", "[leaf3d][material][cacheUniformValue]" )
+{
+    L3DShaderProgram* shaderProgram = new L3DShaderProgram(0, 0, 0);
+
+    shaderProgram->setUniformLocation(L3D_UNIFORM_LIGHT_NR, 3);
+
+    int lightNr = 2;
+
+    REQUIRE(shaderProgram->uniformLocation(L3D_UNIFORM_LIGHT_NR) == 3);
+    REQUIRE(shaderProgram->uniformLocation(L3D_UNIFORM_MODEL_MAT) == -1);
+    REQUIRE(shaderProgram->cacheUniformValue(L3D_UNIFORM_LIGHT_NR, &lightNr, sizeof(lightNr)) == true);
+    REQUIRE(shaderProgram->cacheUniformValue(L3D_UNIFORM_LIGHT_NR, &lightNr, sizeof(lightNr)) == false);
+
+    lightNr = 4;
+
+    REQUIRE(shaderProgram->cacheUniformValue(L3D_UNIFORM_LIGHT_NR, &lightNr, sizeof(lightNr)) == true);
+}
+
+TEST_CASE( "Test resolving L3DMaterial uniforms", "[leaf3d][material][updateUniforms]" )
+{
+    L3DMaterial* material = L3DMaterial::createBlinnPhongMaterial(0, "test", 0);
+
+    material->updateUniforms();
+
+    REQUIRE(material->colorUniforms().size() == 3);
+    REQUIRE(material->paramUniforms().size() == 1);
+    REQUIRE(material->textureUniforms().size() == 3);
+    REQUIRE(material->paramUniforms()[0].id == L3DShaderProgram::uniformId("u_material.shininess"));
+    REQUIRE(*material->paramUniforms()[0].value == 32.0f);
+
+    material->setParam("shininess", 8.0f);
+
+    REQUIRE(*material->paramUniforms()[0].value == 8.0f);
+
+    material->setTexture("alphaMap", 0);
+    material->updateUniforms();
+
+    REQUIRE(material->textureUniforms().size() == 4);
+    REQUIRE(material->textureUniforms()[0].flagId == L3DShaderProgram::uniformId("u_alphaMapEnabled"));
+
+    // Resolved uniforms point into registries, which only grow through setters.
+    material->setColor("emission", L3DVec3(1, 0, 0));
+
+    REQUIRE(material->colors().size() == 4);
+    REQUIRE(material->colorUniforms().size() == 4);
+
+    for (unsigned int i = 0; i < material->colorUniforms().size(); ++i)
+    {
+        const L3DMaterialUniform<L3DVec3>& uniform = material->colorUniforms()[i];
+        if (uniform.id == L3DShaderProgram::uniformId("u_material.emission"))
+            REQUIRE(*uniform.value == L3DVec3(1, 0, 0));
+    }
+}
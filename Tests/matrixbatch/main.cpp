@@ -0,0 +1,89 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <stdlib.h>
+#include <vector>
+#include <leaf3d/L3DMatrixBatch.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static float _random()
+{
+    return (rand() % 2001) / 1000.0f - 1.0f;
+}
+
+TEST_CASE( "Test L3DMatrixBatch normal matrices", "[leaf3d][matrixbatch]" )
+{
+    srand(42);
+
+    // Enough matrices to go through all kernels and leftovers.
+    const unsigned int count = 29;
+    std::vector<L3DMat4> matrices(count);
+    std::vector<L3DMat3> normalMatrices(count);
+    std::vector<const L3DMat4*> matrixPointers(count);
+    std::vector<L3DMat3*> normalMatrixPointers(count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        L3DMat4 matrix = glm::translate(L3DMat4(), L3DVec3(_random(), _random(), _random()) * 10.0f);
+        matrix = glm::rotate(matrix, _random() * 3.0f, glm::normalize(L3DVec3(_random(), _random(), 1.0f)));
+        matrices[i] = glm::scale(matrix, L3DVec3(1.5f + _random(), 1.5f + _random(), 1.5f + _random()));
+        matrixPointers[i] = &matrices[i];
+        normalMatrixPointers[i] = &normalMatrices[i];
+    }
+
+    L3DMatrixBatch::normalMatrices(&matrixPointers[0], &normalMatrixPointers[0], count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        L3DMat3 expected = glm::transpose(glm::inverse(L3DMat3(matrices[i])));
+
+        for (int c = 0; c < 3; ++c)
+            for (int r = 0; r < 3; ++r)
+                REQUIRE( normalMatrices[i][c][r] == Approx(expected[c][r]) );
+
+        REQUIRE( L3DMatrixBatch::normalMatrix(matrices[i]) == expected );
+    }
+}
+
+TEST_CASE( "Test L3DMatrixBatch normal matrices of scaled matrices", "[leaf3d][matrixbatch]" )
+{
+    L3DMat4 matrix = glm::scale(L3DMat4(), L3DVec3(2, 4, 8));
+    const L3DMat4* matrices[8];
+    L3DMat3 normalMatrices[8];
+    L3DMat3* normalMatrixPointers[8];
+
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        matrices[i] = &matrix;
+        normalMatrixPointers[i] = &normalMatrices[i];
+    }
+
+    L3DMatrixBatch::normalMatrices(matrices, normalMatrixPointers, 8);
+
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        REQUIRE( normalMatrices[i][0] == L3DVec3(0.5f, 0, 0) );
+        REQUIRE( normalMatrices[i][1] == L3DVec3(0, 0.25f, 0) );
+        REQUIRE( normalMatrices[i][2] == L3DVec3(0, 0, 0.125f) );
+    }
+}
@@ -19,7 +19,115 @@
  * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
  */
 
+#include <leaf3d/L3DBuffer.h>
 #include <leaf3d/L3DMesh.h>
 #include <catch/catch.hpp>
 
 using namespace l3d;
+
+TEST_CASE( "Test L3DMesh bounds", "[leaf3d][mesh][bounds]" )
+{
+    float vertices[] = {
+        -1.0f, 0.0f, -2.0f,
+         3.0f, 1.0f,  0.0f,
+         1.0f, 2.0f,  2.0f
+    };
+
+    L3DMesh* mesh = new L3DMesh(0, vertices, 3, 0, 0, 0, L3D_VERTEX_POS3);
+
+    REQUIRE(mesh->hasFlag(L3D_MESH_CULLING) == true);
+    REQUIRE(mesh->bounds().min == L3DVec3(-1, 0, -2));
+    REQUIRE(mesh->bounds().max == L3DVec3(3, 2, 2));
+    REQUIRE(mesh->boundingSphere().center == L3DVec3(1, 1, 0));
+    REQUIRE(mesh->boundingSphere().radius == Approx(3.0f));
+
+    mesh->translate(L3DVec3(10, 0, 0));
+    mesh->scale(L3DVec3(2, 2, 2));
+
+    REQUIRE(mesh->worldBounds().min == L3DVec3(8, 0, -4));
+    REQUIRE(mesh->worldBounds().max == L3DVec3(16, 4, 4));
+    REQUIRE(mesh->worldBoundingSphere().radius == Approx(6.0f));
+
+    // Normal matrix follows transforms.
+    REQUIRE(mesh->normalMatrix()[0][0] == Approx(0.5f));
+    REQUIRE(mesh->normalMatrix()[1][1] == Approx(0.5f));
+    REQUIRE(mesh->normalMatrix()[2][0] == Approx(0.0f));
+
+    mesh->setFlag(L3D_MESH_CULLING, false);
+
+    REQUIRE(mesh->hasFlag(L3D_MESH_CULLING) == false);
+}
+
+TEST_CASE( "Test L3DMesh update vertices", "[leaf3d][mesh][update]" )
+{
+    float vertices[] = {
+        -1.0f, 0.0f, -2.0f,
+         3.0f, 1.0f,  0.0f,
+         1.0f, 2.0f,  2.0f
+    };
+
+    L3DMesh* mesh = new L3DMesh(0, vertices, 3, 0, 0, 0, L3D_VERTEX_POS3, L3DMat4(), L3D_DRAW_DYNAMIC);
+
+    float moved[] = {
+        5.0f, 4.0f, 2.0f,
+        7.0f, 6.0f, 2.0f
+    };
+
+    mesh->updateVertices(moved, 2, 1);
+
+    float* data = mesh->vertexBuffer()->data<float>();
+
+    REQUIRE(data[0] == -1.0f);
+    REQUIRE(data[3] == 5.0f);
+    REQUIRE(data[8] == 2.0f);
+    REQUIRE(mesh->bounds().min == L3DVec3(-1, 0, -2));
+    REQUIRE(mesh->bounds().max == L3DVec3(7, 6, 2));
+
+    // Ranges past the end are clamped.
+    mesh->updateVertices(moved, 2, 2);
+
+    REQUIRE(data[6] == 5.0f);
+    REQUIRE(mesh->vertexCount() == 3);
+}
+
+TEST_CASE( "Test L3DMesh instance streaming", "[leaf3d][mesh][instances]" )
+{
+    float vertices[] = {
+        -1.0f, 0.0f, 0.0f,
+         1.0f, 0.0f, 0.0f,
+         0.0f, 1.0f, 0.0f
+    };
+
+    L3DMesh* mesh = new L3DMesh(0, vertices, 3, 0, 0, 0, L3D_VERTEX_POS3);
+
+    REQUIRE(mesh->instanceCount() == 1);
+
+    float* instances = static_cast<float*>(mesh->mapInstances(8, L3D_INSTANCE_POS3));
+    L3DBuffer* instanceBuffer = mesh->instanceBuffer();
+
+    REQUIRE(instances != 0);
+    REQUIRE(instanceBuffer->count() == 8);
+    REQUIRE(instanceBuffer->drawType() == L3D_DRAW_DYNAMIC);
+    REQUIRE(mesh->instanceCount() == 0);
+    REQUIRE(mesh->hasFlag(L3D_MESH_CULLING) == false);
+
+    instances[0] = 1.0f;
+    mesh->commitInstances(5);
+
+    REQUIRE(mesh->instanceCount() == 5);
+
+    // Buffer is kept while large enough.
+    REQUIRE(mesh->mapInstances(6, L3D_INSTANCE_POS3) == instances);
+    REQUIRE(mesh->instanceBuffer() == instanceBuffer);
+
+    mesh->commitInstances(20);
+
+    REQUIRE(mesh->instanceCount() == 8);
+
+    // Larger or different instances need a new buffer.
+    mesh->mapInstances(16, L3D_INSTANCE_POS3);
+
+    REQUIRE(mesh->instanceBuffer() != instanceBuffer);
+    REQUIRE(mesh->instanceBuffer()->count() == 16);
+    REQUIRE(mesh->instanceCount() == 0);
+}
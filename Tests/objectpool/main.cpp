@@ -0,0 +1,134 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <vector>
+#include <leaf3d/L3DObjectPool.h>
+#include <leaf3d/L3DMesh.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+struct PooledItem : public L3DPooled<PooledItem>
+{
+    int     value;
+    double  weight;
+
+    PooledItem(int v) : value(v), weight(v * 0.5) {}
+};
+
+TEST_CASE( "Test L3DObjectPool allocation", "[leaf3d][objectpool]" )
+{
+    L3DObjectPool pool(24, 4);
+
+    REQUIRE( pool.blockSize() % 16 == 0 );
+    REQUIRE( pool.blockSize() >= 24 );
+    REQUIRE( pool.capacity() == 0 );
+
+    unsigned char* a = static_cast<unsigned char*>(pool.allocate());
+    unsigned char* b = static_cast<unsigned char*>(pool.allocate());
+
+    REQUIRE( a != L3D_NULLPTR );
+    REQUIRE( b == a + pool.blockSize() );
+    REQUIRE( pool.blockCount() == 2 );
+    REQUIRE( pool.capacity() == 4 );
+
+    // Last released block is reused first.
+    pool.release(a);
+    REQUIRE( pool.blockCount() == 1 );
+    REQUIRE( pool.allocate() == a );
+
+    // A new chunk is reserved when the first one is full.
+    pool.allocate();
+    pool.allocate();
+    REQUIRE( pool.capacity() == 4 );
+    REQUIRE( pool.allocate() != L3D_NULLPTR );
+    REQUIRE( pool.capacity() == 8 );
+    REQUIRE( pool.blockCount() == 5 );
+}
+
+TEST_CASE( "Test L3DObjectPool many blocks", "[leaf3d][objectpool]" )
+{
+    L3DObjectPool pool(sizeof(int));
+    std::vector<int*> blocks;
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        int* block = static_cast<int*>(pool.allocate());
+        *block = i;
+        blocks.push_back(block);
+    }
+
+    int valid = 0;
+    for (int i = 0; i < 10000; ++i)
+    {
+        if (*blocks[i] == i)
+            ++valid;
+        pool.release(blocks[i]);
+    }
+
+    REQUIRE( valid == 10000 );
+    REQUIRE( pool.blockCount() == 0 );
+    REQUIRE( pool.capacity() >= 10000 );
+}
+
+TEST_CASE( "Test L3DPooled objects", "[leaf3d][objectpool]" )
+{
+    L3DObjectPool& pool = PooledItem::objectPool();
+    unsigned int count = pool.blockCount();
+
+    PooledItem* a = new PooledItem(4);
+    PooledItem* b = new PooledItem(8);
+
+    REQUIRE( pool.blockCount() == count + 2 );
+    REQUIRE( a->value == 4 );
+    REQUIRE( b->weight == 4.0 );
+
+    delete a;
+    REQUIRE( pool.blockCount() == count + 1 );
+
+    PooledItem* c = new PooledItem(2);
+    REQUIRE( c == a );
+
+    delete b;
+    delete c;
+    REQUIRE( pool.blockCount() == count );
+}
+
+TEST_CASE( "Test L3DMesh is pooled", "[leaf3d][objectpool]" )
+{
+    L3DObjectPool& pool = L3DMesh::objectPool();
+    unsigned int count = pool.blockCount();
+
+    float vertices[] = {
+        0.0f, 0.0f, 0.0f,
+        1.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f
+    };
+
+    L3DMesh* mesh = new L3DMesh(0, vertices, 3, 0, 0, 0, L3D_VERTEX_POS3);
+
+    REQUIRE( pool.blockCount() == count + 1 );
+
+    // Resources are destroyed through their base class.
+    delete static_cast<L3DResource*>(mesh);
+
+    REQUIRE( pool.blockCount() == count );
+}
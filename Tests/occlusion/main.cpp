@@ -0,0 +1,117 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DOcclusionBuffer.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static L3DMat4 _testViewProj()
+{
+    // Camera at origin, looking at -Z.
+    L3DMat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    L3DMat4 view = glm::lookAt(L3DVec3(0, 0, 0), L3DVec3(0, 0, -1), L3DVec3(0, 1, 0));
+
+    return proj * view;
+}
+
+// Wall of 4x4 units at z = -10, facing the camera.
+static float _wallVertices[] = {
+    -2, -2, -10,
+     2, -2, -10,
+     2,  2, -10,
+    -2,  2, -10
+};
+
+static unsigned int _wallIndices[] = {
+    0, 1, 2,
+    2, 3, 0
+};
+
+TEST_CASE( "Test L3DOcclusionBuffer rasterization", "[leaf3d][occlusion][rasterize]" )
+{
+    L3DOcclusionBuffer buffer(64, 64);
+    buffer.clear(_testViewProj());
+
+    REQUIRE(buffer.width() == 64);
+    REQUIRE(buffer.levelCount() == 7);
+    REQUIRE(buffer.depth(32, 32) == 1.0f);
+
+    buffer.rasterize(_wallVertices, 4, 3, _wallIndices, 6);
+
+    REQUIRE(buffer.occluderTriangleCount() == 2);
+    REQUIRE(buffer.depth(32, 32) < 1.0f);
+    REQUIRE(buffer.depth(0, 0) == 1.0f);
+
+    // Wall covers the central fifth of the screen.
+    buffer.updateHierarchy();
+
+    REQUIRE(buffer.depth(8, 8, 2) < 1.0f);
+    REQUIRE(buffer.depth(0, 0, 6) == 1.0f);
+}
+
+TEST_CASE( "Test L3DOcclusionBuffer occlusion", "[leaf3d][occlusion][occluded]" )
+{
+    L3DOcclusionBuffer buffer(64, 64);
+    buffer.clear(_testViewProj());
+    buffer.rasterize(_wallVertices, 4, 3, _wallIndices, 6);
+
+    // Behind the wall.
+    REQUIRE(buffer.isOccluded(L3DAABB(L3DVec3(-1, -1, -21), L3DVec3(1, 1, -19))) == true);
+
+    // In front of the wall.
+    REQUIRE(buffer.isOccluded(L3DAABB(L3DVec3(-1, -1, -6), L3DVec3(1, 1, -4))) == false);
+
+    // Behind, but bigger than the wall on screen.
+    REQUIRE(buffer.isOccluded(L3DAABB(L3DVec3(-8, -1, -21), L3DVec3(8, 1, -19))) == false);
+
+    // Beside the wall.
+    REQUIRE(buffer.isOccluded(L3DAABB(L3DVec3(6, -1, -21), L3DVec3(8, 1, -19))) == false);
+
+    // Around the camera.
+    REQUIRE(buffer.isOccluded(L3DAABB(L3DVec3(-1, -1, -1), L3DVec3(1, 1, 1))) == false);
+
+    REQUIRE(buffer.testedCount() == 5);
+    REQUIRE(buffer.occludedCount() == 1);
+
+    buffer.clear(_testViewProj());
+
+    REQUIRE(buffer.isOccluded(L3DAABB(L3DVec3(-1, -1, -21), L3DVec3(1, 1, -19))) == false);
+    REQUIRE(buffer.occludedCount() == 0);
+}
+
+TEST_CASE( "Test L3DOcclusionBuffer near plane", "[leaf3d][occlusion][rasterize]" )
+{
+    L3DOcclusionBuffer buffer(64, 64);
+    buffer.clear(_testViewProj());
+
+    // Triangle crossing near plane is not drawn.
+    float vertices[] = {
+        -2, -2, -10,
+         2, -2, -10,
+         0,  2, 5
+    };
+
+    buffer.rasterize(vertices, 3, 3, L3D_NULLPTR, 0);
+
+    REQUIRE(buffer.occluderTriangleCount() == 0);
+    REQUIRE(buffer.isOccluded(L3DAABB(L3DVec3(-1, -1, -21), L3DVec3(1, 1, -19))) == false);
+}
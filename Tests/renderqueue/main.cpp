@@ -0,0 +1,87 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DRenderQueue.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+TEST_CASE( "Test L3DRenderQueue command records", "[leaf3d][renderqueue]" )
+{
+    L3DRenderQueue queue(0, "Test");
+
+    queue.addSwitchFrameBufferCommand();
+    queue.addClearBuffersCommand(true, false, true, L3DVec4(0.1f, 0.2f, 0.3f, 0.4f));
+    queue.addSetBlendCommand(true, L3D_ONE, L3D_ZERO);
+    queue.addSetCullFaceCommand(true, L3D_FRONT_FACE);
+    queue.addDrawMeshesCommand(3);
+
+    const L3DRenderCommandList& commands = queue.commands();
+
+    REQUIRE( queue.commandCount() == 5 );
+    REQUIRE( queue.isCompiled() == false );
+
+    REQUIRE( commands[0].type == L3D_SWITCH_FRAME_BUFFER );
+    REQUIRE( commands[0].switchFrameBuffer.frameBuffer.repr == 0 );
+
+    REQUIRE( commands[1].type == L3D_CLEAR_BUFFERS );
+    REQUIRE( commands[1].clearBuffers.colorBuffer == true );
+    REQUIRE( commands[1].clearBuffers.depthBuffer == false );
+    REQUIRE( commands[1].clearBuffers.stencilBuffer == true );
+    REQUIRE( commands[1].clearBuffers.clearColor[2] == 0.3f );
+
+    REQUIRE( commands[2].type == L3D_SET_BLEND );
+    REQUIRE( commands[2].setBlend.srcFactor == L3D_ONE );
+    REQUIRE( commands[2].setBlend.dstFactor == L3D_ZERO );
+
+    REQUIRE( commands[3].type == L3D_SET_CULL_FACE );
+    REQUIRE( commands[3].setCullFace.cullFace == L3D_FRONT_FACE );
+
+    REQUIRE( commands[4].type == L3D_DRAW_MESHES );
+    REQUIRE( commands[4].drawMeshes.renderLayer == 3 );
+}
+
+TEST_CASE( "Test L3DRenderQueue clear and append", "[leaf3d][renderqueue]" )
+{
+    L3DRenderQueue queue(0, "Test");
+
+    for (unsigned int i = 0; i < 16; ++i)
+        queue.addDrawMeshesCommand(i);
+
+    const L3DRenderCommand* storage = &queue.commands()[0];
+
+    // Storage is kept, so queues can be recorded again without allocations.
+    queue.clear();
+
+    REQUIRE( queue.commandCount() == 0 );
+
+    queue.addSetDepthMaskCommand(false);
+
+    REQUIRE( &queue.commands()[0] == storage );
+
+    L3DRenderQueue other(0, "Other");
+    other.addSetStencilTestCommand(true);
+    other.appendCommands(queue.commands());
+
+    REQUIRE( other.commandCount() == 2 );
+    REQUIRE( other.commands()[1].type == L3D_SET_DEPTH_MASK );
+    REQUIRE( other.commands()[1].setDepthMask.enable == false );
+}
@@ -0,0 +1,116 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <vector>
+#include <leaf3d/L3DSlotMap.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static L3DHandle _handle(const L3DSlotMap<int>& pool, unsigned int id)
+{
+    L3DHandle handle = L3D_INVALID_HANDLE;
+    handle.data.id = id;
+    handle.data.generation = pool.generation(id);
+    return handle;
+}
+
+TEST_CASE( "Test L3DSlotMap add and remove", "[leaf3d][slotmap]" )
+{
+    L3DSlotMap<int> pool;
+    int items[3] = { 10, 20, 30 };
+
+    unsigned int a = pool.add(&items[0]);
+    unsigned int b = pool.add(&items[1]);
+    unsigned int c = pool.add(&items[2]);
+
+    REQUIRE( a != 0 );
+    REQUIRE( pool.size() == 3 );
+    REQUIRE( pool.get(_handle(pool, b)) == &items[1] );
+    REQUIRE( pool.get(L3D_INVALID_HANDLE) == L3D_NULLPTR );
+
+    L3DHandle stale = _handle(pool, a);
+    pool.remove(a);
+
+    REQUIRE( pool.size() == 2 );
+    REQUIRE( pool.get(stale) == L3D_NULLPTR );
+    REQUIRE( pool.get(_handle(pool, c)) == &items[2] );
+
+    // Items stay dense.
+    unsigned int count = 0;
+    for (L3DSlotMap<int>::iterator it = pool.begin(); it != pool.end(); ++it)
+    {
+        REQUIRE( *it != L3D_NULLPTR );
+        ++count;
+    }
+    REQUIRE( count == 2 );
+
+    // Reused id doesn't revive old handles.
+    unsigned int d = pool.add(&items[0]);
+
+    REQUIRE( d == a );
+    REQUIRE( pool.get(stale) == L3D_NULLPTR );
+    REQUIRE( pool.get(_handle(pool, d)) == &items[0] );
+
+    // Removing twice, or removing unknown ids, does nothing.
+    pool.remove(b);
+    pool.remove(b);
+    pool.remove(0);
+    pool.remove(1000);
+
+    REQUIRE( pool.size() == 2 );
+
+    pool.clear();
+
+    REQUIRE( pool.empty() );
+    REQUIRE( pool.get(_handle(pool, c)) == L3D_NULLPTR );
+}
+
+TEST_CASE( "Test L3DSlotMap many items", "[leaf3d][slotmap]" )
+{
+    L3DSlotMap<int> pool;
+    std::vector<int> items(100000);
+    std::vector<unsigned int> ids;
+
+    // More than fit in 16 bits.
+    for (unsigned int i = 0; i < items.size(); ++i)
+    {
+        items[i] = i;
+        ids.push_back(pool.add(&items[i]));
+    }
+
+    REQUIRE( ids.back() == items.size() );
+
+    for (unsigned int i = 0; i < items.size(); i += 2)
+        pool.remove(ids[i]);
+
+    REQUIRE( pool.size() == items.size() / 2 );
+
+    unsigned int found = 0;
+    for (unsigned int i = 1; i < items.size(); i += 2)
+    {
+        int* item = pool.get(_handle(pool, ids[i]));
+        if (item && *item == (int)i)
+            ++found;
+    }
+
+    REQUIRE( found == items.size() / 2 );
+}
@@ -0,0 +1,159 @@
+/*
+ * This file is part of the leaf3d project.
+ *
+ * Copyright 2014-2015 Emanuele Bertoldi. All rights reserved.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You should have received a copy of the modified BSD License along with this
+ * program. If not, see <http://www.opensource.org/licenses/bsd-license.php>
+ */
+
+#include <leaf3d/L3DTransformGraph.h>
+#include <catch/catch.hpp>
+
+using namespace l3d;
+
+static L3DMat4 _translation(float x, float y, float z)
+{
+    return glm::translate(L3DMat4(), L3DVec3(x, y, z));
+}
+
+static bool _equal(const L3DMat4& a, const L3DMat4& b)
+{
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            if (glm::abs(a[c][r] - b[c][r]) > 0.0001f)
+                return false;
+
+    return true;
+}
+
+TEST_CASE( "Test L3DTransformGraph update", "[leaf3d][transformgraph]" )
+{
+    L3DTransformGraph graph;
+
+    unsigned int root = graph.createNode(_translation(1, 0, 0));
+    unsigned int child = graph.createNode(_translation(0, 2, 0), root);
+    unsigned int grandChild = graph.createNode(_translation(0, 0, 3), child);
+    unsigned int other = graph.createNode(_translation(5, 0, 0));
+
+    REQUIRE( root != 0 );
+    REQUIRE( graph.nodeCount() == 4 );
+    REQUIRE( graph.parent(child) == root );
+    REQUIRE( graph.parent(root) == 0 );
+
+    REQUIRE( graph.update() == 4 );
+    REQUIRE( _equal(graph.worldMatrix(grandChild), _translation(1, 2, 3)) );
+    REQUIRE( _equal(graph.worldMatrix(other), _translation(5, 0, 0)) );
+
+    SECTION( "Nothing changed" )
+    {
+        REQUIRE( graph.update() == 0 );
+        REQUIRE( !graph.hasChanged(root) );
+    }
+
+    SECTION( "Only changed subtree is updated" )
+    {
+        graph.setLocalMatrix(child, _translation(0, 4, 0));
+
+        REQUIRE( graph.update() == 2 );
+        REQUIRE( !graph.hasChanged(root) );
+        REQUIRE( graph.hasChanged(child) );
+        REQUIRE( graph.hasChanged(grandChild) );
+        REQUIRE( !graph.hasChanged(other) );
+        REQUIRE( _equal(graph.worldMatrix(grandChild), _translation(1, 4, 3)) );
+
+        REQUIRE( graph.update() == 0 );
+        REQUIRE( !graph.hasChanged(child) );
+    }
+}
+
+TEST_CASE( "Test L3DTransformGraph hierarchy changes", "[leaf3d][transformgraph]" )
+{
+    L3DTransformGraph graph;
+
+    unsigned int a = graph.createNode(_translation(1, 0, 0));
+    unsigned int b = graph.createNode(_translation(0, 1, 0), a);
+    unsigned int c = graph.createNode(_translation(0, 0, 1));
+
+    graph.update();
+
+    SECTION( "Reparent to a later node" )
+    {
+        // Needs nodes to be sorted again.
+        REQUIRE( graph.setParent(a, c) );
+        REQUIRE( graph.parent(a) == c );
+        REQUIRE( graph.update() == 2 );
+        REQUIRE( _equal(graph.worldMatrix(a), _translation(1, 0, 1)) );
+        REQUIRE( _equal(graph.worldMatrix(b), _translation(1, 1, 1)) );
+        REQUIRE( !graph.hasChanged(c) );
+    }
+
+    SECTION( "Cycles are rejected" )
+    {
+        REQUIRE( !graph.setParent(a, b) );
+        REQUIRE( !graph.setParent(a, a) );
+        REQUIRE( graph.parent(a) == 0 );
+    }
+
+    SECTION( "Detach from parent" )
+    {
+        REQUIRE( graph.setParent(b, 0) );
+        REQUIRE( graph.update() == 1 );
+        REQUIRE( _equal(graph.worldMatrix(b), _translation(0, 1, 0)) );
+    }
+
+    SECTION( "Destroy node" )
+    {
+        graph.destroyNode(a);
+
+        REQUIRE( !graph.isValid(a) );
+        REQUIRE( graph.nodeCount() == 2 );
+        REQUIRE( graph.parent(b) == 0 );
+
+        // Children keep their world matrices.
+        REQUIRE( graph.update() == 1 );
+        REQUIRE( _equal(graph.worldMatrix(b), _translation(1, 1, 0)) );
+        REQUIRE( _equal(graph.worldMatrix(c), _translation(0, 0, 1)) );
+
+        // Ids are recycled.
+        REQUIRE( graph.createNode() == a );
+    }
+}
+
+TEST_CASE( "Test L3DTransformGraph deep hierarchy", "[leaf3d][transformgraph]" )
+{
+    L3DTransformGraph graph;
+    std::vector<unsigned int> nodes;
+
+    // Chain built backwards, each node parented to a later one.
+    for (unsigned int i = 0; i < 100; ++i)
+        nodes.push_back(graph.createNode(_translation(1, 0, 0)));
+
+    for (unsigned int i = 0; i < 99; ++i)
+        REQUIRE( graph.setParent(nodes[i], nodes[i + 1]) );
+
+    REQUIRE( graph.update() == 100 );
+    REQUIRE( _equal(graph.worldMatrix(nodes[0]), _translation(100, 0, 0)) );
+
+    graph.setLocalMatrix(nodes[99], _translation(2, 0, 0));
+
+    REQUIRE( graph.update() == 100 );
+    REQUIRE( _equal(graph.worldMatrix(nodes[0]), _translation(101, 0, 0)) );
+
+    graph.setLocalMatrix(nodes[0], L3DMat4());
+
+    REQUIRE( graph.update() == 1 );
+    REQUIRE( _equal(graph.worldMatrix(nodes[0]), _translation(100, 0, 0)) );
+}